@@ -0,0 +1,502 @@
+/**
+ * @file rtap_bench.c
+ * @brief Micro-benchmarks for the vas DSP building blocks <br>
+ * <br>
+ * Runs without Pure Data. Every vector kernel is timed for every kernel set
+ * the CPU supports and compared against the scalar reference, then the
+ * oscillator and ADSR block routines are timed the way the perform routine
+ * calls them. <br>
+ * Built with make MEMTRACK=1, the memory of the engine is reported by category. <br>
+ * <br>
+ * Build and run with "make bench". <br>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "vas_util.h"
+#include "vas_osc.h"
+#include "vas_adsr.h"
+#include "vas_fm.h"
+#include "vas_pool.h"
+#include "vas_mem.h"
+
+#define BENCH_BLOCKSIZE 64
+#define BENCH_BUFFERSIZE 1027
+#define BENCH_ITERATIONS 200000
+#define BENCH_SAMPLING_FREQUENCY 44100
+#define BENCH_INSTANCES 300
+#define BENCH_MORPHSIZE 2048
+#define BENCH_TICKS 2000
+
+static double bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench_random(float *dest, int length)
+{
+    for(int i = 0; i < length; i++)
+        dest[i] = (float)rand() / RAND_MAX * 2.0F - 1.0F;
+}
+
+static float bench_maxError(const float *a, const float *b, int length)
+{
+    float error = 0;
+    for(int i = 0; i < length; i++)
+        if(fabsf(a[i] - b[i]) > error)
+            error = fabsf(a[i] - b[i]);
+    return error;
+}
+
+static float in1[BENCH_BUFFERSIZE], in2[BENCH_BUFFERSIZE];
+static float dest[BENCH_BUFFERSIZE], reference[BENCH_BUFFERSIZE];
+
+/* runs one kernel on the (unaligned, odd-length) test buffer */
+static void bench_runKernel(int kernel, float *out, int length)
+{
+    switch(kernel)
+    {
+        case 0: vas_util_fadd(in1, in2, out, length); break;
+        case 1: vas_util_fmultiply(in1, in2, out, length); break;
+        case 2: vas_util_fscale(in1, 0.7F, out, length); break;
+        case 3: vas_util_fcopy(in2, out, length); vas_util_fmultiplyAccumulate(in1, in2, out, length); break;
+        case 4: vas_util_fmix(in1, in2, 0.3F, out, length); break;
+        case 5: vas_util_fclip(in1, -0.5F, 0.5F, out, length); break;
+        case 6: vas_util_ffill(out, 0.25F, length); break;
+        case 7: vas_util_fcopy(in1, out, length); break;
+        case 8: vas_util_fsine(in1, out, length); break;
+    }
+}
+
+static const char *kernelNames[] = {"fadd", "fmultiply", "fscale", "fmultiplyAccumulate", "fmix", "fclip", "ffill", "fcopy", "fsine"};
+#define BENCH_KERNELS 9
+
+static void bench_kernels(void)
+{
+    int sets[] = {VAS_UTIL_SCALAR, VAS_UTIL_SSE2, VAS_UTIL_AVX2, VAS_UTIL_NEON};
+
+    bench_random(in1, BENCH_BUFFERSIZE);
+    bench_random(in2, BENCH_BUFFERSIZE);
+
+    printf("vector kernels, %d samples per call, ns/sample (max error vs scalar)\n", BENCH_BLOCKSIZE);
+    printf("%-22s", "");
+    for(int s = 0; s < 4; s++)
+        printf("%22s", vas_util_kernelName(sets[s]));
+    printf("\n");
+
+    for(int k = 0; k < BENCH_KERNELS; k++)
+    {
+        printf("%-22s", kernelNames[k]);
+
+        vas_util_selectKernels(VAS_UTIL_SCALAR);
+        bench_runKernel(k, reference, BENCH_BUFFERSIZE);
+
+        for(int s = 0; s < 4; s++)
+        {
+            if(!vas_util_selectKernels(sets[s]))
+            {
+                printf("%22s", "n/a");
+                continue;
+            }
+
+            bench_runKernel(k, dest, BENCH_BUFFERSIZE);
+            float error = bench_maxError(dest, reference, BENCH_BUFFERSIZE);
+
+            double start = bench_now();
+            for(int i = 0; i < BENCH_ITERATIONS; i++)
+                bench_runKernel(k, dest + (i & 3), BENCH_BLOCKSIZE);
+            double ns = (bench_now() - start) * 1e9 / ((double)BENCH_ITERATIONS * BENCH_BLOCKSIZE);
+
+            printf("%12.3f (%7.1e)", ns, error);
+        }
+        printf("\n");
+    }
+    printf("\n");
+    vas_util_init();
+}
+
+/* maximum error of vas_util_fsine against sin() over several periods */
+static void bench_sineAccuracy(void)
+{
+    float phase[BENCH_BUFFERSIZE];
+    double error = 0;
+
+    for(int i = 0; i < BENCH_BUFFERSIZE; i++)
+        phase[i] = -4.0F + 8.0F * i / BENCH_BUFFERSIZE;
+    vas_util_fsine(phase, dest, BENCH_BUFFERSIZE);
+    for(int i = 0; i < BENCH_BUFFERSIZE; i++)
+        if(fabs(dest[i] - sin(2 * M_PI * phase[i])) > error)
+            error = fabs(dest[i] - sin(2 * M_PI * phase[i]));
+
+    printf("fsine max error vs sin(): %.2e\n\n", error);
+}
+
+/* maximum error of an unmodulated carrier against the exact sine, first 4096 samples */
+static double bench_oscError(vas_osc *osc)
+{
+    double error = 0;
+    osc->currentIndex = 0;
+    for(int block = 0; block < 4096 / BENCH_BLOCKSIZE; block++)
+    {
+        vas_osc_process(osc, in1, dest, BENCH_BLOCKSIZE, MODE_CARRIER_NO_INPUT);
+        for(int i = 0; i < BENCH_BLOCKSIZE; i++)
+        {
+            double t = (double)(block * BENCH_BLOCKSIZE + i) * osc->frequency / osc->tableSize;
+            if(fabs(dest[i] - sin(2 * M_PI * t)) > error)
+                error = fabs(dest[i] - sin(2 * M_PI * t));
+        }
+    }
+    return error;
+}
+
+static void bench_osc(void)
+{
+    const char *modeNames[] = {"MODE_MOD_WITH_INPUT", "MODE_CARRIER_NO_INPUT", "MODE_SUM_WITH_IN"};
+    const char *pathNames[] = {"lookup table", "polynomial", "morphing table"};
+    vas_osc *osc = vas_osc_new(BENCH_SAMPLING_FREQUENCY, 440.5F);
+    static float pairs[2 * (BENCH_MORPHSIZE + 1)];
+
+    /* two sine frames half way morphed, so the error compares to the other paths */
+    for(int i = 0; i <= BENCH_MORPHSIZE; i++)
+        pairs[2 * i] = pairs[2 * i + 1] = (float)sin(2 * M_PI * i / BENCH_MORPHSIZE);
+
+    printf("vas_osc_process, %d samples per call, kernels: %s\n", BENCH_BLOCKSIZE, vas_util_kernelName(vas_util_init()));
+    for(int path = 0; path < 3; path++)
+    {
+        if(path == 2)
+        {
+            vas_osc_morphTable(osc, pairs, BENCH_MORPHSIZE, 1, 1, 2 * (BENCH_MORPHSIZE + 1), 0);
+            vas_osc_setPosition(osc, 0.5F);
+        }
+        else
+            osc->isSine = path;
+        printf("  %s, carrier max error vs sin(): %.2e\n", pathNames[path], bench_oscError(osc));
+        for(int mode = 0; mode < 3; mode++)
+        {
+            bench_random(in1, BENCH_BLOCKSIZE);
+            double start = bench_now();
+            for(int i = 0; i < BENCH_ITERATIONS; i++)
+                vas_osc_process(osc, in1, in1, BENCH_BLOCKSIZE, mode);
+            double ns = (bench_now() - start) * 1e9 / ((double)BENCH_ITERATIONS * BENCH_BLOCKSIZE);
+            printf("    %-24s %8.3f ns/sample\n", modeNames[mode], ns);
+        }
+    }
+    printf("\n");
+    vas_osc_free(osc);
+}
+
+/*
+ * maximum difference of a control rate envelope to the audio rate envelope
+ * over one second, with long stages on the default curves or, if steep is
+ * set, with short stages on steep q-curves, where interpolation errs most
+ */
+static float bench_adsrError(int mode, int controlPeriod, int steep)
+{
+    vas_adsr *audioRate = vas_adsr_new(BENCH_SAMPLING_FREQUENCY);
+    vas_adsr *adsr = vas_adsr_new(BENCH_SAMPLING_FREQUENCY);
+    float error = 0;
+
+    if(steep)
+    {
+        vas_adsr_setADSR_values(audioRate, 60, 50, 0.5, 60);
+        vas_adsr_setADSR_values(adsr, 60, 50, 0.5, 60);
+        vas_adsr_setQ(audioRate, 8, 0.2F, 8);
+        vas_adsr_setQ(adsr, 8, 0.2F, 8);
+    }
+    else
+    {
+        vas_adsr_setADSR_values(audioRate, 98, 95, 0.5, 90);
+        vas_adsr_setADSR_values(adsr, 98, 95, 0.5, 90);
+    }
+    vas_adsr_modeswitch(audioRate, mode);
+    vas_adsr_modeswitch(adsr, mode);
+    vas_adsr_setControlPeriod(adsr, controlPeriod);
+    vas_adsr_noteOn(audioRate, 100);
+    vas_adsr_noteOn(adsr, 100);
+    vas_util_ffill(in1, 1, BENCH_BLOCKSIZE);
+
+    for(int block = 0; block < BENCH_SAMPLING_FREQUENCY / BENCH_BLOCKSIZE; block++)
+    {
+        vas_adsr_process(audioRate, in1, in2, BENCH_BLOCKSIZE);
+        vas_adsr_process(adsr, in1, dest, BENCH_BLOCKSIZE);
+        float blockError = bench_maxError(in2, dest, BENCH_BLOCKSIZE);
+        if(blockError > error)
+            error = blockError;
+    }
+
+    vas_adsr_free(audioRate);
+    vas_adsr_free(adsr);
+    return error;
+}
+
+static void bench_adsr(void)
+{
+    const char *modeNames[] = {"MODE_LFO", "MODE_TRIGGER"};
+    int periods[] = {1, 8, 32, 64};
+    vas_adsr *adsr = vas_adsr_new(BENCH_SAMPLING_FREQUENCY);
+
+    printf("vas_adsr_process, %d samples per call, ns/sample (max error vs audio rate)\n", BENCH_BLOCKSIZE);
+    printf("%-24s", "control period");
+    for(int p = 0; p < 4; p++)
+        printf("%20d", periods[p]);
+    printf("\n");
+
+    for(int mode = 0; mode < 2; mode++)
+    {
+        printf("  %-22s", modeNames[mode]);
+        for(int p = 0; p < 4; p++)
+        {
+            float error = bench_adsrError(mode, periods[p], 0);
+
+            vas_adsr_modeswitch(adsr, mode);
+            vas_adsr_setControlPeriod(adsr, periods[p]);
+            vas_adsr_noteOn(adsr, 100);
+            vas_util_ffill(in1, 1, BENCH_BLOCKSIZE);
+            double start = bench_now();
+            for(int i = 0; i < BENCH_ITERATIONS; i++)
+                vas_adsr_process(adsr, in1, dest, BENCH_BLOCKSIZE);
+            double ns = (bench_now() - start) * 1e9 / ((double)BENCH_ITERATIONS * BENCH_BLOCKSIZE);
+            printf("%10.3f (%7.1e)", ns, error);
+        }
+        printf("\n");
+    }
+
+    printf("max error with steep curves (adsr 60 50 0.5 60, adsr_Q 8 0.2 8)\n");
+    for(int mode = 0; mode < 2; mode++)
+    {
+        printf("  %-22s", modeNames[mode]);
+        for(int p = 0; p < 4; p++)
+            printf("%20.1e", bench_adsrError(mode, periods[p], 1));
+        printf("\n");
+    }
+    printf("\n");
+    vas_adsr_free(adsr);
+}
+
+/* four envelopes in different stages, one after another and as one bank */
+static void bench_adsrBank(void)
+{
+    int sets[] = {VAS_UTIL_SCALAR, VAS_UTIL_SSE2, VAS_UTIL_AVX2, VAS_UTIL_NEON};
+    static float envelopes[VAS_ADSR_LANES][VAS_UTIL_CHUNK];
+    vas_adsr *adsrs[VAS_ADSR_LANES];
+
+    for(int k = 0; k < VAS_ADSR_LANES; k++)
+    {
+        adsrs[k] = vas_adsr_new(BENCH_SAMPLING_FREQUENCY);
+        vas_adsr_setADSR_values(adsrs[k], 99 - k, 98 - k, 0.5, 97 - k);
+        vas_adsr_set_Silent_time(adsrs[k], 99, 99 - k);
+        vas_adsr_noteOn(adsrs[k], 100);
+    }
+    vas_util_ffill(in1, 1, BENCH_BLOCKSIZE);
+
+    printf("4 x vas_adsr, %d samples per call, ns/sample of all four\n", BENCH_BLOCKSIZE);
+    printf("%-24s %12s %12s\n", "", "one by one", "bank");
+    for(int s = 0; s < 4; s++)
+    {
+        if(!vas_util_selectKernels(sets[s]))
+            continue;
+
+        double start = bench_now();
+        for(int i = 0; i < BENCH_ITERATIONS; i++)
+            for(int k = 0; k < VAS_ADSR_LANES; k++)
+                vas_adsr_process(adsrs[k], in1, dest, BENCH_BLOCKSIZE);
+        double single = (bench_now() - start) * 1e9 / ((double)BENCH_ITERATIONS * BENCH_BLOCKSIZE);
+
+        start = bench_now();
+        for(int i = 0; i < BENCH_ITERATIONS; i++)
+            vas_adsr_processBank(adsrs, 0xF, envelopes, BENCH_BLOCKSIZE);
+        double bank = (bench_now() - start) * 1e9 / ((double)BENCH_ITERATIONS * BENCH_BLOCKSIZE);
+
+        printf("  %-22s %12.3f %12.3f\n", vas_util_kernelName(sets[s]), single, bank);
+    }
+    printf("\n");
+    vas_util_init();
+    for(int k = 0; k < VAS_ADSR_LANES; k++)
+        vas_adsr_free(adsrs[k]);
+}
+
+/* the summed oscillators of algorithm 4, one after another and as lanes */
+static void bench_oscLanes(void)
+{
+    int sets[] = {VAS_UTIL_SCALAR, VAS_UTIL_SSE2, VAS_UTIL_AVX2, VAS_UTIL_NEON};
+    const char *pathNames[] = {"computed sine", "table lookup"};
+    static float waves[VAS_OSC_LANES][VAS_UTIL_CHUNK];
+    vas_osc *oscs[VAS_OSC_LANES];
+
+    for(int k = 0; k < VAS_OSC_LANES; k++)
+    {
+        oscs[k] = vas_osc_new(BENCH_SAMPLING_FREQUENCY, 220);
+        vas_osc_set_frequency_factor(oscs[k], 220, 1 + k * 0.51F);
+    }
+
+    printf("4 x vas_osc in MODE_SUM_WITH_IN, %d samples per call, ns/sample of all four\n", BENCH_BLOCKSIZE);
+    printf("%-24s %12s %12s\n", "", "one by one", "lanes");
+    for(int path = 0; path < 2; path++)
+    {
+        printf("  %s\n", pathNames[path]);
+        for(int k = 0; k < VAS_OSC_LANES; k++)
+            vas_osc_setSineLookup(oscs[k], path);
+        for(int s = 0; s < 4; s++)
+        {
+            if(!vas_util_selectKernels(sets[s]))
+                continue;
+            vas_util_ffill(in1, 0, BENCH_BLOCKSIZE);
+
+            double start = bench_now();
+            for(int i = 0; i < BENCH_ITERATIONS; i++)
+                for(int k = 0; k < VAS_OSC_LANES; k++)
+                    vas_osc_processSum(oscs[k], in1, in1, BENCH_BLOCKSIZE);
+            double single = (bench_now() - start) * 1e9 / ((double)BENCH_ITERATIONS * BENCH_BLOCKSIZE);
+
+            start = bench_now();
+            for(int i = 0; i < BENCH_ITERATIONS; i++)
+            {
+                vas_osc_processLanes(oscs, 0xF, waves, BENCH_BLOCKSIZE);
+                for(int k = 0; k < VAS_OSC_LANES; k++)
+                    vas_osc_applySum(oscs[k], waves[k], in1, in1, BENCH_BLOCKSIZE);
+            }
+            double lanes = (bench_now() - start) * 1e9 / ((double)BENCH_ITERATIONS * BENCH_BLOCKSIZE);
+
+            printf("    %-22s %12.3f %12.3f\n", vas_util_kernelName(sets[s]), single, lanes);
+        }
+    }
+    printf("\n");
+    vas_util_init();
+    for(int k = 0; k < VAS_OSC_LANES; k++)
+        vas_osc_free(oscs[k]);
+}
+
+/* creation time of the engine, as when a patch with many objects is opened */
+static void bench_load(void)
+{
+    static vas_fm *instances[BENCH_INSTANCES];
+
+    double start = bench_now();
+    for(int i = 0; i < BENCH_INSTANCES; i++)
+        instances[i] = vas_fm_new();
+    double created = bench_now();
+    for(int i = 0; i < BENCH_INSTANCES; i++)
+        vas_fm_free(instances[i]);
+    double freed = bench_now();
+
+    printf("patch load, %d instances of vas_fm\n", BENCH_INSTANCES);
+    printf("  %-24s %8.3f ms (%.1f us per instance)\n", "vas_fm_new", (created - start) * 1e3, (created - start) * 1e6 / BENCH_INSTANCES);
+    printf("  %-24s %8.3f ms\n\n", "vas_fm_free", (freed - created) * 1e3);
+}
+
+/* memory of the engine by category, as the mem message reports it */
+static void bench_memory(void)
+{
+    static vas_fm *instances[BENCH_INSTANCES];
+    vas_mem_stats before[VAS_MEM_ALL + 1], after[VAS_MEM_ALL + 1], freed;
+    float in[BENCH_BLOCKSIZE] = {0}, out[BENCH_BLOCKSIZE];
+
+    if(!vas_mem_tracking())
+    {
+        printf("memory of %d instances: not tracked, build with make MEMTRACK=1\n\n", BENCH_INSTANCES);
+        return;
+    }
+
+    for(int c = 0; c <= VAS_MEM_ALL; c++)
+        vas_mem_getStats(c, &before[c]);
+    for(int i = 0; i < BENCH_INSTANCES; i++)
+    {
+        instances[i] = vas_fm_new();
+        vas_fm_noteOn(instances[i], 440, 100);
+        vas_fm_process(instances[i], in, out, BENCH_BLOCKSIZE);
+    }
+    for(int c = 0; c <= VAS_MEM_ALL; c++)
+        vas_mem_getStats(c, &after[c]);
+    for(int i = 0; i < BENCH_INSTANCES; i++)
+        vas_fm_free(instances[i]);
+    vas_mem_getStats(VAS_MEM_ALL, &freed);
+
+    printf("memory of %d instances of vas_fm after one block\n", BENCH_INSTANCES);
+    printf("  %-22s %12s %12s %8s\n", "", "kB", "kB/instance", "blocks");
+    for(int c = 0; c <= VAS_MEM_ALL; c++)
+    {
+        long bytes = after[c].bytes - before[c].bytes;
+        printf("  %-22s %12.1f %12.1f %8ld\n", vas_mem_categoryName(c), bytes / 1024.,
+               bytes / 1024. / BENCH_INSTANCES, after[c].blocks - before[c].blocks);
+    }
+    printf("  %-22s %12ld bytes\n\n", "left after free", freed.bytes - before[VAS_MEM_ALL].bytes);
+}
+
+typedef struct bench_instance
+{
+    vas_fm *fm;
+    vas_pool_job job;
+    float in[BENCH_BLOCKSIZE];
+    float out[BENCH_BLOCKSIZE];
+} bench_instance;
+
+static void bench_render(void *arg)
+{
+    bench_instance *x = (bench_instance *)arg;
+    vas_fm_process(x->fm, x->in, x->out, BENCH_BLOCKSIZE);
+}
+
+/* DSP ticks of many instances, one after another as Pd runs them and pipelined on the pool as with "parallel 1" */
+static void bench_parallel(void)
+{
+    static bench_instance instances[BENCH_INSTANCES];
+    vas_pool *pool = vas_pool_acquire();
+    double sequential, parallel;
+
+    for(int i = 0; i < BENCH_INSTANCES; i++)
+    {
+        instances[i].fm = vas_fm_new();
+        /* uneven costs: every third instance runs all operators and envelopes */
+        for(int id = OSC2_ID; id <= OSC4_ID && i % 3 == 0; id++)
+            vas_fm_toggle_active(instances[i].fm, id);
+        for(int id = ADSR1_ID; id <= ADSR4_ID && i % 3 == 0; id++)
+            vas_fm_toggle_active(instances[i].fm, id);
+        vas_fm_noteOn(instances[i].fm, 110 + i, 100);
+        vas_pool_job_init(&instances[i].job, bench_render, &instances[i]);
+    }
+
+    double start = bench_now();
+    for(int tick = 0; tick < BENCH_TICKS; tick++)
+        for(int i = 0; i < BENCH_INSTANCES; i++)
+            bench_render(&instances[i]);
+    sequential = bench_now() - start;
+
+    start = bench_now();
+    for(int tick = 0; tick < BENCH_TICKS; tick++)
+    {
+        for(int i = 0; i < BENCH_INSTANCES; i++)
+        {
+            vas_pool_wait(&instances[i].job);
+            vas_pool_submit(pool, &instances[i].job);
+        }
+    }
+    for(int i = 0; i < BENCH_INSTANCES; i++)
+        vas_pool_forget(pool, &instances[i].job);
+    parallel = bench_now() - start;
+
+    printf("DSP tick of %d instances, %d samples, %d workers\n", BENCH_INSTANCES, BENCH_BLOCKSIZE, pool->workerCount);
+    printf("  %-24s %8.3f us per tick\n", "sequential", sequential * 1e6 / BENCH_TICKS);
+    printf("  %-24s %8.3f us per tick\n\n", "pool, one block late", parallel * 1e6 / BENCH_TICKS);
+
+    for(int i = 0; i < BENCH_INSTANCES; i++)
+        vas_fm_free(instances[i].fm);
+    vas_pool_release(pool);
+}
+
+int main(void)
+{
+    bench_kernels();
+    bench_sineAccuracy();
+    bench_osc();
+    bench_oscLanes();
+    bench_adsr();
+    bench_adsrBank();
+    bench_load();
+    bench_memory();
+    bench_parallel();
+    return 0;
+}
@@ -15,25 +15,41 @@
  * 
  */
 #include "m_pd.h"
-#include "vas_osc.h"
-#include "vas_adsr.h"
+#include <string.h>
+#include "vas_fm.h"
+#include "vas_recorder.h"
+#include "vas_trace.h"
+#include "vas_pool.h"
+#include "vas_governor.h"
+#include "vas_log.h"
+#include "vas_rtcheck.h"
 
-#define OSC1_ID 1
-#define OSC2_ID 2
-#define OSC3_ID 3
-#define OSC4_ID 4
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
 
-#define ADSR1_ID 11
-#define ADSR2_ID 12
-#define ADSR3_ID 13
-#define ADSR4_ID 14
+/** Not in the m_pd.h we build against, Pd 0.54 and newer understand it */
+#ifndef CLASS_MULTICHANNEL
+#define CLASS_MULTICHANNEL 0x10
+#endif
 
-#define ALG_1 1
-#define ALG_2 2
-#define ALG_3 3
-#define ALG_4 4
+/** Number of channels of the outlet in multichannel mode, one per operator */
+#define RTAP_TAPS 4
 
-#define SAMPLING_FREQUENCY 44100
+/** signal_setmultiout of Pd 0.54, looked up at load time so older Pd still loads the object */
+typedef void (*rtap_signal_setmultiout_t)(t_signal **sig, int nchans);
+static rtap_signal_setmultiout_t rtap_signal_setmultiout = NULL;
+
+/** Ring buffer capacity of the recorder in samples, about 6 seconds at 44.1 kHz */
+#define RTAP_RECORD_CAPACITY 262144
+/** Interval in ms in which overruns of the recorder are reported */
+#define RTAP_RECORD_REPORT_INTERVAL 1000
+/** Interval in ms in which finished table imports and ADSR curves are looked for */
+#define RTAP_IMPORT_POLL_INTERVAL 2
+/** Time in ms a part stays switched off before its tables are freed */
+#define RTAP_RELEASE_GRACE 10000
 
 static t_class *rtap_fmMultiOsc_tilde_class;
 
@@ -46,33 +62,126 @@ typedef struct rtap_fmMultiOsc_tilde
     t_object  x_obj;        /**< Necessary for every signal object in Pure Data*/
     t_sample f;             /**< Also necessary for signal objects, float dummy dataspace <br>* for converting a float to signal if no signal is connected (CLASS_MAINSIGNALIN) <br>*/
 
-    vas_osc *osc1;          /**< Pointer to oscillator 1*/
-    int osc1_active;        /**< active/not active Toggle for oscillator 1*/
-    vas_osc *osc2;          /**< Pointer to oscillator 2*/
-    int osc2_active;        /**< active/not active Toggle for oscillator 2*/
-    vas_osc *osc3;          /**< Pointer to oscillator 3*/
-    int osc3_active;        /**< active/not active Toggle for oscillator 3*/
-    vas_osc *osc4;          /**< Pointer to oscillator 4*/
-    int osc4_active;        /**< active/not active Toggle for oscillator 4*/
-    
-    vas_adsr *adsr1;        /**< Pointer to ADSR 1*/
-    int adsr1_active;       /**< active/not active Toggle for ADSR 1*/
-    vas_adsr *adsr2;        /**< Pointer to ADSR 2*/
-    int adsr2_active;       /**< active/not active Toggle for ADSR 2*/
-    vas_adsr *adsr3;        /**< Pointer to ADSR 3*/
-    int adsr3_active;       /**< active/not active Toggle for ADSR 3*/
-    vas_adsr *adsr4;        /**< Pointer to ADSR 4*/
-    int adsr4_active;       /**< active/not active Toggle for ADSR 4*/
-
-    float master_frequency; /**< Master frequency of fmMulitOsc*/     
-    float master_amp;       /**< Master amp of fmMulitOsc*/
-    int current_algorithm;  /**< current used Algorithm*/
+    vas_fm *fm;             /**< The FM engine with all oscillators and ADSRs*/
 
     t_word *table;          /**< Necessary for every signal object in Pure Data*/
+    t_symbol *tableRef[4];  /**< Array oscillator 1 ... 4 reads in place, NULL if none*/
+    vas_resample_job *import[4]; /**< Array being resampled for oscillator 1 ... 4, NULL if none*/
+    float *imported[4];     /**< Resampled table oscillator 1 ... 4 reads, NULL if none*/
+    t_clock *import_clock;  /**< Swaps finished imports in from the message thread*/
+    vas_adsr_curves *curves[4]; /**< Curves being computed for ADSR 1 ... 4, NULL if none*/
+    t_clock *curves_clock;  /**< Swaps finished curves in from the message thread*/
+    t_clock *release_clock; /**< Frees the tables of parts switched off for RTAP_RELEASE_GRACE*/
+
+    vas_recorder *recorder; /**< Disk recorder of the output, created on the first record message*/
+    t_clock *record_clock;  /**< Reports overruns of the recorder from the message thread*/
+    int record_overruns;    /**< Overruns already reported*/
+    t_canvas *canvas;       /**< The parent canvas, record paths are relative to its directory*/
+
+    int multichannel;       /**< 1 if the outlet carries the four operator taps as multichannel signal*/
+    t_sample *mix;          /**< Mixed output in multichannel mode, allocated in the dsp method*/
+    int mixSize;            /**< Size of mix in samples*/
+
+    int parallel;           /**< 1 if the blocks are rendered on the shared pool, one block late*/
+    vas_pool *pool;         /**< The shared worker pool while parallel is on*/
+    vas_pool_job job;       /**< Renders the block in flight on the pool*/
+    t_sample *pipe;         /**< Input, mix and RTAP_TAPS taps of the block in flight*/
+    int pipeSize;           /**< Size of pipe in samples*/
+    int pipeBlock;          /**< Block size of the block in flight*/
+    int pipeTaps;           /**< 1 if the block in flight also renders the taps*/
+
+    vas_governor *governor; /**< The CPU budget shared by all instances*/
+    vas_governor_voice voice; /**< Registration of this instance as a voice of the governor*/
+    int tier;               /**< Quality tier applied to the engine*/
+    int audible;            /**< 1 if the next block is rendered, 0 while the governor drops this voice*/
+    int wasAudible;         /**< audible of the previous block, a change fades the block in or out*/
+    double renderSeconds;   /**< Time the last block took on the pool*/
+    double blockSeconds;    /**< Duration of one block, set by the dsp method*/
+    t_clock *governor_clock; /**< Reports tier changes from the message thread*/
+    t_clock *log_clock;     /**< Posts the messages of vas_log from the message thread*/
+    int reportedTier;       /**< Tier last sent to the control outlet*/
+    int reportedAudible;    /**< audible last sent to the control outlet*/
     
+
     t_outlet *out;          /**< A signal outlet for the adjusted signal*/
+    t_outlet *control;      /**< A control outlet for the decisions of the governor*/
 } rtap_fmMultiOsc_tilde;
 
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Applies the decisions of the governor before a block. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param n The block size <br>
+ * Accounts the block rendered on the pool, switches the engine to the current
+ * tier and decides whether the next block is audible. Changes are reported on
+ * the control outlet by the governor clock. The LFOs are moved on here too,
+ * as this runs on the scheduler thread even if the block is rendered on the pool. <br>
+ */
+static void rtap_fmMultiOsc_tilde_govern(rtap_fmMultiOsc_tilde *x, int n)
+{
+    vas_governor *g = x->governor;
+
+    vas_governor_enter(g, clock_getlogicaltime());
+    if(x->parallel)
+        vas_governor_account(g, x->renderSeconds, x->blockSeconds);
+
+    if(g->tier != x->tier)
+    {
+        x->tier = g->tier;
+        vas_fm_setQuality(x->fm, x->tier >= VAS_GOVERNOR_TIER_LOOKUP,
+                          x->tier >= VAS_GOVERNOR_TIER_CONTROLRATE ? VAS_GOVERNOR_CONTROLPERIOD : 1);
+    }
+    x->audible = x->voice.active;
+    vas_fm_advanceLFOs(x->fm, clock_getlogicaltime(), n, x->blockSeconds);
+
+    if(x->tier != x->reportedTier || x->audible != x->reportedAudible)
+        clock_delay(x->governor_clock, 0);
+    if(vas_log_pending())
+        clock_delay(x->log_clock, 0);
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Renders one block unless the governor dropped this voice. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param in The input vector <br>
+ * @param out The mixed output, may be identical to in <br>
+ * @param taps RTAP_TAPS vectors for the operator taps or NULL <br>
+ * @param n The block size <br>
+ * A dropped voice outputs silence, the block in which it is dropped or
+ * rendered again is faded out or in. <br>
+ * @return the time the block took in seconds <br>
+ */
+static double rtap_fmMultiOsc_tilde_process(rtap_fmMultiOsc_tilde *x, t_sample *in, t_sample *out, float **taps, int n)
+{
+    double start = vas_governor_now();
+    int audible = x->audible;
+
+    if(!audible && !x->wasAudible)
+    {
+        memset(out, 0, n * sizeof(t_sample));
+        for(int i = 0; taps && i < RTAP_TAPS; i++)
+            memset(taps[i], 0, n * sizeof(t_sample));
+        return vas_governor_now() - start;
+    }
+
+    vas_fm_processTaps(x->fm, in, out, taps, n);
+
+    if(audible != x->wasAudible)
+    {
+        float step = 1.0F / n;
+        for(int k = 0; k < n; k++)
+        {
+            float gain = audible ? k * step : 1 - k * step;
+            out[k] *= gain;
+            for(int i = 0; taps && i < RTAP_TAPS; i++)
+                taps[i][k] *= gain;
+        }
+        x->wasAudible = audible;
+    }
+    return vas_governor_now() - start;
+}
+
 /**
  * @related rtap_fmMultiOsc_tilde
  * @brief performs choosen algorithm<br>
@@ -88,13 +197,140 @@ t_int *rtap_fmMultiOsc_tilde_perform(t_int *w)
     t_sample  *out =  (t_sample *)(w[3]);
     int n =  (int)(w[4]);
     
-    rtap_fmMultiOsc_tilde_root_algoritm(x,in,out,n);
-    rtap_fmMultiOsc_tilde_gainstage(x,in,out,n);
+    VAS_TRACE_BEGIN("perform");
+    VAS_RTCHECK_ENTER();
+    rtap_fmMultiOsc_tilde_govern(x, n);
+    vas_governor_account(x->governor, rtap_fmMultiOsc_tilde_process(x, in, out, NULL, n), x->blockSeconds);
+
+    if(x->recorder)
+        vas_recorder_write(x->recorder, out, n);
+    VAS_RTCHECK_LEAVE();
+    VAS_TRACE_END("perform");
 
     /* return a pointer to the dataspace for the next dsp-object */
     return (w+5);
 }
 
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief performs choosen algorithm and writes the operator taps to a multichannel outlet<br>
+ * @param w A pointer to the object, input vector, output vector with RTAP_TAPS channels and the block size. <br>
+ * The mixed signal only goes to the recorder. <br>
+ * @return A pointer to the signal chain right behind the rtap_fmMultiOsc_tilde object. <br>
+ */
+t_int *rtap_fmMultiOsc_tilde_performTaps(t_int *w)
+{
+    rtap_fmMultiOsc_tilde *x = (rtap_fmMultiOsc_tilde *)(w[1]);
+    t_sample  *in = (t_sample *)(w[2]);
+    t_sample  *out =  (t_sample *)(w[3]);
+    int n =  (int)(w[4]);
+    float *taps[RTAP_TAPS];
+
+    for(int i = 0; i < RTAP_TAPS; i++)
+        taps[i] = out + i * n;
+
+    VAS_TRACE_BEGIN("perform");
+    VAS_RTCHECK_ENTER();
+    rtap_fmMultiOsc_tilde_govern(x, n);
+    vas_governor_account(x->governor, rtap_fmMultiOsc_tilde_process(x, in, x->mix, taps, n), x->blockSeconds);
+
+    if(x->recorder)
+        vas_recorder_write(x->recorder, x->mix, n);
+    VAS_RTCHECK_LEAVE();
+    VAS_TRACE_END("perform");
+
+    return (w+5);
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Renders the block in flight, runs on a worker of the pool. <br>
+ * @param arg A pointer to the object <br>
+ */
+static void rtap_fmMultiOsc_tilde_render(void *arg)
+{
+    rtap_fmMultiOsc_tilde *x = (rtap_fmMultiOsc_tilde *)arg;
+    int n = x->pipeBlock;
+    float *taps[RTAP_TAPS];
+
+    for(int i = 0; i < RTAP_TAPS; i++)
+        taps[i] = x->pipe + (2 + i) * n;
+
+    VAS_TRACE_BEGIN("render");
+    VAS_RTCHECK_ENTER();
+    x->renderSeconds = rtap_fmMultiOsc_tilde_process(x, x->pipe, x->pipe + n, x->pipeTaps ? taps : NULL, n);
+    VAS_RTCHECK_LEAVE();
+    VAS_TRACE_END("render");
+}
+
+/* 1 if an oscillator reads an array in place, see osc_table_ref */
+static int rtap_fmMultiOsc_tilde_hasRefs(rtap_fmMultiOsc_tilde *x)
+{
+    for(int i = 0; i < 4; i++)
+        if(x->tableRef[i])
+            return 1;
+    return 0;
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Waits until the block in flight is rendered. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * Every message that touches the engine calls this first, so a worker never
+ * renders while the engine is changed. <br>
+ */
+static void rtap_fmMultiOsc_tilde_sync(rtap_fmMultiOsc_tilde *x)
+{
+    vas_pool_wait(&x->job);
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Outputs the block rendered since the last tick and queues the next one<br>
+ * @param w A pointer to the object, input vector, output vector and the block size. <br>
+ * The output is one block late. If the pool has not finished the previous block
+ * yet, it is finished here. The governor is charged with the time the block
+ * took on the pool, not with the time spent here. <br>
+ * While an oscillator reads an array in place, the next block is rendered
+ * here instead: Pd frees or moves the storage of a resized or deleted array
+ * between two ticks, before the dsp method can wait for the pool. <br>
+ * @return A pointer to the signal chain right behind the rtap_fmMultiOsc_tilde object. <br>
+ */
+t_int *rtap_fmMultiOsc_tilde_performParallel(t_int *w)
+{
+    rtap_fmMultiOsc_tilde *x = (rtap_fmMultiOsc_tilde *)(w[1]);
+    t_sample  *in = (t_sample *)(w[2]);
+    t_sample  *out =  (t_sample *)(w[3]);
+    int n =  (int)(w[4]);
+    t_sample *mix = x->pipe + n;
+
+    VAS_TRACE_BEGIN("perform");
+    VAS_RTCHECK_ENTER();
+    vas_pool_wait(&x->job);
+
+    /* in may share its memory with out */
+    vas_util_fcopy(in, x->pipe, n);
+    if(x->pipeTaps)
+        vas_util_fcopy(x->pipe + 2 * n, out, RTAP_TAPS * n);
+    else
+        vas_util_fcopy(mix, out, n);
+
+    if(x->recorder)
+        vas_recorder_write(x->recorder, mix, n);
+
+    rtap_fmMultiOsc_tilde_govern(x, n);
+    if(rtap_fmMultiOsc_tilde_hasRefs(x))
+        rtap_fmMultiOsc_tilde_render(x);
+    else
+        vas_pool_submit(x->pool, &x->job);
+    VAS_RTCHECK_LEAVE();
+    VAS_TRACE_END("perform");
+
+    return (w+5);
+}
+
+static void rtap_fmMultiOsc_tilde_bindRef(rtap_fmMultiOsc_tilde *x, int id);
+
 /**
  * @related rtap_fmMultiOsc_tilde
  * @brief Adds rtap_fmMultiOsc_tilde_perform to the signal chain. <br>
@@ -104,7 +340,48 @@ t_int *rtap_fmMultiOsc_tilde_perform(t_int *w)
  */
 void rtap_fmMultiOsc_tilde_dsp(rtap_fmMultiOsc_tilde *x, t_signal **sp)
 {
-    dsp_add(rtap_fmMultiOsc_tilde_perform, 4, x, sp[0]->s_vec, sp[1]->s_vec, sp[0]->s_n);
+    int n = sp[0]->s_n;
+
+    rtap_fmMultiOsc_tilde_sync(x);
+    x->blockSeconds = n / sp[0]->s_sr;
+
+    /* the storage of a referenced array moves when it is resized */
+    for(int id = OSC1_ID; id <= OSC4_ID; id++)
+        if(x->tableRef[id - OSC1_ID])
+            rtap_fmMultiOsc_tilde_bindRef(x, id);
+
+    if(x->parallel)
+    {
+        int size = (2 + RTAP_TAPS) * n;
+
+        x->pipeTaps = x->multichannel && rtap_signal_setmultiout;
+        if(rtap_signal_setmultiout)
+            rtap_signal_setmultiout(&sp[1], x->pipeTaps ? RTAP_TAPS : 1);
+        if(x->pipeSize != size)
+        {
+            x->pipe = (t_sample *)resizebytes(x->pipe, x->pipeSize * sizeof(t_sample), size * sizeof(t_sample));
+            x->pipeSize = size;
+        }
+        x->pipeBlock = n;
+        dsp_add(rtap_fmMultiOsc_tilde_performParallel, 4, x, sp[0]->s_vec, sp[1]->s_vec, n);
+        return;
+    }
+
+    if(x->multichannel && rtap_signal_setmultiout)
+    {
+        rtap_signal_setmultiout(&sp[1], RTAP_TAPS);
+        if(x->mixSize != n)
+        {
+            x->mix = (t_sample *)resizebytes(x->mix, x->mixSize * sizeof(t_sample), n * sizeof(t_sample));
+            x->mixSize = n;
+        }
+        dsp_add(rtap_fmMultiOsc_tilde_performTaps, 4, x, sp[0]->s_vec, sp[1]->s_vec, n);
+        return;
+    }
+
+    if(rtap_signal_setmultiout)
+        rtap_signal_setmultiout(&sp[1], 1);
+    dsp_add(rtap_fmMultiOsc_tilde_perform, 4, x, sp[0]->s_vec, sp[1]->s_vec, n);
 }
 
 /**
@@ -113,19 +390,49 @@ void rtap_fmMultiOsc_tilde_dsp(rtap_fmMultiOsc_tilde *x, t_signal **sp)
  * @param x A pointer the rtap_fmMultiOsc_tilde object <br>
  * For more information please refer to the <a href = "https://github.com/pure-data/externals-howto" > Pure Data Docs </a> <br>
  */
+void rtap_fmMultiOsc_tilde_record_tick(rtap_fmMultiOsc_tilde *x);
+void rtap_fmMultiOsc_tilde_governor_tick(rtap_fmMultiOsc_tilde *x);
+void rtap_fmMultiOsc_tilde_log_tick(rtap_fmMultiOsc_tilde *x);
+void rtap_fmMultiOsc_tilde_import_tick(rtap_fmMultiOsc_tilde *x);
+void rtap_fmMultiOsc_tilde_curves_tick(rtap_fmMultiOsc_tilde *x);
+void rtap_fmMultiOsc_tilde_release_tick(rtap_fmMultiOsc_tilde *x);
+static void rtap_fmMultiOsc_tilde_unref(rtap_fmMultiOsc_tilde *x, int id);
+
 void rtap_fmMultiOsc_tilde_free(rtap_fmMultiOsc_tilde *x)
 {
+    if(x->pool)
+    {
+        vas_pool_forget(x->pool, &x->job);
+        vas_pool_release(x->pool);
+    }
+    if(x->pipe)
+        freebytes(x->pipe, x->pipeSize * sizeof(t_sample));
+
     outlet_free(x->out);
+    outlet_free(x->control);
+
+    clock_free(x->governor_clock);
+    clock_free(x->log_clock);
+    vas_governor_removeVoice(x->governor, &x->voice);
+    vas_governor_release(x->governor);
 
-    vas_osc_free(x->osc1);
-    vas_osc_free(x->osc2);
-    vas_osc_free(x->osc3);
-    vas_osc_free(x->osc4);
+    clock_free(x->record_clock);
+    if(x->mix)
+        freebytes(x->mix, x->mixSize * sizeof(t_sample));
+    if(x->recorder)
+        vas_recorder_free(x->recorder);
 
-    vas_osc_free(x->adsr1);
-    vas_osc_free(x->adsr2);
-    vas_osc_free(x->adsr3);
-    vas_osc_free(x->adsr4);
+    clock_free(x->import_clock);
+    clock_free(x->curves_clock);
+    clock_free(x->release_clock);
+    for(int k = 0; k < 4; k++)
+        vas_adsr_curves_cancel(x->curves[k]);
+    for(int id = OSC1_ID; id <= OSC4_ID; id++)
+        rtap_fmMultiOsc_tilde_unref(x, id);
+    for(int k = 0; k < 4; k++)
+        vas_lfo_release(x->fm->lfo[k]);
+
+    vas_fm_free(x->fm);
 }
 
 /**
@@ -140,34 +447,48 @@ void *rtap_fmMultiOsc_tilde_new(t_floatarg f)
     
     //The main inlet is created automatically
     x->out = outlet_new(&x->x_obj, &s_signal);
+    x->control = outlet_new(&x->x_obj, 0);
 
-    x->master_amp=1;
-    x->master_frequency=440;
-    x->current_algorithm=ALG_1;
-
-    x->osc1 = vas_osc_new(SAMPLING_FREQUENCY,x->master_frequency);
-    x->osc1_active = 1;
-
-    x->osc2 = vas_osc_new(SAMPLING_FREQUENCY,x->master_frequency);
-    x->osc2_active = 0;
-
-    x->osc3 = vas_osc_new(SAMPLING_FREQUENCY,x->master_frequency);
-    x->osc3_active = 0;
-
-    x->osc4 = vas_osc_new(SAMPLING_FREQUENCY,x->master_frequency);
-    x->osc4_active = 0;
+    x->fm = vas_fm_new();
+    for(int i = 0; i < 4; i++)
+    {
+        x->tableRef[i] = NULL;
+        x->import[i] = NULL;
+        x->imported[i] = NULL;
+        x->curves[i] = NULL;
+    }
+    x->import_clock = clock_new(x, (t_method)rtap_fmMultiOsc_tilde_import_tick);
+    x->curves_clock = clock_new(x, (t_method)rtap_fmMultiOsc_tilde_curves_tick);
+    x->release_clock = clock_new(x, (t_method)rtap_fmMultiOsc_tilde_release_tick);
 
-    x->adsr1 = vas_adsr_new(SAMPLING_FREQUENCY);
-    x->adsr1_active = 0;
+    x->recorder = NULL;
+    x->record_clock = clock_new(x, (t_method)rtap_fmMultiOsc_tilde_record_tick);
+    x->record_overruns = 0;
+    x->canvas = canvas_getcurrent();
 
-    x->adsr2 = vas_adsr_new(SAMPLING_FREQUENCY);
-    x->adsr2_active = 0;
+    x->multichannel = 0;
+    x->mix = NULL;
+    x->mixSize = 0;
 
-    x->adsr3 = vas_adsr_new(SAMPLING_FREQUENCY);
-    x->adsr3_active = 0;
+    x->parallel = 0;
+    x->pool = NULL;
+    vas_pool_job_init(&x->job, rtap_fmMultiOsc_tilde_render, x);
+    x->pipe = NULL;
+    x->pipeSize = 0;
+    x->pipeBlock = 0;
+    x->pipeTaps = 0;
 
-    x->adsr4 = vas_adsr_new(SAMPLING_FREQUENCY);
-    x->adsr4_active = 0;
+    x->governor = vas_governor_acquire();
+    vas_governor_addVoice(x->governor, &x->voice);
+    x->tier = 0;
+    x->audible = 1;
+    x->wasAudible = 1;
+    x->renderSeconds = 0;
+    x->blockSeconds = 0;
+    x->governor_clock = clock_new(x, (t_method)rtap_fmMultiOsc_tilde_governor_tick);
+    x->log_clock = clock_new(x, (t_method)rtap_fmMultiOsc_tilde_log_tick);
+    x->reportedTier = 0;
+    x->reportedAudible = 1;
 
     return (void *)x;
 }
@@ -201,64 +522,85 @@ void rtap_fmMultiOsc_tilde_getArray(rtap_fmMultiOsc_tilde *x, t_symbol *arraynam
     }
 }
 
+/* forgets the array or the imported table of an oscillator, called whenever the oscillator gets another table */
+static void rtap_fmMultiOsc_tilde_unref(rtap_fmMultiOsc_tilde *x, int id)
+{
+    int index = id - OSC1_ID;
+
+    if(id < OSC1_ID || id > OSC4_ID)
+        return;
+
+    x->tableRef[index] = NULL;
+    vas_resample_cancel(x->import[index]);
+    x->import[index] = NULL;
+    vas_mem_free(x->imported[index]);
+    x->imported[index] = NULL;
+}
+
 /**
  * @related rtap_fmMultiOsc_tilde
- * @brief Performs current algorithm. <br>
- * @param x A pointer the rtap_fmMultiOsc_tilde object. <br>
- * @param in The input vector <br>
- * @param out The output vector <br>
- * @param n The size of the i/o vectors <br>
- * Performs current chosen algorithm. <br>
- */
-void rtap_fmMultiOsc_tilde_root_algoritm(rtap_fmMultiOsc_tilde *x, float *in, float *out, int n)
-{
-        switch ((int)x->current_algorithm){
-            case ALG_1 :
-                rtap_fmMultiOsc_tilde_alg1(x,in,out,n);
-                break;
-            case ALG_2 : 
-                rtap_fmMultiOsc_tilde_alg2(x,in,out,n);
-                break;
-             case ALG_3 : 
-                rtap_fmMultiOsc_tilde_alg3(x,in,out,n);
-                break;
-            case ALG_4 :
-                rtap_fmMultiOsc_tilde_alg4(x,in,out,n);
-                break;  
+ * @brief Points an oscillator at the current storage of its referenced array. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param id id of the oscillator<br>
+ * The array is marked as used in DSP, so Pd restarts DSP (and calls this again
+ * from the dsp method) when it is resized. If the array is gone the oscillator
+ * falls back to the sine. <br>
+ */
+static void rtap_fmMultiOsc_tilde_bindRef(rtap_fmMultiOsc_tilde *x, int id)
+{
+    t_symbol *name = x->tableRef[id - OSC1_ID];
+    t_garray *a;
+    t_word *words;
+    int length;
+
+    if(!(a = (t_garray *)pd_findbyclass(name, garray_class)) || !garray_getfloatwords(a, &length, &words) || length < 1)
+    {
+        pd_error(x, "rtap_fmMultiOsc~: osc_table_ref: %s: no such array", name->s_name);
+        rtap_fmMultiOsc_tilde_unref(x, id);
+        vas_fm_reset_waveform(x->fm, id);
+        return;
     }
+
+    garray_usedindsp(a);
+    vas_fm_referenceTable(x->fm, id, &words[0].w_float, length, sizeof(t_word) / sizeof(t_float));
 }
 
 /**
  * @related rtap_fmMultiOsc_tilde
- * @brief Updates the lookuptables of oscillator. <br>
+ * @brief Swaps the tables of finished imports in. <br>
  * @param x My rtap_fmMultiOsc_tilde object <br>
- * @param id id of the oscillator<br>
- * Updates the lookuptables of oscillator. <br>
- */
-void rtap_fmMultiOsc_tilde_write2FloatArray_osc(rtap_fmMultiOsc_tilde *x, float id)
-{
-    switch ((int)id){
-        case OSC1_ID :
-            for (int i=0;i<44100; i++)
-            {
-                x->osc1->lookupTable[i] = x->table[i].w_float;
-            }
-        case OSC2_ID :
-             for (int i=0;i<44100; i++)
-            {
-                x->osc2->lookupTable[i] = x->table[i].w_float;
-            }
-        case OSC3_ID :
-             for (int i=0;i<44100; i++)
-            {
-                x->osc3->lookupTable[i] = x->table[i].w_float;
-            }
-        case OSC4_ID :
-             for (int i=0;i<44100; i++)
-            {
-                x->osc4->lookupTable[i] = x->table[i].w_float;
-            }    
+ * Runs on the Pd clock while imports are being resampled, the oscillator
+ * keeps its previous table until then. <br>
+ */
+void rtap_fmMultiOsc_tilde_import_tick(rtap_fmMultiOsc_tilde *x)
+{
+    int pending = 0;
+
+    for(int id = OSC1_ID; id <= OSC4_ID; id++)
+    {
+        vas_resample_job *job = x->import[id - OSC1_ID];
+        float *table;
+        int size;
+
+        if(!job)
+            continue;
+        if(!vas_resample_done(job))
+        {
+            pending = 1;
+            continue;
+        }
+
+        x->import[id - OSC1_ID] = NULL;
+        table = vas_resample_finish(job, &size);
+
+        rtap_fmMultiOsc_tilde_sync(x);
+        rtap_fmMultiOsc_tilde_unref(x, id);
+        vas_fm_referenceTable(x->fm, id, table, size, 1);
+        x->imported[id - OSC1_ID] = table;
     }
+
+    if(pending)
+        clock_delay(x->import_clock, RTAP_IMPORT_POLL_INTERVAL);
 }
 
 /**
@@ -267,14 +609,137 @@ void rtap_fmMultiOsc_tilde_write2FloatArray_osc(rtap_fmMultiOsc_tilde *x, float
  * @param x My rtap_fmMultiOsc_tilde object <br>
  * @param name name of array<br>
  * @param id id of oscillator<br>
- * Updates lookUptable from pd array. <br>
+ * The array holds one cycle of any length. It is copied and resampled to a
+ * power of two (see vas_resample.h) on a thread of its own, the oscillator
+ * switches to the new table as soon as it is ready. <br>
  */
 void rtap_fmMultiOsc_tilde_setExternTable(rtap_fmMultiOsc_tilde *x, t_symbol *name, float id)
 {
     int length = 0;
+    int index = (int)id - OSC1_ID;
+
+    if(!vas_fm_getOsc(x->fm, (int)id))
+        return;
+
+    VAS_TRACE_BEGIN("osc_table");
     rtap_fmMultiOsc_tilde_getArray(x, name, &x->table, &length);
-    rtap_fmMultiOsc_tilde_write2FloatArray_osc(x,id);
+    if(x->table && length > 0)
+    {
+        /* a newer import of the same oscillator wins */
+        vas_resample_cancel(x->import[index]);
+        x->import[index] = vas_resample_start(&x->table[0].w_float, length, sizeof(t_word) / sizeof(t_float));
+        if(x->import[index])
+            clock_delay(x->import_clock, RTAP_IMPORT_POLL_INTERVAL);
+        else
+            pd_error(x, "rtap_fmMultiOsc~: osc_table: could not start the import of %s", name->s_name);
+    }
+    VAS_TRACE_END("osc_table");
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Lets an oscillator read a pd array in place. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param name name of array<br>
+ * @param id id of oscillator<br>
+ * Unlike osc_table nothing is copied: edits to the array are heard right away
+ * and several oscillators and objects can share one array. One cycle is the
+ * whole array, whatever its size. <br>
+ */
+void rtap_fmMultiOsc_tilde_setTableRef(rtap_fmMultiOsc_tilde *x, t_symbol *name, float id)
+{
+    if(!vas_fm_getOsc(x->fm, (int)id))
+        return;
+
+    rtap_fmMultiOsc_tilde_sync(x);
+    rtap_fmMultiOsc_tilde_unref(x, (int)id);
+    x->tableRef[(int)id - OSC1_ID] = name;
+    rtap_fmMultiOsc_tilde_bindRef(x, (int)id);
+}
+
+/* finds a file like an abstraction, path receives VAS_WAVETABLE_PATHSIZE chars, returns 0 if not found */
+static int rtap_fmMultiOsc_tilde_findFile(rtap_fmMultiOsc_tilde *x, t_symbol *name, char *path)
+{
+    char dir[VAS_WAVETABLE_PATHSIZE], *file;
+    int fd = canvas_open(x->canvas, name->s_name, "", dir, &file, VAS_WAVETABLE_PATHSIZE, 1);
+
+    if(fd < 0)
+    {
+        pd_error(x, "rtap_fmMultiOsc~: %s: can't open", name->s_name);
+        return 0;
+    }
+    sys_close(fd);
+    if(snprintf(path, VAS_WAVETABLE_PATHSIZE, "%s/%s", dir, file) >= VAS_WAVETABLE_PATHSIZE)
+    {
+        pd_error(x, "rtap_fmMultiOsc~: %s: path too long", name->s_name);
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Lets an oscillator read a waveform of a wavetable library file. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param name file name of the library, searched like an abstraction <br>
+ * @param id id of oscillator<br>
+ * @param index waveform in the library<br>
+ * The file is mapped read-only and shared by all objects and Pd processes
+ * using it, nothing is copied. <br>
+ */
+void rtap_fmMultiOsc_tilde_setWavetable(rtap_fmMultiOsc_tilde *x, t_symbol *name, float id, float index)
+{
+    char path[VAS_WAVETABLE_PATHSIZE];
+
+    rtap_fmMultiOsc_tilde_sync(x);
+
+    if(!rtap_fmMultiOsc_tilde_findFile(x, name, path))
+        return;
+
+    VAS_TRACE_BEGIN("osc_wavetable");
+    if(vas_fm_setWavetable(x->fm, (int)id, path, (int)index))
+        rtap_fmMultiOsc_tilde_unref(x, (int)id);
+    else
+        pd_error(x, "rtap_fmMultiOsc~: %s: no wavetable library or no waveform %d", path, (int)index);
+    VAS_TRACE_END("osc_wavetable");
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Lets an oscillator morph between the waveforms of a wavetable library file. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param name file name of the library, searched like an abstraction <br>
+ * @param id id of oscillator<br>
+ * The waveforms are the frames of the morph, osc_position selects between them. <br>
+ */
+void rtap_fmMultiOsc_tilde_setMorph(rtap_fmMultiOsc_tilde *x, t_symbol *name, float id)
+{
+    char path[VAS_WAVETABLE_PATHSIZE];
+
+    rtap_fmMultiOsc_tilde_sync(x);
+
+    if(!rtap_fmMultiOsc_tilde_findFile(x, name, path))
+        return;
+
+    VAS_TRACE_BEGIN("osc_morph");
+    if(vas_fm_setMorph(x->fm, (int)id, path))
+        rtap_fmMultiOsc_tilde_unref(x, (int)id);
+    else
+        pd_error(x, "rtap_fmMultiOsc~: %s: no wavetable library", path);
+    VAS_TRACE_END("osc_morph");
+}
 
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Sets the morph position of oscillator. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param id id of oscillator<br>
+ * @param position frame of the library, fractions crossfade between neighbouring frames<br>
+ */
+void rtap_fmMultiOsc_tilde_osc_setPosition(rtap_fmMultiOsc_tilde *x, float id, float position)
+{
+    rtap_fmMultiOsc_tilde_sync(x);
+    vas_fm_osc_setPosition(x->fm, (int)id, position);
 }
 
 /**
@@ -288,16 +753,8 @@ void rtap_fmMultiOsc_tilde_setExternTable(rtap_fmMultiOsc_tilde *x, t_symbol *na
  */
 void rtap_fmMultiOsc_tilde_osc_setFrequency(rtap_fmMultiOsc_tilde *x,float id, float frequency_factor)
 {
-    switch ((int)id){
-        case OSC1_ID :
-            vas_osc_set_frequency_factor(x->osc1,x->master_frequency,frequency_factor);
-        case OSC2_ID :
-            vas_osc_set_frequency_factor(x->osc2,x->master_frequency,frequency_factor);
-        case OSC3_ID :
-            vas_osc_set_frequency_factor(x->osc3,x->master_frequency,frequency_factor);
-        case OSC4_ID :
-           vas_osc_set_frequency_factor(x->osc4,x->master_frequency,frequency_factor);
-    }
+    rtap_fmMultiOsc_tilde_sync(x);
+    vas_fm_osc_setFrequency(x->fm, (int)id, frequency_factor);
 }
 
 /**
@@ -309,11 +766,8 @@ void rtap_fmMultiOsc_tilde_osc_setFrequency(rtap_fmMultiOsc_tilde *x,float id, f
  */
 void rtap_fmMultiOsc_tilde_osc_set_Master_Frequency(rtap_fmMultiOsc_tilde *x, float master_frequency)
 {
-    x->master_frequency=master_frequency;
-    vas_osc_set_master_frequency(x->osc1,x-> master_frequency);
-    vas_osc_set_master_frequency(x->osc2,x-> master_frequency);
-    vas_osc_set_master_frequency(x->osc3,x-> master_frequency);
-    vas_osc_set_master_frequency(x->osc4,x-> master_frequency);
+    rtap_fmMultiOsc_tilde_sync(x);
+    vas_fm_osc_set_Master_Frequency(x->fm, master_frequency);
 }
 
 /**
@@ -326,16 +780,8 @@ void rtap_fmMultiOsc_tilde_osc_set_Master_Frequency(rtap_fmMultiOsc_tilde *x, fl
  */
 void rtap_fmMultiOsc_tilde_osc_setAmp(rtap_fmMultiOsc_tilde *x, float id, float amp_factor)
 {
-    switch ((int)id){
-        case OSC1_ID :
-            vas_osc_setAmp(x->osc1, amp_factor);
-        case OSC2_ID :
-            vas_osc_setAmp(x->osc2, amp_factor);
-        case OSC3_ID :
-            vas_osc_setAmp(x->osc3, amp_factor);
-        case OSC4_ID :
-            vas_osc_setAmp(x->osc4, amp_factor);
-    }
+    rtap_fmMultiOsc_tilde_sync(x);
+    vas_fm_osc_setAmp(x->fm, (int)id, amp_factor);
 }
 
 /**
@@ -347,7 +793,8 @@ void rtap_fmMultiOsc_tilde_osc_setAmp(rtap_fmMultiOsc_tilde *x, float id, float
  */
 void rtap_fmMultiOsc_tilde_osc_set_Master_Amp(rtap_fmMultiOsc_tilde *x, float master_amp)
 {
-    x->master_amp=master_amp;
+    rtap_fmMultiOsc_tilde_sync(x);
+    vas_fm_osc_set_Master_Amp(x->fm, master_amp);
 }
 
 /**
@@ -363,16 +810,10 @@ void rtap_fmMultiOsc_tilde_osc_set_Master_Amp(rtap_fmMultiOsc_tilde *x, float ma
  */
 void rtap_fmMultiOsc_tilde_setADSR(rtap_fmMultiOsc_tilde *x, float a, float d, float s, float r, float id)
 {
-    switch ((int)id){
-        case ADSR1_ID :
-            vas_adsr_setADSR_values(x->adsr1, a,d,s,r);
-        case ADSR2_ID :
-            vas_adsr_setADSR_values(x->adsr2, a,d,s,r);
-        case ADSR3_ID :
-            vas_adsr_setADSR_values(x->adsr3, a,d,s,r);
-        case ADSR4_ID :
-            vas_adsr_setADSR_values(x->adsr4, a,d,s,r);    
-    }
+    rtap_fmMultiOsc_tilde_sync(x);
+    VAS_TRACE_BEGIN("adsr");
+    vas_fm_setADSR(x->fm, a, d, s, r, (int)id);
+    VAS_TRACE_END("adsr");
 }
 
 /**
@@ -386,16 +827,8 @@ void rtap_fmMultiOsc_tilde_setADSR(rtap_fmMultiOsc_tilde *x, float a, float d, f
  */
 void rtap_fmMultiOsc_tilde_set_Silent_time(rtap_fmMultiOsc_tilde *x, float st,float sus_t, float id)
 {
-    switch ((int)id){
-        case ADSR1_ID :
-            vas_adsr_set_Silent_time(x->adsr1,st,sus_t);
-        case ADSR2_ID :
-            vas_adsr_set_Silent_time(x->adsr2,st,sus_t);
-        case ADSR3_ID :
-            vas_adsr_set_Silent_time(x->adsr3,st,sus_t);
-        case ADSR4_ID :
-            vas_adsr_set_Silent_time(x->adsr4,st,sus_t);
-    }
+    rtap_fmMultiOsc_tilde_sync(x);
+    vas_fm_set_Silent_time(x->fm, st, sus_t, (int)id);
 }
 
 /**
@@ -406,20 +839,182 @@ void rtap_fmMultiOsc_tilde_set_Silent_time(rtap_fmMultiOsc_tilde *x, float st,fl
  * @param d parameter for Q-decay<br>
  * @param r parameter for Q-release<br>
  * @param id id of adsr<br>
- * Sets Q-ADR parameters of adsr object. <br>
+ * Sets Q-ADR parameters of adsr object. The curves are computed on a thread
+ * of their own, the ADSR keeps its previous q-values until they are ready. <br>
  */
 void rtap_fmMultiOsc_tilde_setADSR_Q(rtap_fmMultiOsc_tilde *x, float a, float d, float r, float id)
 {
-    switch ((int)id){
-        case ADSR1_ID :
-            vas_adsr_setQ(x->adsr1,a,d,r);
-        case ADSR2_ID :
-            vas_adsr_setQ(x->adsr2,a,d,r);
-        case ADSR3_ID :
-            vas_adsr_setQ(x->adsr3,a,d,r);
-        case ADSR4_ID :
-            vas_adsr_setQ(x->adsr4,a,d,r);
+    vas_adsr_curves *pending;
+    int index = (int)id - ADSR1_ID;
+
+    if(!vas_fm_getAdsr(x->fm, (int)id))
+        return;
+
+    rtap_fmMultiOsc_tilde_sync(x);
+    VAS_TRACE_BEGIN("adsr_Q");
+    /* a newer adsr_Q of the same ADSR wins, keeping what it leaves out */
+    pending = x->curves[index];
+    if(pending)
+    {
+        if(a <= 0) a = pending->att_q;
+        if(d <= 0) d = pending->dec_q;
+        if(r <= 0) r = pending->rel_q;
+        vas_adsr_curves_cancel(pending);
     }
+    x->curves[index] = vas_fm_startCurves(x->fm, a, d, r, (int)id);
+    if(x->curves[index])
+        clock_delay(x->curves_clock, RTAP_IMPORT_POLL_INTERVAL);
+    VAS_TRACE_END("adsr_Q");
+    clock_delay(x->release_clock, RTAP_RELEASE_GRACE);
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Swaps the curves of finished adsr_Q messages in. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * Runs on the Pd clock while curves are being computed. <br>
+ */
+void rtap_fmMultiOsc_tilde_curves_tick(rtap_fmMultiOsc_tilde *x)
+{
+    int pending = 0;
+
+    for(int k = 0; k < 4; k++)
+    {
+        vas_adsr_curves *curves = x->curves[k];
+
+        if(!curves)
+            continue;
+        if(!vas_adsr_curves_done(curves))
+        {
+            pending = 1;
+            continue;
+        }
+
+        x->curves[k] = NULL;
+        rtap_fmMultiOsc_tilde_sync(x);
+        vas_fm_finishCurves(x->fm, curves, ADSR1_ID + k);
+    }
+
+    if(pending)
+        clock_delay(x->curves_clock, RTAP_IMPORT_POLL_INTERVAL);
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Switches an ADSR between audio rate and control rate. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param rate "a" for audio rate, "k" for control rate <br>
+ * @param period samples between two evaluations at control rate, for example 8 to 64 <br>
+ * @param id id of adsr<br>
+ * At control rate the envelope is evaluated every period samples and interpolated linearly.
+ * On the default curves with long stages it stays within about 1e-4 of the audio rate
+ * envelope at a period of 32, steep adsr_Q curves with short stages deviate by 0.1 and
+ * more already at 8 (see rtap_bench), keep those at audio rate. <br>
+ */
+void rtap_fmMultiOsc_tilde_setADSR_rate(rtap_fmMultiOsc_tilde *x, t_symbol *rate, float period, float id)
+{
+    rtap_fmMultiOsc_tilde_sync(x);
+    if(rate->s_name[0] == 'k')
+        vas_fm_setADSR_rate(x->fm, period > 0 ? (int)period : 16, (int)id);
+    else if(rate->s_name[0] == 'a')
+        vas_fm_setADSR_rate(x->fm, 1, (int)id);
+    else
+        pd_error(x, "rtap_fmMultiOsc~: adsr_rate: expected k or a");
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Lets a shared LFO replace the envelope of an ADSR. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param name name of the LFO, all instances using the same name share one LFO <br>
+ * @param id id of adsr<br>
+ * The LFO is computed once per block for the whole patch instead of running
+ * the ADSR in LOOP(LFO) mode on every sample of every instance. A new LFO is
+ * a 1 Hz sine, see lfo_shape and lfo_freq. <br>
+ */
+void rtap_fmMultiOsc_tilde_setLFO(rtap_fmMultiOsc_tilde *x, t_symbol *name, float id)
+{
+    int k = (int)id - ADSR1_ID;
+
+    if(k < 0 || k > 3)
+    {
+        pd_error(x, "rtap_fmMultiOsc~: lfo: no adsr %d", (int)id);
+        return;
+    }
+    rtap_fmMultiOsc_tilde_sync(x);
+    vas_lfo *previous = x->fm->lfo[k];
+    vas_fm_setLFO(x->fm, vas_lfo_acquire(name->s_name), (int)id);
+    vas_lfo_release(previous);
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Returns an ADSR to its own envelope. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param id id of adsr<br>
+ */
+void rtap_fmMultiOsc_tilde_LFO_off(rtap_fmMultiOsc_tilde *x, float id)
+{
+    int k = (int)id - ADSR1_ID;
+
+    if(k < 0 || k > 3)
+        return;
+    rtap_fmMultiOsc_tilde_sync(x);
+    vas_lfo *previous = x->fm->lfo[k];
+    vas_fm_setLFO(x->fm, NULL, (int)id);
+    vas_lfo_release(previous);
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Sets the shape of the LFO of an ADSR. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param shape sine, triangle, ramp or adsr <br>
+ * @param id id of adsr<br>
+ * adsr captures one loop of this ADSR as set by adsr and adsr_Q and plays it
+ * at the speed of LOOP(LFO) mode. The LFO is shared, so every instance using
+ * its name follows. <br>
+ */
+void rtap_fmMultiOsc_tilde_setLFO_shape(rtap_fmMultiOsc_tilde *x, t_symbol *shape, float id)
+{
+    int k = (int)id - ADSR1_ID;
+    vas_lfo *lfo = k >= 0 && k <= 3 ? x->fm->lfo[k] : NULL;
+
+    if(!lfo)
+    {
+        pd_error(x, "rtap_fmMultiOsc~: lfo_shape: adsr %d has no lfo", (int)id);
+        return;
+    }
+    if(!strcmp(shape->s_name, "sine"))
+        vas_lfo_setShape(lfo, VAS_LFO_SINE);
+    else if(!strcmp(shape->s_name, "triangle"))
+        vas_lfo_setShape(lfo, VAS_LFO_TRIANGLE);
+    else if(!strcmp(shape->s_name, "ramp"))
+        vas_lfo_setShape(lfo, VAS_LFO_RAMP);
+    else if(!strcmp(shape->s_name, "adsr"))
+        vas_lfo_setADSR(lfo, vas_fm_getAdsr(x->fm, (int)id), sys_getsr());
+    else
+        pd_error(x, "rtap_fmMultiOsc~: lfo_shape: expected sine, triangle, ramp or adsr");
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Sets the frequency of the LFO of an ADSR. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param frequency cycles per second <br>
+ * @param id id of adsr<br>
+ */
+void rtap_fmMultiOsc_tilde_setLFO_frequency(rtap_fmMultiOsc_tilde *x, float frequency, float id)
+{
+    int k = (int)id - ADSR1_ID;
+    vas_lfo *lfo = k >= 0 && k <= 3 ? x->fm->lfo[k] : NULL;
+
+    if(!lfo)
+    {
+        pd_error(x, "rtap_fmMultiOsc~: lfo_freq: adsr %d has no lfo", (int)id);
+        return;
+    }
+    vas_lfo_setFrequency(lfo, frequency);
 }
 
 /**
@@ -427,36 +1022,35 @@ void rtap_fmMultiOsc_tilde_setADSR_Q(rtap_fmMultiOsc_tilde *x, float a, float d,
  * @brief Toggles the active oscillators and ADSRs. <br>
  * @param x My rtap_fmMultiOsc_tilde object <br>
  * @param id the oscillator or adsr id<br>
- * Toggles the active oscillators and ADSRs. <br>
+ * Toggles the active oscillators and ADSRs. An ADSR whose curves were
+ * released runs on the default curves until they are computed again. <br>
  */
 void rtap_fmMultiOsc_tilde_toggle_active(rtap_fmMultiOsc_tilde *x, float id)
 {
-    switch ((int)id){
-        case OSC1_ID : 
-            x->osc1_active = abs(x->osc1_active - 1);
-            break;
-        case OSC2_ID : 
-            x->osc2_active = abs(x->osc2_active - 1);
-            break;
-        case OSC3_ID : 
-            x->osc3_active = abs(x->osc3_active - 1);
-            break;
-        case OSC4_ID : 
-            x->osc4_active = abs(x->osc4_active - 1);
-            break;
-        case ADSR1_ID : 
-            x->adsr1_active = abs(x->adsr1_active - 1);
-            break;
-        case ADSR2_ID : 
-            x->adsr2_active = abs(x->adsr2_active - 1);
-            break;
-        case ADSR3_ID : 
-            x->adsr3_active = abs(x->adsr3_active - 1);
-            break;
-        case ADSR4_ID : 
-            x->adsr4_active = abs(x->adsr4_active - 1);
-            break;
+    int index = (int)id - ADSR1_ID;
+
+    rtap_fmMultiOsc_tilde_sync(x);
+    vas_fm_toggle_active(x->fm, (int)id);
+    if(vas_fm_missingCurves(x->fm, (int)id) && !x->curves[index])
+    {
+        x->curves[index] = vas_fm_startCurves(x->fm, 0, 0, 0, (int)id);
+        if(x->curves[index])
+            clock_delay(x->curves_clock, RTAP_IMPORT_POLL_INTERVAL);
     }
+    clock_delay(x->release_clock, RTAP_RELEASE_GRACE);
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Frees the tables of parts that were switched off. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * Runs RTAP_RELEASE_GRACE after the last I/O or adsr_Q, so every part that
+ * is still off has been off at least that long. <br>
+ */
+void rtap_fmMultiOsc_tilde_release_tick(rtap_fmMultiOsc_tilde *x)
+{
+    rtap_fmMultiOsc_tilde_sync(x);
+    vas_fm_releaseUnused(x->fm);
 }
 
 /**
@@ -469,11 +1063,11 @@ void rtap_fmMultiOsc_tilde_toggle_active(rtap_fmMultiOsc_tilde *x, float id)
  */
 void rtap_fmMultiOsc_tilde_noteOn(rtap_fmMultiOsc_tilde *x, float frequency, float velocity)
 {
-    rtap_fmMultiOsc_tilde_osc_set_Master_Frequency(x,frequency);
-    vas_adsr_noteOn(x->adsr1, velocity);
-    vas_adsr_noteOn(x->adsr2, velocity);
-    vas_adsr_noteOn(x->adsr3, velocity);
-    vas_adsr_noteOn(x->adsr4, velocity);
+    rtap_fmMultiOsc_tilde_sync(x);
+    VAS_TRACE_BEGIN("noteon");
+    vas_fm_noteOn(x->fm, frequency, velocity);
+    vas_governor_noteOn(x->governor, &x->voice);
+    VAS_TRACE_END("noteon");
 }
 
 /**
@@ -483,11 +1077,11 @@ void rtap_fmMultiOsc_tilde_noteOn(rtap_fmMultiOsc_tilde *x, float frequency, flo
  * Triggers a note off in both ADSR Modes. <br>
  */
 void rtap_fmMultiOsc_tilde_noteOff(rtap_fmMultiOsc_tilde *x)
-{   
-    vas_adsr_noteOff(x->adsr1);  
-    vas_adsr_noteOff(x->adsr2);  
-    vas_adsr_noteOff(x->adsr3);  
-    vas_adsr_noteOff(x->adsr4);  
+{
+    rtap_fmMultiOsc_tilde_sync(x);
+    VAS_TRACE_BEGIN("noteoff");
+    vas_fm_noteOff(x->fm);
+    VAS_TRACE_END("noteoff");
 }
 
 /**
@@ -500,20 +1094,8 @@ void rtap_fmMultiOsc_tilde_noteOff(rtap_fmMultiOsc_tilde *x)
  */
 void rtap_fmMultiOsc_tilde_ADSRmode(rtap_fmMultiOsc_tilde *x, float mode, float id)
 {
-    switch ((int)id){
-        case ADSR1_ID : 
-            vas_adsr_modeswitch(x->adsr1, mode);
-            break;
-        case ADSR2_ID : 
-            vas_adsr_modeswitch(x->adsr2, mode);
-            break;
-        case ADSR3_ID : 
-            vas_adsr_modeswitch(x->adsr3, mode);
-            break;
-        case ADSR4_ID : 
-            vas_adsr_modeswitch(x->adsr4, mode);
-            break;
-    }
+    rtap_fmMultiOsc_tilde_sync(x);
+    vas_fm_ADSRmode(x->fm, mode, (int)id);
 }
 
 /**
@@ -525,7 +1107,10 @@ void rtap_fmMultiOsc_tilde_ADSRmode(rtap_fmMultiOsc_tilde *x, float mode, float
  */
 void rtap_fmMultiOsc_tilde_algorithmode(rtap_fmMultiOsc_tilde *x, float alg_mode)
 {
-    x->current_algorithm = alg_mode;
+    rtap_fmMultiOsc_tilde_sync(x);
+    VAS_TRACE_BEGIN("algorithm_mode");
+    vas_fm_algorithmode(x->fm, (int)alg_mode);
+    VAS_TRACE_END("algorithm_mode");
 }
 
 /**
@@ -537,128 +1122,277 @@ void rtap_fmMultiOsc_tilde_algorithmode(rtap_fmMultiOsc_tilde *x, float alg_mode
  */
 void rtap_fmMultiOsc_tilde_reset_waveform(rtap_fmMultiOsc_tilde *x, float id)
 {
-     switch ((int)id){
-        case OSC1_ID : 
-            vas_osc_free(x->osc1);
-            x->osc1 = vas_osc_new(SAMPLING_FREQUENCY,x->master_frequency);
-            break;
-        case OSC2_ID : 
-            vas_osc_free(x->osc2);
-            x->osc2 = vas_osc_new(SAMPLING_FREQUENCY,x->master_frequency);
-            break;
-        case OSC3_ID : 
-            vas_osc_free(x->osc3);
-            x->osc3 = vas_osc_new(SAMPLING_FREQUENCY,x->master_frequency);
-            break;
-        case OSC4_ID : 
-            vas_osc_free(x->osc4);
-            x->osc4 = vas_osc_new(SAMPLING_FREQUENCY,x->master_frequency);
-            break;
-     }
-}
-
-/**
- * @related rtap_fmMultiOsc_tilde
- * @brief Calculates current output volume. <br>
- * @param x My adsr object <br>
- * @param in The input vector <br>
- * @param out The output vector <br>
- * @param vectorSize The size of the i/o vectors <br>
- * Calculates current output volume with the master_amp variable. <br>
+    rtap_fmMultiOsc_tilde_sync(x);
+    VAS_TRACE_BEGIN("reset_waveform");
+    rtap_fmMultiOsc_tilde_unref(x, (int)id);
+    vas_fm_reset_waveform(x->fm, (int)id);
+    VAS_TRACE_END("reset_waveform");
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Reports new overruns and file errors of the recorder. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * Runs on the Pd clock while recording, so the audio thread never posts. <br>
  */
-void rtap_fmMultiOsc_tilde_gainstage(rtap_fmMultiOsc_tilde *x, float *in, float *out, int vectorSize)
+void rtap_fmMultiOsc_tilde_record_tick(rtap_fmMultiOsc_tilde *x)
 {
-    int i = vectorSize;
-    float currentValue= 0.0F;
-        while(i--)
-        {
-            currentValue=*in++;
-            *out++ = currentValue * x->master_amp;
-        }
+    int overruns = atomic_load(&x->recorder->overruns);
+
+    if(atomic_load(&x->recorder->state) == VAS_RECORDER_ERROR)
+    {
+        pd_error(x, "rtap_fmMultiOsc~: could not record to %s", x->recorder->path);
+        vas_recorder_stop(x->recorder);
+        return;
+    }
+
+    if(overruns != x->record_overruns)
+    {
+        pd_error(x, "rtap_fmMultiOsc~: recorder overrun, %d blocks dropped so far", overruns);
+        x->record_overruns = overruns;
+    }
+
+    clock_delay(x->record_clock, RTAP_RECORD_REPORT_INTERVAL);
 }
 
 /**
  * @related rtap_fmMultiOsc_tilde
- * @brief Performs algorithm 1. <br>
- * @param x My adsr object <br>
- * @param in The input vector <br>
- * @param out The output vector <br>
- * @param n The size of the i/o vectors <br>
- * Performs algorithm 1. <br>
+ * @brief Starts recording the output to a 32 bit float WAV file. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param name file name, relative to the directory of the patch <br>
+ * The file is opened and written by a background thread, the perform routine
+ * only copies each block into a ring buffer. A running recording is stopped first. <br>
  */
-void rtap_fmMultiOsc_tilde_alg1(rtap_fmMultiOsc_tilde *x, float *in, float *out, int n)
+void rtap_fmMultiOsc_tilde_record(rtap_fmMultiOsc_tilde *x, t_symbol *name)
 {
-    if(x->osc1_active) {vas_osc_process(x->osc1, in, out, n, MODE_CARRIER_NO_INPUT);}
-    if(x->adsr1_active && x->osc1_active){vas_adsr_process(x->adsr1, in, out, n);} 
-    if(x->osc2_active){vas_osc_process(x->osc2, in, out, n, MODE_MOD_WITH_INPUT);}
-    if(x->adsr2_active && x->osc2_active) {vas_adsr_process(x->adsr2, in, out, n); }
-    if(x->osc3_active) {vas_osc_process(x->osc3, in, out, n, MODE_MOD_WITH_INPUT);}
-    if(x->adsr3_active && x->osc3_active) {vas_adsr_process(x->adsr3, in, out, n);}
-    if(x->osc4_active) {vas_osc_process(x->osc4, in, out, n, MODE_MOD_WITH_INPUT);}
-    if(x->adsr4_active && x->osc4_active) {vas_adsr_process(x->adsr4, in, out, n);}
+    char path[VAS_RECORDER_PATHSIZE];
+
+    if(!x->recorder)
+        x->recorder = vas_recorder_new(RTAP_RECORD_CAPACITY);
+    else
+        vas_recorder_stop(x->recorder);
+
+    canvas_makefilename(x->canvas, name->s_name, path, VAS_RECORDER_PATHSIZE);
+
+    x->record_overruns = 0;
+    if(vas_recorder_start(x->recorder, path, (int)sys_getsr()))
+    {
+        post("rtap_fmMultiOsc~: recording to %s", path);
+        clock_delay(x->record_clock, RTAP_RECORD_REPORT_INTERVAL);
+    }
+    else
+        pd_error(x, "rtap_fmMultiOsc~: could not start recording to %s", path);
 }
 
 /**
  * @related rtap_fmMultiOsc_tilde
- * @brief Performs algorithm 2. <br>
- * @param x My adsr object <br>
- * @param in The input vector <br>
- * @param out The output vector <br>
- * @param n The size of the i/o vectors <br>
- * Performs algorithm 2. <br>
+ * @brief Stops recording and closes the file. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * Waits until the writer thread has flushed the ring buffer. <br>
  */
-void rtap_fmMultiOsc_tilde_alg2(rtap_fmMultiOsc_tilde *x, float *in, float *out, int n)
+void rtap_fmMultiOsc_tilde_stop(rtap_fmMultiOsc_tilde *x)
 {
-    if(x->osc1_active) {vas_osc_process(x->osc1, in, out, n, MODE_CARRIER_NO_INPUT);}
-    if(x->adsr1_active && x->osc1_active){vas_adsr_process(x->adsr1, in, out, n);} 
-    if(x->osc2_active){vas_osc_process(x->osc2, in, out, n, MODE_SUM_WITH_IN);}
-    if(x->adsr2_active && x->osc2_active) {vas_adsr_process(x->adsr2, in, out, n); }
-    if(x->osc3_active) {vas_osc_process(x->osc3, in, out, n, MODE_MOD_WITH_INPUT);}
-    if(x->adsr3_active && x->osc3_active) {vas_adsr_process(x->adsr3, in, out, n);}
-    if(x->osc4_active) {vas_osc_process(x->osc4, in, out, n, MODE_MOD_WITH_INPUT);}
-    if(x->adsr4_active && x->osc4_active) {vas_adsr_process(x->adsr4, in, out, n);}
+    if(!x->recorder || !x->recorder->threadRunning)
+        return;
+
+    clock_unset(x->record_clock);
+    vas_recorder_stop(x->recorder);
+
+    post("rtap_fmMultiOsc~: recorded %ld samples to %s, %d overruns, %ld samples dropped",
+        atomic_load(&x->recorder->writtenFrames), x->recorder->path,
+        atomic_load(&x->recorder->overruns), atomic_load(&x->recorder->droppedFrames));
 }
 
 /**
  * @related rtap_fmMultiOsc_tilde
- * @brief Performs algorithm 3. <br>
- * @param x My adsr object <br>
- * @param in The input vector <br>
- * @param out The output vector <br>
- * @param n The size of the i/o vectors <br>
- * Performs algorithm 3. <br>
+ * @brief Writes the recorded trace events to a Chrome trace JSON file. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param name file name, relative to the directory of the patch <br>
+ * Only available in builds with VAS_TRACE (make TRACE=1). The file can be
+ * opened in chrome://tracing or ui.perfetto.dev. <br>
  */
-void rtap_fmMultiOsc_tilde_alg3(rtap_fmMultiOsc_tilde *x, float *in, float *out, int n)
+void rtap_fmMultiOsc_tilde_trace_dump(rtap_fmMultiOsc_tilde *x, t_symbol *name)
 {
-    if(x->osc1_active) {vas_osc_process(x->osc1, in, out, n, MODE_CARRIER_NO_INPUT);}
-    if(x->adsr1_active && x->osc1_active){vas_adsr_process(x->adsr1, in, out, n);} 
-    if(x->osc2_active){vas_osc_process(x->osc2, in, out, n, MODE_SUM_WITH_IN);}
-    if(x->adsr2_active && x->osc2_active) {vas_adsr_process(x->adsr2, in, out, n); }
-    if(x->osc3_active) {vas_osc_process(x->osc3, in, out, n,  MODE_SUM_WITH_IN);}
-    if(x->adsr3_active && x->osc3_active) {vas_adsr_process(x->adsr3, in, out, n);}
-    if(x->osc4_active) {vas_osc_process(x->osc4, in, out, n,  MODE_MOD_WITH_INPUT);}
-    if(x->adsr4_active && x->osc4_active) {vas_adsr_process(x->adsr4, in, out, n);}
+    char path[MAXPDSTRING];
+    long events;
+
+    canvas_makefilename(x->canvas, name->s_name, path, MAXPDSTRING);
+    events = vas_trace_dump(path);
+
+#ifdef VAS_TRACE
+    if(events < 0)
+        pd_error(x, "rtap_fmMultiOsc~: could not write %s", path);
+    else
+        post("rtap_fmMultiOsc~: wrote %ld trace events to %s", events, path);
+#else
+    (void)events;
+    pd_error(x, "rtap_fmMultiOsc~: trace_dump needs a build with tracing (make TRACE=1)");
+#endif
 }
 
 /**
  * @related rtap_fmMultiOsc_tilde
- * @brief Performs algorithm 4. <br>
- * @param x My adsr object <br>
- * @param in The input vector <br>
- * @param out The output vector <br>
- * @param n The size of the i/o vectors <br>
- * Performs algorithm 4. <br>
+ * @brief Switches the outlet between the mixed signal and the four operator taps. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param on 1 for a multichannel outlet with one channel per operator, 0 for the mixed signal <br>
+ * Needs Pd 0.54 or newer, older versions keep the single channel outlet. <br>
+ */
+void rtap_fmMultiOsc_tilde_multichannel(rtap_fmMultiOsc_tilde *x, float on)
+{
+    if(on != 0 && !rtap_signal_setmultiout)
+    {
+        pd_error(x, "rtap_fmMultiOsc~: multichannel signals need Pd 0.54 or newer");
+        return;
+    }
+    if(x->multichannel != (on != 0))
+    {
+        x->multichannel = on != 0;
+        canvas_update_dsp();
+    }
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Switches between rendering in the perform routine and on the shared worker pool. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param on 1 to render on the pool, 0 to render in the perform routine <br>
+ * On the pool every perform call outputs the block rendered since the previous
+ * one and queues the next, so the object is one block late but many instances
+ * render on all cores. <br>
  */
-void rtap_fmMultiOsc_tilde_alg4(rtap_fmMultiOsc_tilde *x, float *in, float *out, int n)
+void rtap_fmMultiOsc_tilde_parallel(rtap_fmMultiOsc_tilde *x, float on)
 {
-    if(x->osc1_active) {vas_osc_process(x->osc1, in, out, n, MODE_CARRIER_NO_INPUT);}
-    if(x->adsr1_active && x->osc1_active){vas_adsr_process(x->adsr1, in, out, n);} 
-    if(x->osc2_active){vas_osc_process(x->osc2, in, out, n, MODE_SUM_WITH_IN);}
-    if(x->adsr2_active && x->osc2_active) {vas_adsr_process(x->adsr2, in, out, n); }
-    if(x->osc3_active) {vas_osc_process(x->osc3, in, out, n,  MODE_SUM_WITH_IN);}
-    if(x->adsr3_active && x->osc3_active) {vas_adsr_process(x->adsr3, in, out, n);}
-    if(x->osc4_active) {vas_osc_process(x->osc4, in, out, n,  MODE_SUM_WITH_IN);}
-    if(x->adsr4_active && x->osc4_active) {vas_adsr_process(x->adsr4, in, out, n);}
+    if(x->parallel == (on != 0))
+        return;
+
+    if(on)
+        x->pool = vas_pool_acquire();
+    x->parallel = on != 0;
+    canvas_update_dsp();
+
+    if(!on)
+    {
+        vas_pool_forget(x->pool, &x->job);
+        vas_pool_release(x->pool);
+        x->pool = NULL;
+    }
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Sends the decisions of the governor to the control outlet. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * Outputs "tier <tier> <load in percent>" when the tier changed and
+ * "voice <0/1>" when this instance was dropped or is rendered again. Runs on
+ * the Pd clock, the perform routine only schedules it. <br>
+ */
+void rtap_fmMultiOsc_tilde_governor_tick(rtap_fmMultiOsc_tilde *x)
+{
+    t_atom argv[2];
+
+    if(x->tier != x->reportedTier)
+    {
+        x->reportedTier = x->tier;
+        SETFLOAT(&argv[0], x->tier);
+        SETFLOAT(&argv[1], x->governor->load * 100);
+        outlet_anything(x->control, gensym("tier"), 2, argv);
+    }
+    if(x->audible != x->reportedAudible)
+    {
+        x->reportedAudible = x->audible;
+        SETFLOAT(&argv[0], x->audible);
+        outlet_anything(x->control, gensym("voice"), 1, argv);
+    }
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Sets the CPU budget of all instances. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * @param percent share of the block duration all instances together may use, 0 turns the governor off <br>
+ * Over budget the quality of all instances is stepped down: sine by table
+ * lookup, control rate envelopes, then only the newest voices are rendered.
+ * With enough headroom it is stepped back up. The current tier and load are
+ * sent to the control outlet. In parallel mode the budget applies to the
+ * summed time on all cores. <br>
+ */
+void rtap_fmMultiOsc_tilde_governor(rtap_fmMultiOsc_tilde *x, float percent)
+{
+    t_atom argv[2];
+
+    vas_governor_setBudget(x->governor, percent / 100);
+    SETFLOAT(&argv[0], x->governor->tier);
+    SETFLOAT(&argv[1], x->governor->load * 100);
+    outlet_anything(x->control, gensym("tier"), 2, argv);
+}
+
+static void rtap_fmMultiOsc_tilde_postLine(const char *line)
+{
+    post("%s", line);
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Posts the messages the DSP code queued in vas_log. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * The log is shared by all instances, whichever clock fires first posts it. <br>
+ */
+void rtap_fmMultiOsc_tilde_log_tick(rtap_fmMultiOsc_tilde *x)
+{
+    (void)x;
+    vas_log_drain(rtap_fmMultiOsc_tilde_postLine);
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Reports the memory used by all instances in the process. <br>
+ * @param x My rtap_fmMultiOsc_tilde object <br>
+ * Posts bytes, peak and blocks per category (scratch, instance, osctable,
+ * envtable, all) to the console and sends mem <category> <kB> <peak kB> <blocks>
+ * for each to the control outlet. Needs a build with make MEMTRACK=1. <br>
+ */
+void rtap_fmMultiOsc_tilde_mem(rtap_fmMultiOsc_tilde *x)
+{
+    t_atom argv[4];
+
+    if(!vas_mem_tracking())
+    {
+        pd_error(x, "rtap_fmMultiOsc~: mem: memory is not tracked, build with make MEMTRACK=1");
+        return;
+    }
+
+    vas_mem_report(rtap_fmMultiOsc_tilde_postLine);
+    for(int category = 0; category <= VAS_MEM_ALL; category++)
+    {
+        vas_mem_stats stats;
+
+        vas_mem_getStats(category, &stats);
+        SETSYMBOL(&argv[0], gensym(vas_mem_categoryName(category)));
+        SETFLOAT(&argv[1], stats.bytes / 1024.);
+        SETFLOAT(&argv[2], stats.peak / 1024.);
+        SETFLOAT(&argv[3], stats.blocks);
+        outlet_anything(x->control, gensym("mem"), 4, argv);
+    }
+}
+
+/**
+ * @related rtap_fmMultiOsc_tilde
+ * @brief Looks up the multichannel API of the running Pd. <br>
+ */
+static void rtap_fmMultiOsc_tilde_findMultichannel(void)
+{
+    int major, minor, bugfix;
+    sys_getversion(&major, &minor, &bugfix);
+    if(major == 0 && minor < 54)
+        return;
+
+#ifdef _WIN32
+    rtap_signal_setmultiout = (rtap_signal_setmultiout_t)GetProcAddress(GetModuleHandleA("pd.dll"), "signal_setmultiout");
+#else
+    void *pd = dlopen(NULL, RTLD_NOW);
+    if(pd)
+        rtap_signal_setmultiout = (rtap_signal_setmultiout_t)dlsym(pd, "signal_setmultiout");
+#endif
 }
 
 /**
@@ -668,19 +1402,31 @@ void rtap_fmMultiOsc_tilde_alg4(rtap_fmMultiOsc_tilde *x, float *in, float *out,
  */
 void rtap_fmMultiOsc_tilde_setup(void)
 {
+    vas_util_init();
+    rtap_fmMultiOsc_tilde_findMultichannel();
+
     rtap_fmMultiOsc_tilde_class = class_new(gensym("rtap_fmMultiOsc~"),
         (t_newmethod)rtap_fmMultiOsc_tilde_new,
         (t_method)rtap_fmMultiOsc_tilde_free,
         sizeof(rtap_fmMultiOsc_tilde),
-        CLASS_DEFAULT,
+        rtap_signal_setmultiout ? CLASS_MULTICHANNEL : CLASS_DEFAULT,
         A_DEFFLOAT, 0);
 
       class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_dsp, gensym("dsp"), 0);
       class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_osc_setFrequency, gensym("osc_freq"), A_DEFFLOAT,A_DEFFLOAT, 0);
       class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_setExternTable, gensym("osc_table"), A_SYMBOL,A_DEFFLOAT, 0); 
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_setTableRef, gensym("osc_table_ref"), A_SYMBOL, A_DEFFLOAT, 0);
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_setWavetable, gensym("osc_wavetable"), A_FLOAT, A_SYMBOL, A_DEFFLOAT, 0);
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_setMorph, gensym("osc_morph"), A_FLOAT, A_SYMBOL, 0);
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_osc_setPosition, gensym("osc_position"), A_DEFFLOAT, A_DEFFLOAT, 0);
       class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_osc_setAmp, gensym("osc_amp"), A_DEFFLOAT,A_DEFFLOAT, 0);
       class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_setADSR, gensym("adsr"), A_DEFFLOAT, A_DEFFLOAT, A_DEFFLOAT, A_DEFFLOAT,A_DEFFLOAT, 0);
       class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_setADSR_Q, gensym("adsr_Q"), A_DEFFLOAT, A_DEFFLOAT, A_DEFFLOAT,A_DEFFLOAT, 0);
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_setADSR_rate, gensym("adsr_rate"), A_SYMBOL, A_DEFFLOAT, A_DEFFLOAT, 0);
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_setLFO, gensym("lfo"), A_SYMBOL, A_DEFFLOAT, 0);
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_LFO_off, gensym("lfo_off"), A_DEFFLOAT, 0);
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_setLFO_shape, gensym("lfo_shape"), A_SYMBOL, A_DEFFLOAT, 0);
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_setLFO_frequency, gensym("lfo_freq"), A_DEFFLOAT, A_DEFFLOAT, 0);
       class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_toggle_active, gensym("I/O"),A_DEFFLOAT, 0);
       class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_noteOn,gensym("noteon"),A_DEFFLOAT,A_DEFFLOAT,0);    
       class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_noteOff,gensym("noteoff"),0);
@@ -690,6 +1436,13 @@ void rtap_fmMultiOsc_tilde_setup(void)
       class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_osc_set_Master_Amp, gensym("osc_master_amp"),A_DEFFLOAT, 0);
       class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_reset_waveform, gensym("reset_waveform"),A_DEFFLOAT, 0);
       class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_algorithmode,gensym("algorithm_mode"),A_DEFFLOAT,0);  
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_record, gensym("record"), A_SYMBOL, 0);
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_stop, gensym("stop"), 0);
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_trace_dump, gensym("trace_dump"), A_SYMBOL, 0);
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_multichannel, gensym("multichannel"), A_DEFFLOAT, 0);
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_parallel, gensym("parallel"), A_DEFFLOAT, 0);
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_governor, gensym("governor"), A_DEFFLOAT, 0);
+      class_addmethod(rtap_fmMultiOsc_tilde_class, (t_method)rtap_fmMultiOsc_tilde_mem, gensym("mem"), 0);
 
       CLASS_MAINSIGNALIN(rtap_fmMultiOsc_tilde_class, rtap_fmMultiOsc_tilde, f);
 }
@@ -0,0 +1,596 @@
+/**
+ * @file rtap_golden.c
+ * @brief Golden output regression check for the vas_fm engine options <br>
+ * <br>
+ * Renders a fixed set of scenarios (every algorithm, both ADSR modes, curved
+ * envelopes and custom oscillator tables) and compares them with golden
+ * renders of the scalar kernels at full quality. The golden files in golden/
+ * are part of the repository; -w writes them again and is only run when a
+ * change is meant to alter the output, the new files are then committed with
+ * it. <br>
+ * <br>
+ * Every engine option, i.e. every kernel set the CPU supports at every
+ * quality tier of the governor, renders all scenarios and is rated by
+ * maximum error, SNR against the golden file and its spurious energy: the
+ * part of its spectrum that falls where the golden spectrum is GOLDEN_QUIETDB
+ * below its peak, which is where aliasing and other new components show up.
+ * The report plots the cost per sample against the worst SNR of
+ * each option; -c writes all numbers to a CSV file. <br>
+ * <br>
+ * Full quality options have to stay above the SNR limit (-s) in every
+ * scenario, otherwise the exit status is 1. The lower tiers trade accuracy
+ * for speed on purpose and are only reported. <br>
+ * <br>
+ * usage: rtap_golden [-w] [-g dir] [-c report.csv] [-s dB] [-r repeats] [-v] <br>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "vas_fm.h"
+#include "vas_wav.h"
+#include "vas_governor.h"
+#include "vas_log.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define GOLDEN_BLOCKSIZE 64
+#define GOLDEN_MAXARGS 8
+#define GOLDEN_TABLESIZE 512
+/** Analysis window of the spectrum, starts GOLDEN_FFTSTART samples into the scenario */
+#define GOLDEN_FFTSIZE 8192
+#define GOLDEN_FFTSTART 4410
+/** Bins this far below the peak of the golden spectrum should stay empty */
+#define GOLDEN_QUIETDB 60
+#define GOLDEN_MAXOPTIONS 16
+#define GOLDEN_PLOTWIDTH 64
+#define GOLDEN_PLOTHEIGHT 16
+/** SNR plotted and written for bit-exact output */
+#define GOLDEN_EXACT 200.0
+
+typedef struct golden_scenario
+{
+    const char *name;
+    int milliseconds;       /* total length, rendered after the script ends */
+    const char *script;     /* rtap_fmMultiOsc~ messages separated by ';', "wait ms" renders */
+} golden_scenario;
+
+static const golden_scenario golden_scenarios[] =
+{
+    {"alg1", 500,
+        "algorithm_mode 1; I/O 2; I/O 3; I/O 4; osc_freq 2 2; osc_freq 3 3; osc_amp 2 0.7; noteon 220 100; wait 400; noteoff"},
+    {"alg2", 500,
+        "algorithm_mode 2; I/O 2; I/O 3; I/O 4; osc_freq 2 2; osc_freq 4 3; noteon 220 100; wait 400; noteoff"},
+    {"alg3", 500,
+        "algorithm_mode 3; I/O 2; I/O 3; I/O 4; osc_freq 3 2; osc_freq 4 4; noteon 110 100; wait 400; noteoff"},
+    {"alg4", 500,
+        "algorithm_mode 4; I/O 2; I/O 3; I/O 4; osc_freq 2 2; osc_freq 3 3; osc_amp 3 0.4; noteon 330 100; wait 400; noteoff"},
+    {"adsr_trigger", 700,
+        "algorithm_mode 4; I/O 2; I/O 3; I/O 11; I/O 12; I/O 13; adsr_mode 1 11; adsr_mode 1 12; adsr_mode 1 13; "
+        "adsr 20 60 0.6 90 11; adsr 5 80 0.3 70 12; adsr 40 40 0.8 95 13; osc_freq 2 2; "
+        "noteon 220 100; wait 450; noteoff"},
+    {"adsr_lfo", 600,
+        "algorithm_mode 2; I/O 2; I/O 3; I/O 11; I/O 12; adsr_mode 0 11; adsr_mode 0 12; "
+        "adsr 10 30 0.5 40 11; adsr 25 25 0.7 25 12; osc_freq 2 3; noteon 220 100; wait 600"},
+    {"adsr_q", 700,
+        "algorithm_mode 1; I/O 2; I/O 3; I/O 11; I/O 12; adsr_mode 1 11; adsr_mode 1 12; "
+        "adsr 30 80 0.5 85 11; adsr 10 50 0.4 60 12; adsr_Q 3 0.4 2 11; adsr_Q 0.5 4 0.3 12; osc_freq 2 2; "
+        "noteon 165 90; wait 450; noteoff"},
+    {"custom_tables", 500,
+        "algorithm_mode 3; I/O 2; I/O 3; I/O 4; osc_shape saw 1; osc_shape square 3; osc_freq 3 2; "
+        "noteon 220 100; wait 400; noteoff"},
+};
+
+#define GOLDEN_SCENARIOS (int)(sizeof(golden_scenarios) / sizeof(golden_scenarios[0]))
+
+typedef struct golden_option
+{
+    char name[32];
+    int kernels;            /* VAS_UTIL_SCALAR, ... */
+    int tier;               /* governor quality tier, 0 ... VAS_GOVERNOR_TIER_CONTROLRATE */
+} golden_option;
+
+typedef struct golden_result
+{
+    float maxError;
+    double snr;             /* dB, GOLDEN_EXACT for bit-exact output */
+    double spurious;        /* dB of the total energy */
+    double nsPerSample;
+} golden_result;
+
+static double golden_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static long golden_frames(const golden_scenario *scenario)
+{
+    return (long)scenario->milliseconds * SAMPLING_FREQUENCY / 1000;
+}
+
+/* ---------------------------------------------------------------- rendering */
+
+typedef struct golden_render
+{
+    vas_fm *fm;
+    float *out;
+    long frames;            /* rendered so far */
+    long length;            /* capacity of out */
+    double seconds;         /* spent in vas_fm_process */
+} golden_render;
+
+static void golden_process(golden_render *x, long frames)
+{
+    float in[GOLDEN_BLOCKSIZE] = {0};
+
+    if(frames > x->length - x->frames)
+        frames = x->length - x->frames;
+    while(frames > 0)
+    {
+        int n = frames < GOLDEN_BLOCKSIZE ? (int)frames : GOLDEN_BLOCKSIZE;
+        double start = golden_now();
+        vas_fm_process(x->fm, in, x->out + x->frames, n);
+        x->seconds += golden_now() - start;
+        x->frames += n;
+        frames -= n;
+    }
+}
+
+/* one cycle of a naive saw or square, the aliasing of which is part of the golden output */
+static void golden_setShape(vas_fm *fm, const char *shape, int id)
+{
+    float table[GOLDEN_TABLESIZE];
+
+    for(int i = 0; i < GOLDEN_TABLESIZE; i++)
+    {
+        float phase = (float)i / GOLDEN_TABLESIZE;
+        table[i] = !strcmp(shape, "square") ? (phase < 0.5F ? 1.0F : -1.0F) : 1.0F - 2.0F * phase;
+    }
+    vas_fm_setTable(fm, id, table, GOLDEN_TABLESIZE);
+}
+
+static void golden_message(golden_render *x, char *message)
+{
+    char *argv[GOLDEN_MAXARGS + 1];
+    float values[GOLDEN_MAXARGS];
+    int argc = 0;
+    char *save = NULL;
+
+    for(char *token = strtok_r(message, " \t", &save); token && argc <= GOLDEN_MAXARGS; token = strtok_r(NULL, " \t", &save))
+        argv[argc++] = token;
+    if(!argc)
+        return;
+
+    for(int i = 1; i < argc; i++)
+        values[i - 1] = (float)atof(argv[i]);
+
+    if(!strcmp(argv[0], "wait") && argc > 1)
+        golden_process(x, (long)(values[0] * SAMPLING_FREQUENCY / 1000));
+    else if(!strcmp(argv[0], "osc_shape") && argc > 2)
+        golden_setShape(x->fm, argv[1], (int)values[1]);
+    else if(!vas_fm_message(x->fm, argv[0], argc - 1, values))
+        fprintf(stderr, "rtap_golden: unknown message '%s'\n", argv[0]);
+}
+
+/* renders a scenario with an engine option, returns the seconds spent in vas_fm_process */
+static double golden_run(const golden_scenario *scenario, const golden_option *option, float *out)
+{
+    golden_render x;
+    char *script = strdup(scenario->script);
+    char *rest = script;
+
+    vas_util_selectKernels(option->kernels);
+    x.fm = vas_fm_new();
+    x.out = out;
+    x.frames = 0;
+    x.length = golden_frames(scenario);
+    x.seconds = 0;
+    vas_fm_setQuality(x.fm, option->tier >= VAS_GOVERNOR_TIER_LOOKUP,
+                      option->tier >= VAS_GOVERNOR_TIER_CONTROLRATE ? VAS_GOVERNOR_CONTROLPERIOD : 1);
+
+    while(rest)
+    {
+        char *message = rest;
+        rest = strchr(rest, ';');
+        if(rest)
+            *rest++ = 0;
+        golden_message(&x, message);
+    }
+    golden_process(&x, x.length - x.frames);
+
+    vas_fm_free(x.fm);
+    free(script);
+    return x.seconds;
+}
+
+/* ---------------------------------------------------------------- measures */
+
+static void golden_fft(double *re, double *im, int n)
+{
+    for(int i = 1, j = 0; i < n; i++)
+    {
+        int bit = n >> 1;
+        for(; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if(i < j)
+        {
+            double t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for(int length = 2; length <= n; length <<= 1)
+    {
+        double angle = -2 * M_PI / length;
+        for(int i = 0; i < n; i += length)
+        {
+            for(int k = 0; k < length / 2; k++)
+            {
+                double wr = cos(angle * k), wi = sin(angle * k);
+                double *ar = &re[i + k], *ai = &im[i + k];
+                double *br = &re[i + k + length / 2], *bi = &im[i + k + length / 2];
+                double tr = *br * wr - *bi * wi;
+                double ti = *br * wi + *bi * wr;
+                *br = *ar - tr; *bi = *ai - ti;
+                *ar += tr; *ai += ti;
+            }
+        }
+    }
+}
+
+/* power spectrum of the analysis window, Hann windowed */
+static void golden_spectrum(const float *signal, double *power)
+{
+    static double re[GOLDEN_FFTSIZE], im[GOLDEN_FFTSIZE];
+
+    for(int i = 0; i < GOLDEN_FFTSIZE; i++)
+    {
+        re[i] = signal[GOLDEN_FFTSTART + i] * (0.5 - 0.5 * cos(2 * M_PI * i / GOLDEN_FFTSIZE));
+        im[i] = 0;
+    }
+    golden_fft(re, im, GOLDEN_FFTSIZE);
+
+    for(int k = 0; k <= GOLDEN_FFTSIZE / 2; k++)
+        power[k] = re[k] * re[k] + im[k] * im[k];
+}
+
+/* marks the bins of the golden spectrum that are GOLDEN_QUIETDB below its peak */
+static void golden_quietBins(const double *power, char *quiet)
+{
+    double peak = 0;
+
+    for(int k = 0; k <= GOLDEN_FFTSIZE / 2; k++)
+        if(power[k] > peak)
+            peak = power[k];
+    for(int k = 0; k <= GOLDEN_FFTSIZE / 2; k++)
+        quiet[k] = power[k] < peak * pow(10, -GOLDEN_QUIETDB / 10.0);
+}
+
+/* energy in the quiet bins in dB of the total */
+static double golden_spurious(const double *power, const char *quiet)
+{
+    double total = 0, spurious = 0;
+
+    for(int k = 0; k <= GOLDEN_FFTSIZE / 2; k++)
+    {
+        total += power[k];
+        if(quiet[k])
+            spurious += power[k];
+    }
+    return total > 0 && spurious > 0 ? 10 * log10(spurious / total) : -GOLDEN_EXACT;
+}
+
+static void golden_compare(const float *golden, const float *signal, long length, golden_result *result)
+{
+    double energy = 0, noise = 0;
+
+    result->maxError = 0;
+    for(long i = 0; i < length; i++)
+    {
+        float error = fabsf(signal[i] - golden[i]);
+        if(!(error <= result->maxError))
+            result->maxError = error;
+        energy += (double)golden[i] * golden[i];
+        noise += (double)error * error;
+    }
+    /* a NaN or infinity anywhere is as bad as it gets */
+    result->snr = !isfinite(noise) ? -GOLDEN_EXACT : noise > 0 ? 10 * log10(energy / noise) : GOLDEN_EXACT;
+    if(result->snr > GOLDEN_EXACT)
+        result->snr = GOLDEN_EXACT;
+}
+
+/* ---------------------------------------------------------------- report */
+
+static void golden_printSnr(double snr)
+{
+    if(snr >= GOLDEN_EXACT)
+        printf("%10s", "exact");
+    else
+        printf("%10.1f", snr);
+}
+
+/* worst SNR to the right, cost upwards, one letter per option */
+static void golden_plot(const golden_option *options, const golden_result *summary, int count)
+{
+    char grid[GOLDEN_PLOTHEIGHT][GOLDEN_PLOTWIDTH + 1];
+    double minSnr = GOLDEN_EXACT, maxCost = 0;
+
+    for(int o = 0; o < count; o++)
+    {
+        if(summary[o].snr < minSnr)
+            minSnr = summary[o].snr;
+        if(summary[o].nsPerSample > maxCost)
+            maxCost = summary[o].nsPerSample;
+    }
+    /* nothing was timed, there is no axis to scale */
+    if(maxCost <= 0)
+        return;
+    minSnr = floor(minSnr / 10) * 10;
+    if(minSnr >= GOLDEN_EXACT)
+        minSnr = GOLDEN_EXACT - 10;
+    maxCost *= 1.1;
+
+    memset(grid, ' ', sizeof(grid));
+    for(int r = 0; r < GOLDEN_PLOTHEIGHT; r++)
+        grid[r][GOLDEN_PLOTWIDTH] = 0;
+    for(int o = 0; o < count; o++)
+    {
+        int column = (int)((summary[o].snr - minSnr) / (GOLDEN_EXACT - minSnr) * (GOLDEN_PLOTWIDTH - 1) + 0.5);
+        int row = (int)(summary[o].nsPerSample / maxCost * (GOLDEN_PLOTHEIGHT - 1) + 0.5);
+        char *cell = &grid[GOLDEN_PLOTHEIGHT - 1 - row][column];
+        *cell = *cell == ' ' ? (char)('A' + o) : '*';
+    }
+
+    printf("\ncost per sample against accuracy ('*' marks overlapping options)\n");
+    for(int r = 0; r < GOLDEN_PLOTHEIGHT; r++)
+    {
+        if(r == 0)
+            printf("%7.1f ns |%s\n", maxCost, grid[r]);
+        else if(r == GOLDEN_PLOTHEIGHT - 1)
+            printf("%7.1f ns |%s\n", 0.0, grid[r]);
+        else
+            printf("           |%s\n", grid[r]);
+    }
+    printf("           +");
+    for(int c = 0; c < GOLDEN_PLOTWIDTH; c++)
+        printf("-");
+    printf("\n           %-6.0f%*s\n", minSnr, GOLDEN_PLOTWIDTH - 5, "exact  worst SNR dB");
+    for(int o = 0; o < count; o++)
+        printf("  %c  %s\n", 'A' + o, options[o].name);
+}
+
+static void golden_usage(void)
+{
+    fprintf(stderr,
+        "usage: rtap_golden [options]\n"
+        "  -w           write the golden files with the scalar kernels at full quality\n"
+        "  -g dir       directory of the golden files (default golden)\n"
+        "  -c file      write the results of every scenario and option to a CSV file\n"
+        "  -s dB        lowest SNR allowed at full quality (default 80)\n"
+        "  -r repeats   renders per measurement, the fastest counts (default 5)\n"
+        "  -v           print every scenario, not only the summary per option\n");
+}
+
+static void golden_printLog(const char *line)
+{
+    fprintf(stderr, "rtap_golden: %s\n", line);
+}
+
+int main(int argc, char **argv)
+{
+    const char *dir = "golden";
+    const char *csvPath = NULL;
+    double limit = 80;
+    int repeats = 5;
+    int write = 0, verbose = 0;
+    int opt;
+
+    while((opt = getopt(argc, argv, "wg:c:s:r:vh")) != -1)
+    {
+        switch(opt)
+        {
+            case 'w': write = 1; break;
+            case 'g': dir = optarg; break;
+            case 'c': csvPath = optarg; break;
+            case 's': limit = atof(optarg); break;
+            case 'r': repeats = atoi(optarg); break;
+            case 'v': verbose = 1; break;
+            default: golden_usage(); return 1;
+        }
+    }
+    if(repeats < 1)
+        repeats = 1;
+
+    long maxFrames = 0;
+    for(int s = 0; s < GOLDEN_SCENARIOS; s++)
+        if(golden_frames(&golden_scenarios[s]) > maxFrames)
+            maxFrames = golden_frames(&golden_scenarios[s]);
+    float *signal = (float *) calloc(maxFrames, sizeof(float));
+    char path[1024];
+
+    if(write)
+    {
+        golden_option reference = {"scalar full", VAS_UTIL_SCALAR, 0};
+        int failed = 0;
+
+        mkdir(dir, 0777);
+        for(int s = 0; s < GOLDEN_SCENARIOS; s++)
+        {
+            const golden_scenario *scenario = &golden_scenarios[s];
+            vas_wav *wav;
+
+            golden_run(scenario, &reference, signal);
+            for(long i = 0; i < golden_frames(scenario); i++)
+            {
+                if(!isfinite(signal[i]))
+                {
+                    fprintf(stderr, "rtap_golden: %s is not finite at sample %ld\n", scenario->name, i);
+                    failed = 1;
+                    break;
+                }
+            }
+            snprintf(path, sizeof(path), "%s/%s.wav", dir, scenario->name);
+            wav = vas_wav_open(path, SAMPLING_FREQUENCY, 1);
+            if(!wav)
+            {
+                fprintf(stderr, "rtap_golden: cannot create %s\n", path);
+                failed = 1;
+                continue;
+            }
+            vas_wav_write(wav, signal, golden_frames(scenario));
+            vas_wav_close(wav);
+            printf("wrote %s\n", path);
+        }
+        vas_log_drain(golden_printLog);
+        free(signal);
+        return failed;
+    }
+
+    /* every supported kernel set at every quality tier the governor uses */
+    int sets[] = {VAS_UTIL_SCALAR, VAS_UTIL_SSE2, VAS_UTIL_AVX2, VAS_UTIL_NEON};
+    const char *tiers[] = {"full", "sine table", "k-rate"};
+    golden_option options[GOLDEN_MAXOPTIONS];
+    int optionCount = 0;
+
+    for(int k = 0; k < 4; k++)
+    {
+        if(!vas_util_selectKernels(sets[k]))
+            continue;
+        for(int t = 0; t <= VAS_GOVERNOR_TIER_CONTROLRATE && optionCount < GOLDEN_MAXOPTIONS; t++)
+        {
+            golden_option *option = &options[optionCount++];
+            snprintf(option->name, sizeof(option->name), "%s %s", vas_util_kernelName(sets[k]), tiers[t]);
+            option->kernels = sets[k];
+            option->tier = t;
+        }
+    }
+
+    golden_result summary[GOLDEN_MAXOPTIONS];
+    static double power[GOLDEN_FFTSIZE / 2 + 1];
+    static char quiet[GOLDEN_FFTSIZE / 2 + 1];
+    FILE *csv = NULL;
+    int failed = 0, compared = 0;
+
+    if(csvPath)
+    {
+        csv = fopen(csvPath, "w");
+        if(!csv)
+            fprintf(stderr, "rtap_golden: cannot create %s\n", csvPath);
+        else
+            fprintf(csv, "scenario,kernels,tier,max_error,snr_db,spurious_db,golden_spurious_db,ns_per_sample\n");
+    }
+
+    for(int o = 0; o < optionCount; o++)
+    {
+        summary[o].maxError = 0;
+        summary[o].snr = GOLDEN_EXACT;
+        summary[o].spurious = -GOLDEN_EXACT;
+        summary[o].nsPerSample = 0;
+    }
+
+    if(verbose)
+        printf("%-14s %-18s %12s %10s %14s %10s\n", "scenario", "option", "max error", "SNR dB", "spurious dB", "ns/sample");
+
+    for(int s = 0; s < GOLDEN_SCENARIOS; s++)
+    {
+        const golden_scenario *scenario = &golden_scenarios[s];
+        long frames = golden_frames(scenario);
+        golden_result measured;
+        int length = 0;
+        float *golden;
+        double goldenSpurious;
+
+        snprintf(path, sizeof(path), "%s/%s.wav", dir, scenario->name);
+        golden = vas_wav_read(path, &length, NULL);
+        if(!golden || length != frames)
+        {
+            fprintf(stderr, "rtap_golden: %s is missing or has the wrong length, write it with -w\n", path);
+            vas_mem_free(golden);
+            failed = 1;
+            continue;
+        }
+        golden_spectrum(golden, power);
+        golden_quietBins(power, quiet);
+        goldenSpurious = golden_spurious(power, quiet);
+
+        for(int o = 0; o < optionCount; o++)
+        {
+            golden_result *result = &measured;
+            double fastest = 0;
+
+            for(int r = 0; r < repeats; r++)
+            {
+                double seconds = golden_run(scenario, &options[o], signal);
+                if(!r || seconds < fastest)
+                    fastest = seconds;
+            }
+            golden_compare(golden, signal, frames, result);
+            golden_spectrum(signal, power);
+            result->spurious = golden_spurious(power, quiet);
+            result->nsPerSample = fastest * 1e9 / frames;
+
+            if(result->maxError > summary[o].maxError)
+                summary[o].maxError = result->maxError;
+            if(result->snr < summary[o].snr)
+                summary[o].snr = result->snr;
+            if(result->spurious - goldenSpurious > summary[o].spurious)
+                summary[o].spurious = result->spurious - goldenSpurious;
+            summary[o].nsPerSample += result->nsPerSample;
+
+            if(!options[o].tier && result->snr < limit)
+            {
+                fprintf(stderr, "rtap_golden: %s with %s: SNR %.1f dB is below %.1f dB\n",
+                        scenario->name, options[o].name, result->snr, limit);
+                failed = 1;
+            }
+
+            if(verbose)
+            {
+                printf("%-14s %-18s %12.3g", scenario->name, options[o].name, result->maxError);
+                golden_printSnr(result->snr);
+                printf(" %14.1f %10.2f\n", result->spurious, result->nsPerSample);
+            }
+            if(csv)
+                fprintf(csv, "%s,%s,%d,%g,%.2f,%.2f,%.2f,%.3f\n", scenario->name, vas_util_kernelName(options[o].kernels),
+                        options[o].tier, result->maxError, result->snr, result->spurious, goldenSpurious, result->nsPerSample);
+        }
+        vas_mem_free(golden);
+        compared++;
+    }
+
+    vas_log_drain(golden_printLog);
+    if(csv)
+        fclose(csv);
+    if(!compared)
+    {
+        fprintf(stderr, "rtap_golden: no golden files in %s, run rtap_golden -w first\n", dir);
+        free(signal);
+        printf("\nFAILED\n");
+        return 1;
+    }
+
+    for(int o = 0; o < optionCount; o++)
+        summary[o].nsPerSample /= compared;
+    printf("\n%d of %d scenarios against %s, worst case per option\n", compared, GOLDEN_SCENARIOS, dir);
+    printf("%-20s %12s %10s %18s %10s\n", "option", "max error", "SNR dB", "spurious +dB", "ns/sample");
+    for(int o = 0; o < optionCount; o++)
+    {
+        printf("%c %-18s %12.3g", 'A' + o, options[o].name, summary[o].maxError);
+        golden_printSnr(summary[o].snr);
+        printf(" %18.1f %10.2f\n", summary[o].spurious, summary[o].nsPerSample);
+    }
+    golden_plot(options, summary, optionCount);
+
+    free(signal);
+    printf("\n%s\n", failed ? "FAILED" : "passed");
+    return failed;
+}
@@ -0,0 +1,641 @@
+/**
+ * @file rtap_render.c
+ * @brief Offline batch renderer for rtap_fmMultiOsc~ <br>
+ * <br>
+ * Renders parameter sets and MIDI files to WAV files faster than real time,
+ * using the same vas_fm engine as the Pure Data object. Jobs are distributed
+ * over all cores through a shared work queue. <br>
+ * <br>
+ * A preset file holds one parameter set per line. A parameter set is a list
+ * of rtap_fmMultiOsc~ messages separated by ';', for example <br>
+ * <br>
+ *     algorithm_mode 2; I/O 2; I/O 11; adsr 20 40 0.6 30 11; osc_freq 2 1.5 <br>
+ * <br>
+ * Lines starting with '#' are ignored. "osc_table file.wav id" loads a WAV
+ * file of any length as one cycle of the waveform, "osc_wavetable id library.vwt index" maps a waveform of
+ * a wavetable library (see rtap_wavetable) and "osc_morph id library.vwt"
+ * morphs through all of its waveforms with "osc_position id frame". Without noteon in the line, the set is rendered as one
+ * note (-f, -v) held for -d seconds followed by a -t seconds tail. With a
+ * noteon, the line is a script and "wait ms" renders in between messages. <br>
+ * <br>
+ * With -m every MIDI file is rendered once per parameter set (or once with
+ * the default settings when no preset file is given). The engine is
+ * monophonic, so the most recent note wins. <br>
+ * <br>
+ * With -T the trace events of a build with VAS_TRACE (make TRACE=1) are
+ * written to a Chrome trace JSON file, one track per worker thread. <br>
+ * <br>
+ * usage: rtap_render [-o dir] [-j jobs] [-f Hz] [-v velocity] [-d sec] [-t sec] [-m file.mid]... [-T trace.json] [presets.txt] <br>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "vas_fm.h"
+#include "vas_wav.h"
+#include "vas_trace.h"
+#include "vas_log.h"
+
+#define RENDER_BLOCKSIZE 64
+#define RENDER_WRITEFRAMES 16384
+#define RENDER_MAXARGS 8
+#define RENDER_MAXLINE 4096
+#define RENDER_MAXMIDI 256
+
+typedef struct render_settings
+{
+    const char *outdir;
+    float frequency;
+    float velocity;
+    float duration;
+    float tail;
+} render_settings;
+
+typedef struct render_job
+{
+    char *preset;           /* one line of the preset file, may be empty */
+    const char *midiPath;   /* NULL for a preset-only job */
+    char outPath[1024];
+    double renderedSeconds;
+    int failed;
+} render_job;
+
+typedef struct render_queue
+{
+    render_job *jobs;
+    int count;
+    int next;
+    pthread_mutex_t lock;
+    const render_settings *settings;
+} render_queue;
+
+/* ---------------------------------------------------------------- output */
+
+typedef struct render_output
+{
+    vas_fm *fm;
+    vas_wav *wav;
+    float in[RENDER_BLOCKSIZE];
+    float buffer[RENDER_WRITEFRAMES];
+    int buffered;
+    long frames;
+} render_output;
+
+static void render_flush(render_output *x)
+{
+    if(x->buffered)
+        vas_wav_write(x->wav, x->buffer, x->buffered);
+    x->buffered = 0;
+}
+
+/* renders frames samples through the engine, writing in large chunks */
+static void render_frames(render_output *x, long frames)
+{
+    while(frames > 0)
+    {
+        int n = frames < RENDER_BLOCKSIZE ? (int)frames : RENDER_BLOCKSIZE;
+        if(x->buffered + n > RENDER_WRITEFRAMES)
+            render_flush(x);
+        vas_fm_process(x->fm, x->in, x->buffer + x->buffered, n);
+        x->buffered += n;
+        x->frames += n;
+        frames -= n;
+    }
+}
+
+static long render_secondsToFrames(double seconds)
+{
+    return seconds > 0 ? (long)(seconds * SAMPLING_FREQUENCY + 0.5) : 0;
+}
+
+/* ---------------------------------------------------------------- messages */
+
+/* applies one message, returns 1 if it was a noteon */
+static int render_message(render_output *out, char *message)
+{
+    char *argv[RENDER_MAXARGS + 1];
+    float values[RENDER_MAXARGS];
+    int argc = 0;
+    char *save = NULL;
+
+    for(char *token = strtok_r(message, " \t\r\n", &save); token && argc <= RENDER_MAXARGS; token = strtok_r(NULL, " \t\r\n", &save))
+        argv[argc++] = token;
+    if(!argc)
+        return 0;
+
+    for(int i = 1; i < argc; i++)
+        values[i - 1] = (float)atof(argv[i]);
+
+    if(!strcmp(argv[0], "wait"))
+    {
+        if(argc < 2)
+        {
+            fprintf(stderr, "rtap_render: malformed message 'wait', expected wait <ms>\n");
+            return 0;
+        }
+        render_frames(out, render_secondsToFrames(values[0] / 1000.0));
+        return 0;
+    }
+
+    if(!strcmp(argv[0], "osc_table"))
+    {
+        int length = 0;
+        float *table = argc > 1 ? vas_wav_read(argv[1], &length, NULL) : NULL;
+        if(!table)
+            fprintf(stderr, "rtap_render: osc_table: cannot read %s\n", argc > 1 ? argv[1] : "");
+        vas_fm_setTable(out->fm, argc > 2 ? (int)values[1] : 0, table, length);
+        vas_mem_free(table);
+        return 0;
+    }
+
+    if(!strcmp(argv[0], "osc_wavetable"))
+    {
+        if(argc < 3 || !vas_fm_setWavetable(out->fm, (int)values[0], argv[2], argc > 3 ? (int)values[2] : 0))
+            fprintf(stderr, "rtap_render: osc_wavetable: cannot use %s\n", argc > 2 ? argv[2] : "");
+        return 0;
+    }
+
+    if(!strcmp(argv[0], "osc_morph"))
+    {
+        if(argc < 3 || !vas_fm_setMorph(out->fm, (int)values[0], argv[2]))
+            fprintf(stderr, "rtap_render: osc_morph: cannot use %s\n", argc > 2 ? argv[2] : "");
+        return 0;
+    }
+
+    if(!strcmp(argv[0], "adsr_rate"))
+    {
+        int controlRate = argc > 1 && argv[1][0] == 'k';
+        vas_fm_setADSR_rate(out->fm, controlRate ? (int)values[1] : 1, argc > 3 ? (int)values[2] : 0);
+        return 0;
+    }
+
+    if(!vas_fm_message(out->fm, argv[0], argc - 1, values))
+        fprintf(stderr, "rtap_render: unknown message '%s'\n", argv[0]);
+
+    return !strcmp(argv[0], "noteon");
+}
+
+/* applies all messages of a preset line, returns 1 if the line contains a noteon */
+static int render_preset(render_output *out, const char *preset)
+{
+    char *copy = strdup(preset ? preset : "");
+    char *rest = copy;
+    int hadNoteOn = 0;
+
+    while(rest)
+    {
+        char *message = rest;
+        rest = strchr(rest, ';');
+        if(rest)
+            *rest++ = 0;
+        hadNoteOn |= render_message(out, message);
+    }
+
+    free(copy);
+    return hadNoteOn;
+}
+
+/* ---------------------------------------------------------------- MIDI */
+
+typedef struct render_midiEvent
+{
+    unsigned long tick;
+    int order;              /* file order, keeps the sort stable */
+    int type;               /* 0 noteoff, 1 noteon, 2 tempo */
+    int note;
+    int velocity;
+    long tempo;
+} render_midiEvent;
+
+static unsigned long render_readVarLen(const unsigned char **p, const unsigned char *end)
+{
+    unsigned long value = 0;
+    while(*p < end)
+    {
+        unsigned char byte = *(*p)++;
+        value = (value << 7) | (byte & 0x7f);
+        if(!(byte & 0x80))
+            break;
+    }
+    return value;
+}
+
+static int render_compareEvents(const void *a, const void *b)
+{
+    const render_midiEvent *x = (const render_midiEvent *)a;
+    const render_midiEvent *y = (const render_midiEvent *)b;
+    if(x->tick != y->tick)
+        return x->tick < y->tick ? -1 : 1;
+    return x->order - y->order;
+}
+
+/* reads all note and tempo events of a standard MIDI file, sorted by tick */
+static render_midiEvent *render_readMidi(const char *path, int *count, int *division)
+{
+    FILE *file = fopen(path, "rb");
+    unsigned char *data;
+    long size;
+    render_midiEvent *events = NULL;
+    int capacity = 0, truncated = 0;
+
+    *count = 0;
+    if(!file)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    data = (unsigned char *) malloc(size);
+    if(fread(data, 1, size, file) != (size_t)size || size < 14 || memcmp(data, "MThd", 4))
+    {
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+
+    int tracks = (data[10] << 8) | data[11];
+    *division = (data[12] << 8) | data[13];
+    if(*division & 0x8000)
+        *division = 480; /* SMPTE time is not supported, assume 480 ppq */
+    if(!*division)
+    {
+        free(data);
+        return NULL;
+    }
+
+    const unsigned char *p = data + 8 + ((data[4] << 24) | (data[5] << 16) | (data[6] << 8) | data[7]);
+    const unsigned char *fileEnd = data + size;
+
+    for(int t = 0; t < tracks && p + 8 <= fileEnd; t++)
+    {
+        long length = ((long)p[4] << 24) | (p[5] << 16) | (p[6] << 8) | p[7];
+        const unsigned char *end = p + 8 + length;
+        unsigned long tick = 0;
+        int status = 0;
+
+        if(memcmp(p, "MTrk", 4) || end > fileEnd)
+            break;
+        p += 8;
+
+        while(p < end && !truncated)
+        {
+            tick += render_readVarLen(&p, end);
+            if(p >= end)
+                break;
+            if(*p & 0x80)
+                status = *p++;
+
+            if(status == 0xff)
+            {
+                int type;
+                unsigned long metaLength;
+
+                if(p >= end)
+                {
+                    truncated = 1;
+                    break;
+                }
+                type = *p++;
+                metaLength = render_readVarLen(&p, end);
+                if(metaLength > (unsigned long)(end - p))
+                {
+                    truncated = 1;
+                    break;
+                }
+                if(type == 0x51 && metaLength == 3)
+                {
+                    if(*count == capacity)
+                        events = (render_midiEvent *) realloc(events, (capacity = capacity * 2 + 64) * sizeof(render_midiEvent));
+                    render_midiEvent *e = &events[(*count)++];
+                    e->tick = tick; e->order = *count; e->type = 2;
+                    e->tempo = (p[0] << 16) | (p[1] << 8) | p[2];
+                }
+                p += metaLength;
+                status = 0;
+            }
+            else if(status == 0xf0 || status == 0xf7)
+            {
+                unsigned long sysexLength = render_readVarLen(&p, end);
+                if(sysexLength > (unsigned long)(end - p))
+                {
+                    truncated = 1;
+                    break;
+                }
+                p += sysexLength;
+                status = 0;
+            }
+            else
+            {
+                int kind = status & 0xf0;
+                int dataBytes = (kind == 0xc0 || kind == 0xd0) ? 1 : 2;
+                int data1, data2;
+
+                if(end - p < dataBytes)
+                {
+                    truncated = 1;
+                    break;
+                }
+                data1 = *p++;
+                data2 = dataBytes == 2 ? *p++ : 0;
+
+                if(kind == 0x90 || kind == 0x80)
+                {
+                    if(*count == capacity)
+                        events = (render_midiEvent *) realloc(events, (capacity = capacity * 2 + 64) * sizeof(render_midiEvent));
+                    render_midiEvent *e = &events[(*count)++];
+                    e->tick = tick; e->order = *count;
+                    e->type = (kind == 0x90 && data2 > 0) ? 1 : 0;
+                    e->note = data1;
+                    e->velocity = data2;
+                }
+            }
+        }
+        p = end;
+    }
+
+    free(data);
+    /* a cut file is rejected instead of rendering whatever came before the cut */
+    if(truncated)
+    {
+        free(events);
+        *count = 0;
+        return NULL;
+    }
+    qsort(events, *count, sizeof(render_midiEvent), render_compareEvents);
+    return events;
+}
+
+static int render_midi(render_output *out, const char *path, float tail)
+{
+    int count, division, currentNote = -1;
+    render_midiEvent *events = render_readMidi(path, &count, &division);
+    double tempo = 500000.0, seconds = 0;
+    unsigned long lastTick = 0;
+    long renderedFrames = 0;
+
+    if(!events)
+        return 0;
+
+    for(int i = 0; i < count; i++)
+    {
+        render_midiEvent *e = &events[i];
+        seconds += (e->tick - lastTick) * tempo / (division * 1e6);
+        lastTick = e->tick;
+
+        long frames = render_secondsToFrames(seconds) - renderedFrames;
+        render_frames(out, frames);
+        renderedFrames += frames;
+
+        if(e->type == 2)
+            tempo = (double)e->tempo;
+        else if(e->type == 1)
+        {
+            vas_fm_noteOn(out->fm, 440.0F * powf(2.0F, (e->note - 69) / 12.0F), (float)e->velocity);
+            currentNote = e->note;
+        }
+        else if(e->note == currentNote)
+        {
+            vas_fm_noteOff(out->fm);
+            currentNote = -1;
+        }
+    }
+
+    render_frames(out, render_secondsToFrames(tail));
+    free(events);
+    return 1;
+}
+
+/* ---------------------------------------------------------------- jobs */
+
+static void render_job_run(render_job *job, const render_settings *settings)
+{
+    render_output *out = (render_output *) calloc(1, sizeof(render_output));
+
+    out->wav = vas_wav_open(job->outPath, SAMPLING_FREQUENCY, 1);
+    if(!out->wav)
+    {
+        fprintf(stderr, "rtap_render: cannot create %s\n", job->outPath);
+        job->failed = 1;
+        free(out);
+        return;
+    }
+    out->fm = vas_fm_new();
+
+    if(job->midiPath)
+    {
+        render_preset(out, job->preset);
+        if(!render_midi(out, job->midiPath, settings->tail))
+        {
+            fprintf(stderr, "rtap_render: cannot read MIDI file %s\n", job->midiPath);
+            job->failed = 1;
+        }
+    }
+    else if(!render_preset(out, job->preset))
+    {
+        vas_fm_noteOn(out->fm, settings->frequency, settings->velocity);
+        render_frames(out, render_secondsToFrames(settings->duration));
+        vas_fm_noteOff(out->fm);
+        render_frames(out, render_secondsToFrames(settings->tail));
+    }
+    else
+        render_frames(out, render_secondsToFrames(settings->tail));
+
+    render_flush(out);
+    job->renderedSeconds = (double)out->frames / SAMPLING_FREQUENCY;
+
+    vas_wav_close(out->wav);
+    vas_fm_free(out->fm);
+    free(out);
+}
+
+static void *render_worker(void *arg)
+{
+    render_queue *queue = (render_queue *)arg;
+
+    while(1)
+    {
+        int index;
+        pthread_mutex_lock(&queue->lock);
+        index = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+
+        if(index >= queue->count)
+            break;
+        render_job_run(&queue->jobs[index], queue->settings);
+    }
+    return NULL;
+}
+
+static double render_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static const char *render_basename(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static void render_usage(void)
+{
+    fprintf(stderr,
+        "usage: rtap_render [options] [presets.txt]\n"
+        "  -o dir       output directory (default .)\n"
+        "  -j jobs      worker threads (default: number of cores)\n"
+        "  -f Hz        note frequency for preset jobs (default 440)\n"
+        "  -v velocity  note velocity for preset jobs (default 100)\n"
+        "  -d seconds   note duration for preset jobs (default 1)\n"
+        "  -t seconds   release tail after the last note (default 1)\n"
+        "  -m file.mid  render a MIDI file, may be repeated\n"
+        "  -T file      write trace events (builds with VAS_TRACE)\n");
+}
+
+static void render_printLog(const char *line)
+{
+    fprintf(stderr, "rtap_render: %s\n", line);
+}
+
+int main(int argc, char **argv)
+{
+    render_settings settings = {".", 440, 100, 1, 1};
+    const char *midiPaths[RENDER_MAXMIDI];
+    int midiCount = 0;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *presetPath = NULL;
+    const char *tracePath = NULL;
+    char **presets = NULL;
+    int presetCount = 0;
+    int opt;
+
+    while((opt = getopt(argc, argv, "o:j:f:v:d:t:m:T:h")) != -1)
+    {
+        switch(opt)
+        {
+            case 'o': settings.outdir = optarg; break;
+            case 'j': threads = atoi(optarg); break;
+            case 'f': settings.frequency = (float)atof(optarg); break;
+            case 'v': settings.velocity = (float)atof(optarg); break;
+            case 'd': settings.duration = (float)atof(optarg); break;
+            case 't': settings.tail = (float)atof(optarg); break;
+            case 'T': tracePath = optarg; break;
+            case 'm':
+                if(midiCount == RENDER_MAXMIDI)
+                {
+                    fprintf(stderr, "rtap_render: more than %d MIDI files\n", RENDER_MAXMIDI);
+                    return 1;
+                }
+                midiPaths[midiCount++] = optarg;
+                break;
+            default: render_usage(); return 1;
+        }
+    }
+    if(optind < argc)
+        presetPath = argv[optind];
+    if(!presetPath && !midiCount)
+    {
+        render_usage();
+        return 1;
+    }
+    if(threads < 1)
+        threads = 1;
+
+    if(presetPath)
+    {
+        FILE *file = fopen(presetPath, "r");
+        char line[RENDER_MAXLINE];
+        if(!file)
+        {
+            fprintf(stderr, "rtap_render: cannot read %s\n", presetPath);
+            return 1;
+        }
+        while(fgets(line, sizeof(line), file))
+        {
+            char *start = line + strspn(line, " \t");
+            if(*start == '#' || *start == '\n' || *start == '\r' || !*start)
+                continue;
+            presets = (char **) realloc(presets, (presetCount + 1) * sizeof(char *));
+            presets[presetCount++] = strdup(start);
+        }
+        fclose(file);
+    }
+    if(!presetCount)
+    {
+        presets = (char **) malloc(sizeof(char *));
+        presets[presetCount++] = strdup("");
+    }
+
+    vas_util_init();
+
+    int jobCount = midiCount ? midiCount * presetCount : presetCount;
+    render_job *jobs = (render_job *) calloc(jobCount, sizeof(render_job));
+    for(int i = 0; i < jobCount; i++)
+    {
+        render_job *job = &jobs[i];
+        job->preset = presets[i % presetCount];
+        if(midiCount)
+        {
+            job->midiPath = midiPaths[i / presetCount];
+            snprintf(job->outPath, sizeof(job->outPath), "%s/%s_%04d.wav",
+                     settings.outdir, render_basename(job->midiPath), i % presetCount + 1);
+        }
+        else
+            snprintf(job->outPath, sizeof(job->outPath), "%s/preset_%04d.wav", settings.outdir, i + 1);
+    }
+
+    render_queue queue;
+    queue.jobs = jobs;
+    queue.count = jobCount;
+    queue.next = 0;
+    queue.settings = &settings;
+    pthread_mutex_init(&queue.lock, NULL);
+
+    if(threads > jobCount)
+        threads = jobCount;
+    pthread_t *workers = (pthread_t *) malloc(threads * sizeof(pthread_t));
+
+    double start = render_now();
+    for(int i = 0; i < threads; i++)
+        pthread_create(&workers[i], NULL, render_worker, &queue);
+    for(int i = 0; i < threads; i++)
+        pthread_join(workers[i], NULL);
+    double wall = render_now() - start;
+
+    double rendered = 0;
+    int failed = 0;
+    for(int i = 0; i < jobCount; i++)
+    {
+        rendered += jobs[i].renderedSeconds;
+        failed += jobs[i].failed;
+    }
+
+    printf("rendered %d files (%d failed) with %d threads\n", jobCount - failed, failed, threads);
+    printf("%.1f s of audio in %.3f s wall time: %.1f rendered seconds per wall second\n",
+           rendered, wall, wall > 0 ? rendered / wall : 0);
+
+    if(tracePath)
+    {
+        long events = vas_trace_dump(tracePath);
+        if(events < 0)
+            fprintf(stderr, "rtap_render: cannot write %s (tracing needs make TRACE=1)\n", tracePath);
+        else
+            printf("wrote %ld trace events to %s\n", events, tracePath);
+    }
+
+    vas_log_drain(render_printLog);
+
+    pthread_mutex_destroy(&queue.lock);
+    for(int i = 0; i < presetCount; i++)
+        free(presets[i]);
+    free(presets);
+    free(jobs);
+    free(workers);
+    return failed ? 1 : 0;
+}
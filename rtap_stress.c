@@ -0,0 +1,447 @@
+/**
+ * @file rtap_stress.c
+ * @brief Worst-case block time harness for rtap_fmMultiOsc~ <br>
+ * <br>
+ * Drives the vas_fm engine with a hostile, reproducible stream of messages
+ * (dense noteon/noteoff, adsr and adsr_Q changes, osc_table uploads,
+ * algorithm and I/O switches in the middle of notes) and times every block
+ * the way Pd would run it: the messages that arrived since the last block,
+ * then the DSP. Prints the distribution of the block times
+ * (p50/p99/p99.9/max), the worst block per message type, and every block
+ * that missed the deadline. <br>
+ * <br>
+ * With -g the engine runs under the CPU governor of vas_governor.h with the
+ * given budget, and the blocks spent in every quality tier are printed. <br>
+ * <br>
+ * With -p the blocks are rendered on the shared pool one block late, like
+ * rtap_fmMultiOsc~ in parallel mode. The "array" messages stand for a Pd
+ * array read with osc_table_ref that is resized: its old storage is freed
+ * without waiting for the pool, as Pd does between two ticks, and then
+ * referenced again, as the dsp method does. Like the object, the harness
+ * renders in place of the pool while an array is referenced; built with
+ * -fsanitize=address any read of freed storage is reported. <br>
+ * <br>
+ * Like the object, adsr_Q computes the curves on a thread of their own and
+ * swaps them in from the message part of a later block. <br>
+ * <br>
+ * Built with make RTCHECK=1, every allocation, free, lock and stdio call made
+ * in the part of a block that runs in the perform routine in Pd (governor and
+ * DSP, not the messages) is counted, see vas_rtcheck.h. <br>
+ * <br>
+ * Runs without Pure Data. The exit status is 2 if a block missed the deadline
+ * and 3 if the real-time safety check flagged a call. <br>
+ * <br>
+ * usage: rtap_stress [-s seconds] [-b blocksize] [-e events] [-D us] [-r seed] [-l limit] [-g percent] [-p] <br>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "vas_fm.h"
+#include "vas_governor.h"
+#include "vas_pool.h"
+#include "vas_log.h"
+#include "vas_rtcheck.h"
+
+#define STRESS_MAXBLOCKSIZE 4096
+#define STRESS_MAXEVENTS 64
+#define STRESS_MAXARRAY 4096
+
+/* message types of the event stream */
+enum
+{
+    STRESS_NOTEON,
+    STRESS_NOTEOFF,
+    STRESS_ADSR,
+    STRESS_ADSR_Q,
+    STRESS_OSC_TABLE,
+    STRESS_ALGORITHM,
+    STRESS_TOGGLE,
+    STRESS_OSC_FREQ,
+    STRESS_ARRAY,
+    STRESS_TYPES
+};
+
+static const char *stressNames[STRESS_TYPES] = {"noteon", "noteoff", "adsr", "adsr_Q", "osc_table", "algorithm_mode", "I/O", "osc_freq", "array"};
+
+/* relative frequency of the message types */
+static const int stressWeights[STRESS_TYPES] = {8, 8, 3, 3, 1, 2, 2, 3, 1};
+
+/* the engine, rendered in the loop or on the pool one block late */
+typedef struct stress_engine
+{
+    vas_fm *fm;
+    vas_pool *pool;             /* NULL unless -p */
+    vas_pool_job job;
+    float *pipeIn;              /* input of the block in flight */
+    float *pipeOut;             /* its output */
+    int blockSize;
+    float *array;               /* storage of the referenced array, NULL if none */
+    int arrayOsc;               /* the oscillator reading it */
+    vas_adsr_curves *curves[4]; /* curves being computed for ADSR 1 ... 4, NULL if none */
+} stress_engine;
+
+typedef struct stress_block
+{
+    double seconds;             /* events and DSP of the block */
+    unsigned int types;         /* bit mask of the message types in the block */
+} stress_block;
+
+static unsigned int stressState = 1;
+
+/* xorshift, so that a seed always gives the same event stream */
+static unsigned int stress_random(void)
+{
+    stressState ^= stressState << 13;
+    stressState ^= stressState >> 17;
+    stressState ^= stressState << 5;
+    return stressState;
+}
+
+static float stress_uniform(float low, float high)
+{
+    return low + (high - low) * (stress_random() & 0xffffff) / (float)0x1000000;
+}
+
+static int stress_type(void)
+{
+    int total = 0, pick;
+    for(int t = 0; t < STRESS_TYPES; t++)
+        total += stressWeights[t];
+    pick = stress_random() % total;
+    for(int t = 0; t < STRESS_TYPES; t++)
+    {
+        pick -= stressWeights[t];
+        if(pick < 0)
+            return t;
+    }
+    return 0;
+}
+
+static void stress_render(void *arg)
+{
+    stress_engine *x = (stress_engine *)arg;
+    vas_fm_process(x->fm, x->pipeIn, x->pipeOut, x->blockSize);
+}
+
+/* waits for the block in flight, like every message of the object does */
+static void stress_sync(stress_engine *x)
+{
+    if(x->pool)
+        vas_pool_wait(&x->job);
+}
+
+/* resizes the referenced array: the old storage goes away without waiting for the pool */
+static void stress_array(stress_engine *x)
+{
+    int length = 64 + stress_random() % (STRESS_MAXARRAY - 63);
+    float *array = (float *) vas_mem_allocAs(length * sizeof(float), VAS_MEM_SCRATCH);
+
+    for(int i = 0; i < length; i++)
+        array[i] = stress_uniform(-1, 1);
+    vas_mem_free(x->array);
+    if(!x->array)
+        x->arrayOsc = OSC1_ID + stress_random() % 4;
+    x->array = array;
+
+    /* Pd restarts DSP after the resize, the dsp method waits and binds the new storage */
+    stress_sync(x);
+    vas_fm_referenceTable(x->fm, x->arrayOsc, array, length, 1);
+}
+
+/* swaps finished curves in, like the curves clock of the object */
+static void stress_curves(stress_engine *x)
+{
+    for(int k = 0; k < 4; k++)
+    {
+        vas_adsr_curves *curves = x->curves[k];
+
+        if(!curves || !vas_adsr_curves_done(curves))
+            continue;
+        x->curves[k] = NULL;
+        stress_sync(x);
+        vas_fm_finishCurves(x->fm, curves, ADSR1_ID + k);
+    }
+}
+
+static void stress_event(stress_engine *x, int type, const float *table)
+{
+    vas_fm *fm = x->fm;
+    int osc = OSC1_ID + stress_random() % 4;
+    int adsr = ADSR1_ID + stress_random() % 4;
+
+    switch(type)
+    {
+        case STRESS_NOTEON:
+            vas_fm_noteOn(fm, stress_uniform(40, 2000), stress_uniform(1, 127));
+            break;
+        case STRESS_NOTEOFF:
+            vas_fm_noteOff(fm);
+            break;
+        case STRESS_ADSR:
+            vas_fm_setADSR(fm, stress_uniform(0, 100), stress_uniform(0, 100), stress_uniform(0, 1), stress_uniform(0, 100), adsr);
+            break;
+        case STRESS_ADSR_Q:
+            /* a newer adsr_Q of the same ADSR wins, see stress_curves */
+            vas_adsr_curves_cancel(x->curves[adsr - ADSR1_ID]);
+            x->curves[adsr - ADSR1_ID] = vas_fm_startCurves(fm, stress_uniform(0.1F, 10), stress_uniform(0.1F, 10), stress_uniform(0.1F, 10), adsr);
+            break;
+        case STRESS_OSC_TABLE:
+            /* the object resamples off the audio path and only swaps the finished table in */
+            vas_fm_referenceTable(fm, osc, table, vas_resample_size(SAMPLING_FREQUENCY), 1);
+            break;
+        case STRESS_ALGORITHM:
+            vas_fm_algorithmode(fm, ALG_1 + stress_random() % 4);
+            break;
+        case STRESS_TOGGLE:
+            vas_fm_toggle_active(fm, stress_random() & 1 ? osc : adsr);
+            break;
+        case STRESS_OSC_FREQ:
+            vas_fm_osc_setFrequency(fm, osc, stress_uniform(0.25F, 8));
+            break;
+    }
+}
+
+static double stress_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int stress_compare(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double stress_percentile(const double *sorted, long count, double p)
+{
+    long index = (long)(p / 100 * (count - 1) + 0.5);
+    return sorted[index];
+}
+
+static void stress_printTypes(unsigned int types)
+{
+    for(int t = 0; t < STRESS_TYPES; t++)
+        if(types & (1u << t))
+            printf(" %s", stressNames[t]);
+}
+
+static void stress_usage(void)
+{
+    fprintf(stderr,
+        "usage: rtap_stress [options]\n"
+        "  -s seconds   audio to process (default 60)\n"
+        "  -b samples   block size (default 64)\n"
+        "  -e events    average messages per block (default 2)\n"
+        "  -D us        deadline per block (default: the block duration)\n"
+        "  -r seed      seed of the event stream (default 1)\n"
+        "  -l limit     deadline misses to list (default 20)\n"
+        "  -g percent   run under the governor with this budget of the deadline (default off)\n"
+        "  -p           render on the worker pool one block late, like parallel mode\n");
+}
+
+static void stress_printLine(const char *line)
+{
+    printf("%s\n", line);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 60, deadline = 0, events = 2, budget = 0;
+    int blockSize = 64, limit = 20, opt;
+    long blocks, misses = 0;
+    long tierBlocks[VAS_GOVERNOR_TIERS] = {0};
+    double worst[STRESS_TYPES] = {0};
+    stress_block *times;
+    double *sorted;
+    float *in, *table, *source;
+    vas_fm *fm;
+    stress_engine engine = {0};
+    int parallel = 0;
+    vas_governor *governor;
+    int tier = 0, unsafe = 0;
+
+    while((opt = getopt(argc, argv, "s:b:e:D:r:l:g:ph")) != -1)
+    {
+        switch(opt)
+        {
+            case 's': seconds = atof(optarg); break;
+            case 'b': blockSize = atoi(optarg); break;
+            case 'e': events = atof(optarg); break;
+            case 'D': deadline = atof(optarg) * 1e-6; break;
+            case 'r': stressState = (unsigned int)strtoul(optarg, NULL, 10) | 1; break;
+            case 'l': limit = atoi(optarg); break;
+            case 'g': budget = atof(optarg) / 100; break;
+            case 'p': parallel = 1; break;
+            default: stress_usage(); return 1;
+        }
+    }
+    if(seconds <= 0 || blockSize < 1 || blockSize > STRESS_MAXBLOCKSIZE || events < 0 || events * 2 > STRESS_MAXEVENTS)
+    {
+        stress_usage();
+        return 1;
+    }
+    if(deadline <= 0)
+        deadline = (double)blockSize / SAMPLING_FREQUENCY;
+
+    vas_util_init();
+    blocks = (long)(seconds * SAMPLING_FREQUENCY / blockSize);
+    if(blocks < 1)
+        blocks = 1;
+    times = (stress_block *) vas_mem_alloc(blocks * sizeof(stress_block));
+    sorted = (double *) vas_mem_alloc(blocks * sizeof(double));
+    in = (float *) vas_mem_alloc(blockSize * sizeof(float));
+    source = (float *) vas_mem_alloc(SAMPLING_FREQUENCY * sizeof(float));
+    for(int i = 0; i < SAMPLING_FREQUENCY; i++)
+        source[i] = stress_uniform(-1, 1);
+    table = (float *) vas_mem_alloc((vas_resample_size(SAMPLING_FREQUENCY) + 1) * sizeof(float));
+    vas_resample_cycle(source, SAMPLING_FREQUENCY, 1, table, vas_resample_size(SAMPLING_FREQUENCY));
+    vas_mem_free(source);
+
+    /* start with every operator and envelope running, the most expensive state */
+    fm = vas_fm_new();
+    for(int id = OSC2_ID; id <= OSC4_ID; id++)
+        vas_fm_toggle_active(fm, id);
+    for(int id = ADSR1_ID; id <= ADSR4_ID; id++)
+        vas_fm_toggle_active(fm, id);
+    vas_fm_noteOn(fm, 440, 100);
+
+    engine.fm = fm;
+    engine.blockSize = blockSize;
+    engine.pipeIn = (float *) vas_mem_alloc(blockSize * sizeof(float));
+    engine.pipeOut = (float *) vas_mem_alloc(blockSize * sizeof(float));
+    if(parallel)
+    {
+        engine.pool = vas_pool_acquire();
+        vas_pool_job_init(&engine.job, stress_render, &engine);
+    }
+
+    governor = vas_governor_acquire();
+    vas_governor_setBudget(governor, (float)budget);
+
+    for(long b = 0; b < blocks; b++)
+    {
+        int count = events > 0 ? (int)(stress_random() % (unsigned int)(2 * events + 1)) : 0;
+        int types[STRESS_MAXEVENTS];
+        unsigned int mask = 0;
+        double start;
+
+        /* the event stream is drawn outside the timed region */
+        for(int e = 0; e < count; e++)
+        {
+            types[e] = stress_type();
+            mask |= 1u << types[e];
+        }
+
+        start = stress_now();
+        VAS_RTCHECK_ENTER();
+        vas_governor_enter(governor, (double)b);
+        if(governor->tier != tier)
+        {
+            tier = governor->tier;
+            vas_fm_setQuality(fm, tier >= VAS_GOVERNOR_TIER_LOOKUP, tier >= VAS_GOVERNOR_TIER_CONTROLRATE ? VAS_GOVERNOR_CONTROLPERIOD : 1);
+        }
+        VAS_RTCHECK_LEAVE();
+        stress_curves(&engine);
+        for(int e = 0; e < count; e++)
+        {
+            if(types[e] == STRESS_ARRAY)
+                stress_array(&engine);
+            else
+            {
+                stress_sync(&engine);
+                stress_event(&engine, types[e], table);
+            }
+        }
+        VAS_RTCHECK_ENTER();
+        if(engine.pool)
+        {
+            /* outputs the block rendered since the last one and queues the next, see performParallel */
+            vas_pool_wait(&engine.job);
+            vas_util_fcopy(in, engine.pipeIn, blockSize);
+            vas_util_fcopy(engine.pipeOut, in, blockSize);
+            if(engine.array)
+                stress_render(&engine);
+            else
+                vas_pool_submit(engine.pool, &engine.job);
+        }
+        else
+            vas_fm_process(fm, in, in, blockSize);
+        VAS_RTCHECK_LEAVE();
+        times[b].seconds = stress_now() - start;
+        times[b].types = mask;
+        vas_governor_account(governor, times[b].seconds, deadline);
+        tierBlocks[tier]++;
+
+        /* the output feeds back as input, like a patch modulating itself */
+        for(int i = 0; i < blockSize; i++)
+            in[i] *= 0.5F;
+    }
+
+    for(long b = 0; b < blocks; b++)
+    {
+        sorted[b] = times[b].seconds;
+        for(int t = 0; t < STRESS_TYPES; t++)
+            if((times[b].types & (1u << t)) && times[b].seconds > worst[t])
+                worst[t] = times[b].seconds;
+    }
+    qsort(sorted, blocks, sizeof(double), stress_compare);
+
+    printf("%ld blocks of %d samples, %.1f messages per block, deadline %.1f us\n", blocks, blockSize, events, deadline * 1e6);
+    printf("block time      p50 %8.2f us  p99 %8.2f us  p99.9 %8.2f us  max %8.2f us\n",
+           stress_percentile(sorted, blocks, 50) * 1e6, stress_percentile(sorted, blocks, 99) * 1e6,
+           stress_percentile(sorted, blocks, 99.9) * 1e6, sorted[blocks - 1] * 1e6);
+
+    printf("worst block with\n");
+    for(int t = 0; t < STRESS_TYPES; t++)
+        printf("  %-16s %8.2f us\n", stressNames[t], worst[t] * 1e6);
+
+    for(long b = 0; b < blocks; b++)
+    {
+        if(times[b].seconds <= deadline)
+            continue;
+        if(misses < limit)
+        {
+            printf("deadline miss: block %ld at %.3f s, %.2f us, messages:", b, (double)b * blockSize / SAMPLING_FREQUENCY, times[b].seconds * 1e6);
+            stress_printTypes(times[b].types);
+            printf("\n");
+        }
+        misses++;
+    }
+    printf("%ld of %ld blocks missed the deadline\n", misses, blocks);
+
+    if(budget > 0)
+    {
+        printf("governor at %.1f%% of the deadline, %u tier changes, blocks per tier:", budget * 100, governor->decisions);
+        for(int t = 0; t < VAS_GOVERNOR_TIERS; t++)
+            printf(" %ld", tierBlocks[t]);
+        printf("\n");
+    }
+    vas_governor_release(governor);
+    if(engine.pool)
+    {
+        vas_pool_forget(engine.pool, &engine.job);
+        vas_pool_release(engine.pool);
+    }
+
+    vas_log_drain(stress_printLine);
+#ifdef VAS_RTCHECK
+    unsafe = vas_rtcheck_report(stress_printLine) > 0;
+#endif
+
+    for(int k = 0; k < 4; k++)
+        vas_adsr_curves_cancel(engine.curves[k]);
+    vas_fm_free(fm);
+    vas_mem_free(engine.array);
+    vas_mem_free(engine.pipeIn);
+    vas_mem_free(engine.pipeOut);
+    vas_mem_free(times);
+    vas_mem_free(sorted);
+    vas_mem_free(in);
+    vas_mem_free(table);
+    return unsafe ? 3 : misses ? 2 : 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @file rtap_wavetable.c
+ * @brief Builds wavetable library files for rtap_fmMultiOsc~ <br>
+ * <br>
+ * Every input WAV file is read as one cycle of a waveform, resampled to the
+ * table size and stored with its band-limited levels (see vas_wavetable.h).
+ * The waveforms get the indices 0, 1, ... in the order of the arguments and
+ * are played with "osc_wavetable id library index". <br>
+ * <br>
+ * usage: rtap_wavetable [-n size] [-l levels] -o library.vwt cycle.wav... <br>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "vas_wav.h"
+#include "vas_wavetable.h"
+
+#define WAVETABLE_DEFAULT_SIZE 2048
+#define WAVETABLE_DEFAULT_LEVELS 8
+
+/* linear interpolation of one cycle of length samples to size samples */
+static void wavetable_resample(const float *cycle, int length, float *dest, int size)
+{
+    for(int i = 0; i < size; i++)
+    {
+        double position = (double)i * length / size;
+        int index = (int)position;
+        float fraction = (float)(position - index);
+        float next = cycle[(index + 1) % length];
+        dest[i] = cycle[index] + fraction * (next - cycle[index]);
+    }
+}
+
+static void wavetable_usage(void)
+{
+    fprintf(stderr,
+        "usage: rtap_wavetable [options] -o library.vwt cycle.wav...\n"
+        "  -o file      library to write\n"
+        "  -n size      samples per cycle, a multiple of 4 (default %d)\n"
+        "  -l levels    band-limited levels per waveform, 1 ... %d (default %d)\n",
+        WAVETABLE_DEFAULT_SIZE, VAS_WAVETABLE_MAXLEVELS, WAVETABLE_DEFAULT_LEVELS);
+}
+
+int main(int argc, char **argv)
+{
+    const char *output = NULL;
+    int size = WAVETABLE_DEFAULT_SIZE, levels = WAVETABLE_DEFAULT_LEVELS;
+    int count, opt;
+    float *tables;
+
+    while((opt = getopt(argc, argv, "o:n:l:h")) != -1)
+    {
+        switch(opt)
+        {
+            case 'o': output = optarg; break;
+            case 'n': size = atoi(optarg); break;
+            case 'l': levels = atoi(optarg); break;
+            default: wavetable_usage(); return 1;
+        }
+    }
+    count = argc - optind;
+    if(!output || count < 1 || size < 4 || size % 4 || levels < 1 || levels > VAS_WAVETABLE_MAXLEVELS)
+    {
+        wavetable_usage();
+        return 1;
+    }
+
+    tables = (float *) vas_mem_alloc((long)count * size * sizeof(float));
+    for(int t = 0; t < count; t++)
+    {
+        int length = 0;
+        float *cycle = vas_wav_read(argv[optind + t], &length, NULL);
+
+        if(!cycle || !length)
+        {
+            fprintf(stderr, "rtap_wavetable: cannot read %s\n", argv[optind + t]);
+            vas_mem_free(cycle);
+            vas_mem_free(tables);
+            return 1;
+        }
+        wavetable_resample(cycle, length, tables + (long)t * size, size);
+        vas_mem_free(cycle);
+    }
+
+    if(!vas_wavetable_write(output, tables, count, size, levels))
+    {
+        fprintf(stderr, "rtap_wavetable: cannot write %s\n", output);
+        vas_mem_free(tables);
+        return 1;
+    }
+
+    printf("%s: %d waveforms, %d samples, %d levels\n", output, count, size, levels);
+    vas_mem_free(tables);
+    return 0;
+}
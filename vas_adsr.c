@@ -4,16 +4,31 @@
  * <br>  and Trigger Mode
  */
 #include "vas_adsr.h"
+#include "vas_trace.h"
+#include "vas_log.h"
 #include <math.h>
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VAS_ADSR_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VAS_ADSR_ARM
+#include <arm_neon.h>
+#endif
+
 vas_adsr *vas_adsr_new(int tableSize)
 {
     vas_adsr *x = (vas_adsr *)malloc(sizeof(vas_adsr));
+    vas_adsr_init(x, (float *) vas_mem_allocAs(3 * tableSize * sizeof(float), VAS_MEM_ENVTABLE), tableSize);
+    return x;
+}
 
+void vas_adsr_init(vas_adsr *x, float *lookupTables, int tableSize)
+{
     x->tableSize = tableSize;
-    x->lookupTable_attack = (float *) vas_mem_alloc(x-> tableSize * sizeof(float));
-    x->lookupTable_decay = (float *) vas_mem_alloc(x-> tableSize * sizeof(float));
-    x->lookupTable_release = (float *) vas_mem_alloc(x-> tableSize * sizeof(float));
+    x->tableStorage = lookupTables;
     x->currentIndex = 0;
 
     x->att_q = 1;
@@ -33,16 +48,14 @@ vas_adsr *vas_adsr_new(int tableSize)
     x->currentMode = MODE_LFO;
 
     x->is_note_on = 0;
+    x->controlPeriod = 1;
 
     vas_adsr_updateADSR(x);
-    return x;
 }
 
 void vas_adsr_free(vas_adsr *x)
 {
-    vas_mem_free(x->lookupTable_attack);
-    vas_mem_free(x->lookupTable_decay);
-    vas_mem_free(x->lookupTable_release);
+    vas_mem_free(x->tableStorage);
     free(x);
 }
 
@@ -66,7 +79,7 @@ x->is_note_on = 0;
         case MODE_TRIGGER:
             x->currentStage = STAGE_RELEASE;
         break;
-        default: printf("fehler"); break;
+        default: vas_log_write("vas_adsr_noteOff: unknown mode %ld", (long)x->currentMode); break;
     }
 }
 
@@ -82,26 +95,31 @@ void vas_adsr_modeswitch(vas_adsr *x, float mode)
             x->currentMode = MODE_TRIGGER;
          break;
 
-         default: printf("fehler"); break;
+         default: vas_log_write("vas_adsr_modeswitch: unknown mode %ld", (long)mode); break;
      }
 }
 
-void vas_adsr_process(vas_adsr *x, float *in, float *out, int vectorSize)
+void vas_adsr_setControlPeriod(vas_adsr *x, int controlPeriod)
 {
-    int i = vectorSize;
-    float currentValue;
-    
-    while(i--)
+    if(controlPeriod < 1)
+        controlPeriod = 1;
+    if(controlPeriod > ADSR_CONTROL_PERIOD_MAX)
+        controlPeriod = ADSR_CONTROL_PERIOD_MAX;
+    x->controlPeriod = controlPeriod;
+}
+
+/* writes the envelope values of one chunk and advances the stages */
+static void vas_adsr_render(vas_adsr *x, float *dest, int n)
+{
+    for(int i = 0; i < n; i++)
     {
-        currentValue = vas_adsr_get_current_value(x);
-        currentValue *= *in++;
+        dest[i] = vas_adsr_get_current_value(x);
 
         switch((int)x->currentMode) {
 
 	    case MODE_LFO: 
 
             x->currentIndex += vas_adsr_get_stepSize(x);
-            *out++ = currentValue;
 
              if(x->currentIndex >= x->tableSize){
                  x->currentIndex -= x->tableSize;
@@ -114,7 +132,6 @@ void vas_adsr_process(vas_adsr *x, float *in, float *out, int vectorSize)
             if(x->currentStage != STAGE_SILENT || x->currentStage != STAGE_SUSTAIN){
             x->currentIndex += vas_adsr_get_stepSize(x);
             } 
-            *out++ = currentValue;
 
             if(x->currentIndex >= x->tableSize){
                 x->currentIndex -= x->tableSize;
@@ -124,9 +141,357 @@ void vas_adsr_process(vas_adsr *x, float *in, float *out, int vectorSize)
             }
             break;
 
-	    default: printf("fehler"); break;
+	    default: vas_log_write("vas_adsr_process: unknown mode %ld", (long)x->currentMode); break;
+        }
+    }
+}
+
+/* number of samples until the index wraps and the stage may change */
+static int vas_adsr_samplesToNextStage(vas_adsr *x)
+{
+    float step = vas_adsr_get_stepSize(x);
+    int samples = (int)ceilf((x->tableSize - x->currentIndex) / step);
+    return samples > 0 ? samples : 1;
+}
+
+/* advances by n samples without crossing more than one stage transition */
+static void vas_adsr_advance(vas_adsr *x, int n)
+{
+    x->currentIndex += n * vas_adsr_get_stepSize(x);
+
+    if(x->currentIndex >= x->tableSize)
+    {
+        x->currentIndex -= x->tableSize;
+        if(x->currentMode == MODE_LFO || x->currentStage != STAGE_SUSTAIN)
+            vas_adsr_next_stage(x, x->currentMode);
+    }
+}
+
+/* control rate version of vas_adsr_render, interpolates between evaluations */
+static void vas_adsr_renderControlRate(vas_adsr *x, float *dest, int n)
+{
+    float value = vas_adsr_get_current_value(x);
+    int i = 0;
+
+    while(i < n)
+    {
+        int m = n - i;
+        int stageEnd = vas_adsr_samplesToNextStage(x);
+
+        if(m > x->controlPeriod)
+            m = x->controlPeriod;
+        if(m > stageEnd)
+            m = stageEnd;
+
+        vas_adsr_advance(x, m);
+
+        float next = vas_adsr_get_current_value(x);
+        float slope = (next - value) / m;
+        for(int j = 0; j < m; j++)
+            dest[i + j] = value + j * slope;
+
+        value = next;
+        i += m;
+    }
+}
+
+void vas_adsr_process(vas_adsr *x, float *in, float *out, int vectorSize)
+{
+    float envelope[VAS_UTIL_CHUNK];
+
+    VAS_TRACE_BEGIN("vas_adsr_process");
+
+    while(vectorSize > 0)
+    {
+        int n = vectorSize < VAS_UTIL_CHUNK ? vectorSize : VAS_UTIL_CHUNK;
+
+        if(x->controlPeriod > 1)
+            vas_adsr_renderControlRate(x, envelope, n);
+        else
+            vas_adsr_render(x, envelope, n);
+        vas_util_fmultiply(envelope, in, out, n);
+
+        in += n;
+        out += n;
+        vectorSize -= n;
+    }
+
+    VAS_TRACE_END("vas_adsr_process");
+}
+
+/* ---------------------------------------------------------------- envelope bank */
+
+/*
+ * The state of up to four envelopes, one per lane. Every stage is reduced to
+ * value = table[index] * gain + constant + decay * (index / size)^q,
+ * so all lanes are evaluated with the same instructions whatever their stage.
+ * A lane is reloaded from its adsr object only when its index wraps.
+ */
+typedef struct vas_adsr_lanes
+{
+    float index[VAS_ADSR_LANES];
+    float step[VAS_ADSR_LANES];
+    float size[VAS_ADSR_LANES];
+    float gain[VAS_ADSR_LANES];
+    float constant[VAS_ADSR_LANES];
+    float decay[VAS_ADSR_LANES];
+    float q[VAS_ADSR_LANES];
+    const float *table[VAS_ADSR_LANES];
+    int powMask;            /* lanes with q other than 1 */
+    int running;            /* lanes rendered by the vector loop */
+} vas_adsr_lanes;
+
+static const float vas_adsr_silence[1];
+
+static void vas_adsr_clearLane(vas_adsr_lanes *l, int k)
+{
+    l->index[k] = 0;
+    l->step[k] = 0;
+    l->size[k] = 1;
+    l->gain[k] = 0;
+    l->constant[k] = 0;
+    l->decay[k] = 0;
+    l->q[k] = 1;
+    l->table[k] = vas_adsr_silence;
+    l->powMask &= ~(1 << k);
+}
+
+/* mirrors vas_adsr_get_current_value and the advance of vas_adsr_render */
+static void vas_adsr_setLane(vas_adsr_lanes *l, int k, vas_adsr *x)
+{
+    float sustain = x->resultvolume * x->sus_v;
+
+    vas_adsr_clearLane(l, k);
+    l->index[k] = x->currentIndex;
+    l->size[k] = x->tableSize;
+    l->table[k] = x->lookupTable_attack;
+    if(x->currentMode == MODE_LFO || x->currentMode == MODE_TRIGGER)
+        l->step[k] = vas_adsr_get_stepSize(x);
+
+    switch(x->currentStage)
+    {
+        case STAGE_ATTACK:
+            l->gain[k] = 1;
+            break;
+        case STAGE_DECAY:
+            l->table[k] = x->lookupTable_decay;
+            l->gain[k] = 1;
+            l->decay[k] = sustain;
+            if(x->dec_q != 1)
+            {
+                l->q[k] = x->dec_q;
+                l->powMask |= 1 << k;
+            }
+            break;
+        case STAGE_SUSTAIN:
+            l->constant[k] = sustain;
+            break;
+        case STAGE_RELEASE:
+            l->table[k] = x->lookupTable_release;
+            l->gain[k] = sustain;
+            break;
+        default:
+            break;
+    }
+}
+
+/* the stage transition of vas_adsr_render for a lane whose index reached the table size */
+static void vas_adsr_wrapLane(vas_adsr_lanes *l, int k, vas_adsr *x)
+{
+    x->currentIndex = l->index[k] - x->tableSize;
+    if(x->currentMode == MODE_LFO || x->currentStage != STAGE_SUSTAIN)
+        vas_adsr_next_stage(x, x->currentMode);
+    vas_adsr_setLane(l, k, x);
+}
+
+static void vas_adsr_powLanes(vas_adsr_lanes *l, float *normalized)
+{
+    for(int k = 0; k < VAS_ADSR_LANES; k++)
+    {
+        if(l->powMask & (1 << k))
+            normalized[k] = powf(normalized[k], l->q[k]);
+    }
+}
+
+#ifdef VAS_ADSR_X86
+
+#define VAS_ADSR_SSE2_TARGET __attribute__((target("sse2")))
+
+VAS_ADSR_SSE2_TARGET static void vas_adsr_renderLanes_sse2(vas_adsr **adsrs, vas_adsr_lanes *l, float *interleaved, int n)
+{
+    __m128 index = _mm_loadu_ps(l->index);
+    __m128 step = _mm_loadu_ps(l->step);
+    __m128 size = _mm_loadu_ps(l->size);
+    __m128 gain = _mm_loadu_ps(l->gain);
+    __m128 constant = _mm_loadu_ps(l->constant);
+    __m128 decay = _mm_loadu_ps(l->decay);
+
+    for(int i = 0; i < n; i++)
+    {
+        int position[VAS_ADSR_LANES];
+        float table[VAS_ADSR_LANES];
+        __m128 normalized = _mm_div_ps(index, size);
+
+        /* the index is never negative, truncation is the floor */
+        _mm_storeu_si128((__m128i *)position, _mm_cvttps_epi32(index));
+        for(int k = 0; k < VAS_ADSR_LANES; k++)
+            table[k] = l->table[k][position[k]];
+
+        if(l->powMask)
+        {
+            float powered[VAS_ADSR_LANES];
+            _mm_storeu_ps(powered, normalized);
+            vas_adsr_powLanes(l, powered);
+            normalized = _mm_loadu_ps(powered);
+        }
+
+        __m128 value = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(table), gain), constant);
+        _mm_storeu_ps(interleaved + VAS_ADSR_LANES * i, _mm_add_ps(value, _mm_mul_ps(decay, normalized)));
+
+        index = _mm_add_ps(index, step);
+        int wrapped = _mm_movemask_ps(_mm_cmpge_ps(index, size));
+        if(wrapped)
+        {
+            _mm_storeu_ps(l->index, index);
+            for(int k = 0; k < VAS_ADSR_LANES; k++)
+            {
+                if(wrapped & (1 << k))
+                    vas_adsr_wrapLane(l, k, adsrs[k]);
+            }
+            index = _mm_loadu_ps(l->index);
+            step = _mm_loadu_ps(l->step);
+            size = _mm_loadu_ps(l->size);
+            gain = _mm_loadu_ps(l->gain);
+            constant = _mm_loadu_ps(l->constant);
+            decay = _mm_loadu_ps(l->decay);
+        }
+    }
+    _mm_storeu_ps(l->index, index);
+}
+
+#define vas_adsr_renderLanes vas_adsr_renderLanes_sse2
+#define VAS_ADSR_VECTOR(kernels) ((kernels) == VAS_UTIL_SSE2 || (kernels) == VAS_UTIL_AVX2)
+
+#endif /* VAS_ADSR_X86 */
+
+#ifdef VAS_ADSR_ARM
+
+static void vas_adsr_renderLanes_neon(vas_adsr **adsrs, vas_adsr_lanes *l, float *interleaved, int n)
+{
+    float32x4_t index = vld1q_f32(l->index);
+    float32x4_t step = vld1q_f32(l->step);
+    float32x4_t size = vld1q_f32(l->size);
+    float32x4_t gain = vld1q_f32(l->gain);
+    float32x4_t constant = vld1q_f32(l->constant);
+    float32x4_t decay = vld1q_f32(l->decay);
+
+    for(int i = 0; i < n; i++)
+    {
+        int32_t position[VAS_ADSR_LANES];
+        uint32_t reached[VAS_ADSR_LANES];
+        float table[VAS_ADSR_LANES];
+#ifdef __aarch64__
+        float32x4_t normalized = vdivq_f32(index, size);
+#else
+        float divided[VAS_ADSR_LANES];
+        vst1q_f32(divided, index);
+        for(int k = 0; k < VAS_ADSR_LANES; k++)
+            divided[k] /= l->size[k];
+        float32x4_t normalized = vld1q_f32(divided);
+#endif
+
+        /* the index is never negative, truncation is the floor */
+        vst1q_s32(position, vcvtq_s32_f32(index));
+        for(int k = 0; k < VAS_ADSR_LANES; k++)
+            table[k] = l->table[k][position[k]];
+
+        if(l->powMask)
+        {
+            float powered[VAS_ADSR_LANES];
+            vst1q_f32(powered, normalized);
+            vas_adsr_powLanes(l, powered);
+            normalized = vld1q_f32(powered);
+        }
+
+        float32x4_t value = vaddq_f32(vmulq_f32(vld1q_f32(table), gain), constant);
+        vst1q_f32(interleaved + VAS_ADSR_LANES * i, vaddq_f32(value, vmulq_f32(decay, normalized)));
+
+        index = vaddq_f32(index, step);
+        vst1q_u32(reached, vcgeq_f32(index, size));
+        int wrapped = 0;
+        for(int k = 0; k < VAS_ADSR_LANES; k++)
+            wrapped |= (reached[k] & 1) << k;
+        if(wrapped)
+        {
+            vst1q_f32(l->index, index);
+            for(int k = 0; k < VAS_ADSR_LANES; k++)
+            {
+                if(wrapped & (1 << k))
+                    vas_adsr_wrapLane(l, k, adsrs[k]);
+            }
+            index = vld1q_f32(l->index);
+            step = vld1q_f32(l->step);
+            size = vld1q_f32(l->size);
+            gain = vld1q_f32(l->gain);
+            constant = vld1q_f32(l->constant);
+            decay = vld1q_f32(l->decay);
         }
     }
+    vst1q_f32(l->index, index);
+}
+
+#define vas_adsr_renderLanes vas_adsr_renderLanes_neon
+#define VAS_ADSR_VECTOR(kernels) ((kernels) == VAS_UTIL_NEON)
+
+#endif /* VAS_ADSR_ARM */
+
+#ifndef VAS_ADSR_VECTOR
+#define VAS_ADSR_VECTOR(kernels) 0
+#endif
+
+void vas_adsr_processBank(vas_adsr **adsrs, int mask, float envelopes[][VAS_UTIL_CHUNK], int n)
+{
+    vas_adsr_lanes lanes;
+    int vector = VAS_ADSR_VECTOR(vas_util_getKernels());
+
+    VAS_TRACE_BEGIN("vas_adsr_processBank");
+
+    lanes.powMask = 0;
+    lanes.running = 0;
+    for(int k = 0; k < VAS_ADSR_LANES; k++)
+    {
+        vas_adsr_clearLane(&lanes, k);
+        if(!(mask & (1 << k)))
+            continue;
+        if(adsrs[k]->controlPeriod > 1)
+            vas_adsr_renderControlRate(adsrs[k], envelopes[k], n);
+        else if(!vector)
+            vas_adsr_render(adsrs[k], envelopes[k], n);
+        else
+        {
+            vas_adsr_setLane(&lanes, k, adsrs[k]);
+            lanes.running |= 1 << k;
+        }
+    }
+
+#ifdef vas_adsr_renderLanes
+    if(lanes.running)
+    {
+        float interleaved[VAS_ADSR_LANES * VAS_UTIL_CHUNK];
+
+        vas_adsr_renderLanes(adsrs, &lanes, interleaved, n);
+        for(int k = 0; k < VAS_ADSR_LANES; k++)
+        {
+            if(!(lanes.running & (1 << k)))
+                continue;
+            adsrs[k]->currentIndex = lanes.index[k];
+            for(int i = 0; i < n; i++)
+                envelopes[k][i] = interleaved[VAS_ADSR_LANES * i + k];
+        }
+    }
+#endif
+
+    VAS_TRACE_END("vas_adsr_processBank");
 }
 
 float vas_adsr_get_stepSize(vas_adsr *x)
@@ -172,20 +537,46 @@ void vas_adsr_next_stage(vas_adsr *x, int mode)
                 }
             break;
 
-	    default: printf("fehler"); break;
+	    default: vas_log_write("vas_adsr_next_stage: unknown mode %ld", (long)mode); break;
         }
 
 }
 
+int vas_adsr_needsTables(vas_adsr *x)
+{
+    return x->tableSize != VAS_TABLES_SIZE || x->att_q != 1 || x->dec_q != 1 || x->rel_q != 1;
+}
+
+/* points the curves at the private tables or the shared ones, returns 1 for the private tables */
+static int vas_adsr_pointTables(vas_adsr *x)
+{
+    float *tables = x->tableStorage;
+
+    /* the default curves are generated at build time, see vas_tables_gen.c */
+    if(!vas_adsr_needsTables(x) || !tables)
+        tables = (float *)vas_tables_adsr;
+
+    x->lookupTable_attack = tables;
+    x->lookupTable_decay = tables + x->tableSize;
+    x->lookupTable_release = tables + 2 * x->tableSize;
+    return tables == x->tableStorage;
+}
+
 void vas_adsr_updateADSR(vas_adsr *x)
 {   
     float x_val;
+
+    if(!vas_adsr_pointTables(x))
+        return;
+
+    VAS_TRACE_BEGIN("vas_adsr_updateADSR");
     for(int i = 0; i < x->tableSize; i++){
         x_val = (float)i / (float)x->tableSize;
         x->lookupTable_attack[i] = vas_adsr_func_slope_up(x_val,x->att_q);
         x->lookupTable_decay[i] = vas_adsr_func_slope_down(x_val,x->dec_q);
         x->lookupTable_release[i] = vas_adsr_func_slope_down(x_val,x->rel_q); 
     } 
+    VAS_TRACE_END("vas_adsr_updateADSR");
 }
 
 float vas_adsr_get_current_value(vas_adsr *x)
@@ -234,16 +625,17 @@ float vas_adsr_func_slope_down(float x,float q)
 
 void vas_adsr_setADSR_values(vas_adsr *x, float a, float d, float s, float r)
 {
-    if(a>0 && a!=x->att_t){x->att_t = a;}
-    if(d>0 && d!=x->dec_t){x->dec_t = d;}
+    /* at ADSR_MAX and above the step size is zero or negative and the index would leave the table */
+    if(a>0 && a<ADSR_MAX && a!=x->att_t){x->att_t = a;}
+    if(d>0 && d<ADSR_MAX && d!=x->dec_t){x->dec_t = d;}
     if(s<=1 && s!=x->sus_v){x->sus_v = s;}
-    if(r>0 && r!=x->rel_t){x->rel_t = r;}
+    if(r>0 && r<ADSR_MAX && r!=x->rel_t){x->rel_t = r;}
 }
 
 void vas_adsr_set_Silent_time(vas_adsr *x, float st, float sus_t)
 {
-    if(st>0 && st!=x->silent_time){x->silent_time = st;}
-    if(sus_t>0 && sus_t!=x->sustain_time){x->sustain_time = sus_t;}
+    if(st>0 && st<ADSR_MAX && st!=x->silent_time){x->silent_time = st;}
+    if(sus_t>0 && sus_t<ADSR_MAX && sus_t!=x->sustain_time){x->sustain_time = sus_t;}
 }
 
 void vas_adsr_setQ(vas_adsr *x, float qa, float qd, float qr){
@@ -253,9 +645,81 @@ void vas_adsr_setQ(vas_adsr *x, float qa, float qd, float qr){
     vas_adsr_updateADSR(x);
 }
 
+static void *vas_adsr_curves_thread(void *arg)
+{
+    vas_adsr_curves *x = (vas_adsr_curves *)arg;
+    int expected = VAS_ADSR_CURVES_RUNNING;
+    vas_adsr scratch;
+
+    /* the same code as a synchronous update, so both give the same curves */
+    scratch.tableSize = x->tableSize;
+    scratch.att_q = x->att_q;
+    scratch.dec_q = x->dec_q;
+    scratch.rel_q = x->rel_q;
+    scratch.tableStorage = x->tables;
+    vas_adsr_updateADSR(&scratch);
+
+    /* nobody waits for a cancelled job, it cleans up after itself */
+    if(!atomic_compare_exchange_strong(&x->state, &expected, VAS_ADSR_CURVES_DONE))
+    {
+        vas_mem_free(x->tables);
+        vas_mem_free(x);
+    }
+    return NULL;
+}
+
+vas_adsr_curves *vas_adsr_curves_start(vas_adsr *x, float qa, float qd, float qr)
+{
+    vas_adsr_curves *job = (vas_adsr_curves *) vas_mem_allocAs(sizeof(vas_adsr_curves), VAS_MEM_SCRATCH);
 
+    job->tableSize = x->tableSize;
+    job->att_q = qa > 0 ? qa : x->att_q;
+    job->dec_q = qd > 0 ? qd : x->dec_q;
+    job->rel_q = qr > 0 ? qr : x->rel_q;
+    job->tables = (float *) vas_mem_allocAs(3 * x->tableSize * sizeof(float), VAS_MEM_ENVTABLE);
+    atomic_init(&job->state, VAS_ADSR_CURVES_RUNNING);
+
+    if(pthread_create(&job->thread, NULL, vas_adsr_curves_thread, job))
+    {
+        vas_mem_free(job->tables);
+        vas_mem_free(job);
+        return NULL;
+    }
+    return job;
+}
 
+int vas_adsr_curves_done(vas_adsr_curves *x)
+{
+    return atomic_load(&x->state) == VAS_ADSR_CURVES_DONE;
+}
 
+float *vas_adsr_curves_finish(vas_adsr_curves *x, vas_adsr *adsr)
+{
+    float *replaced = adsr->tableStorage;
+
+    pthread_join(x->thread, NULL);
+    adsr->tableStorage = x->tables;
+    adsr->att_q = x->att_q;
+    adsr->dec_q = x->dec_q;
+    adsr->rel_q = x->rel_q;
+    vas_adsr_pointTables(adsr);
+    vas_mem_free(x);
+    return replaced;
+}
 
+void vas_adsr_curves_cancel(vas_adsr_curves *x)
+{
+    int expected = VAS_ADSR_CURVES_RUNNING;
 
+    if(!x)
+        return;
 
+    if(atomic_compare_exchange_strong(&x->state, &expected, VAS_ADSR_CURVES_CANCELLED))
+        pthread_detach(x->thread);
+    else
+    {
+        pthread_join(x->thread, NULL);
+        vas_mem_free(x->tables);
+        vas_mem_free(x);
+    }
+}
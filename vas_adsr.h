@@ -14,8 +14,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include "vas_mem.h"
 #include "vas_util.h"
+#include "vas_tables.h"
 
 #define MODE_LFO 0
 #define MODE_TRIGGER 1 
@@ -32,9 +35,18 @@
 #define SCALE_RELEASE 10
 #define SCALE_SILENT 10
 
+/** Envelopes advanced together by vas_adsr_processBank */
+#define VAS_ADSR_LANES 4
+
 #define ADSR_MAX 100.0F
+#define ADSR_CONTROL_PERIOD_MAX 256
 #define VELOCITY_MAX 128.0F
 
+/** States of a vas_adsr_curves job */
+#define VAS_ADSR_CURVES_RUNNING 0
+#define VAS_ADSR_CURVES_DONE 1
+#define VAS_ADSR_CURVES_CANCELLED 2
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -46,11 +58,14 @@ extern "C" {
  */
 typedef struct vas_adsr
 {
+    /* hot: touched on every sample by vas_adsr_process */
+    float currentIndex;             /**< The parameter for current Index from tablesize*/
+    int currentStage;               /**< The parameter value for adjusting the current Stage*/
+    int currentMode;                /**< The parameter value for switching between LOOP(LFO)*/
     int tableSize;                  /**< The parameter for the tablesize of vas_adsr object */
     float *lookupTable_attack;      /**< The pointer to lookupTable_attack  */
     float *lookupTable_decay;       /**< The pointer to lookupTable_decay*/
     float *lookupTable_release;     /**< The pointer to lookupTable_release*/
-    float currentIndex;             /**< The parameter for current Index from tablesize*/
 
     float att_t;                    /**< The parameter value for adjusting the attack duration */
     float dec_t;                    /**< The parameter value for adjusting the decay duration */
@@ -60,17 +75,33 @@ typedef struct vas_adsr
     float silent_time;              /**< The parameter value for adjusting the silent time between Loops*/
     float sustain_time;             /**< The parameter value for adjusting the sustain time between Loops*/
 
-    float att_q;                    /**< The parameter value for adjusting the attack q-factor*/
     float dec_q;                    /**< The parameter value for adjusting the decay q-factor*/
-    float rel_q;                    /**< The parameter value for adjusting the release q-factor */
     float resultvolume;             /**< The parameter value for adjusting the volume */
-
-    int currentStage;               /**< The parameter value for adjusting the current Stage*/
-    int currentMode;                /**< The parameter value for switching between LOOP(LFO)*/
     int is_note_on;                 /**< The parameter value for switching between note_on and note_off */
+    int controlPeriod;              /**< Samples between two evaluations of the envelope, 1 for audio rate */
+
+    /* cold: only read when the tables are rebuilt */
+    float att_q;                    /**< The parameter value for adjusting the attack q-factor*/
+    float rel_q;                    /**< The parameter value for adjusting the release q-factor */
+    float *tableStorage;            /**< Private tables for q-factors other than 1, owned by the caller of vas_adsr_init, may be NULL at the default table size */
 
 } vas_adsr;
 
+/**
+ * @struct vas_adsr_curves
+ * @brief Curves for new q-values being computed in the background. <br>
+ */
+typedef struct vas_adsr_curves
+{
+    pthread_t thread;       /**< the thread doing the work*/
+    atomic_int state;       /**< VAS_ADSR_CURVES_RUNNING, _DONE or _CANCELLED*/
+    float *tables;          /**< the result, attack, decay and release of tableSize floats each*/
+    int tableSize;          /**< samples per curve*/
+    float att_q;            /**< q-factor of the attack curve*/
+    float dec_q;            /**< q-factor of the decay curve*/
+    float rel_q;            /**< q-factor of the release curve*/
+} vas_adsr_curves;
+
 /**
  * @related vas_adsr
  * @brief Creates a new adsr object<br>
@@ -80,6 +111,18 @@ typedef struct vas_adsr
  */
 vas_adsr *vas_adsr_new(int tableSize);
 
+/**
+ * @related vas_adsr
+ * @brief Initializes an adsr object in memory owned by the caller<br>
+ * Used when the adsr and its tables live inside a vas_mem_arena. <br>
+ * With the default table size and q-factors the ADSR reads the shared
+ * vas_tables_adsr, lookupTables is only written once a q-factor changes. <br>
+ * @param x My adsr object <br>
+ * @param lookupTables storage for 3 * tableSize floats (attack, decay, release) <br>
+ * @param tableSize tablesize of adsr object <br>
+ */
+void vas_adsr_init(vas_adsr *x, float *lookupTables, int tableSize);
+
 /**
  * @related vas_adsr
  * @brief Frees a adsr object<br>
@@ -101,14 +144,41 @@ void vas_adsr_free(vas_adsr *x);
  */
 void vas_adsr_process(vas_adsr *x, float *in, float *out, int vector_size);
 
+/**
+ * @related vas_adsr
+ * @brief Renders the envelopes of up to VAS_ADSR_LANES adsr objects at once. <br>
+ * @param adsrs VAS_ADSR_LANES adsr objects, entries outside mask may be NULL <br>
+ * @param mask bit k set renders adsrs[k] into envelopes[k] <br>
+ * @param envelopes receives one chunk per lane, lanes outside mask are not written <br>
+ * @param n samples to render, at most VAS_UTIL_CHUNK <br>
+ * With SSE2 or NEON kernels selected the audio rate envelopes advance
+ * together, one lane each: index, step size and stage of all lanes live in
+ * one vector and stage transitions are found with a compare mask. Envelopes
+ * at control rate and the scalar kernel set render lane by lane. The result
+ * equals vas_adsr_process on a signal of ones. <br>
+ */
+void vas_adsr_processBank(vas_adsr **adsrs, int mask, float envelopes[][VAS_UTIL_CHUNK], int n);
+
 /**
  * @related vas_adsr
  * @brief Updates lookuptable parameters. <br>
  * @param x My adsr object <br>
  * Updates lookuptable parameters of adsr object with new q-values. <br>
+ * Switches back to the shared tables when all q-values are 1. Without
+ * private tables the shared ones stand in until the owner provides them,
+ * see vas_adsr_needsTables. <br>
  */
 void vas_adsr_updateADSR(vas_adsr *x);
 
+/**
+ * @related vas_adsr
+ * @brief Returns 1 if the curves need the private tables. <br>
+ * @param x My adsr object <br>
+ * Only q-values other than 1 or a table size other than VAS_TABLES_SIZE
+ * need them, the default curves are shared by all ADSRs. <br>
+ */
+int vas_adsr_needsTables(vas_adsr *x);
+
 /**
  * @related vas_adsr
  * @brief Sets ADSR Parameters. <br>
@@ -117,7 +187,8 @@ void vas_adsr_updateADSR(vas_adsr *x);
  * @param d parameter for decay time<br>
  * @param s parameter for sustian volume<br>
  * @param r parameter for release time<br>
- * Sets ADSR parameters of adsr object. <br>
+ * Sets ADSR parameters of adsr object. Times are above 0 and below ADSR_MAX,
+ * others are ignored. <br>
  */
 void vas_adsr_setADSR_values(vas_adsr *x, float a, float d, float s, float r);
 
@@ -158,13 +229,25 @@ void vas_adsr_noteOff(vas_adsr *x);
  */
 void vas_adsr_modeswitch(vas_adsr *x, float mode);
 
+/**
+ * @related vas_adsr
+ * @brief Switches between audio rate and control rate evaluation. <br>
+ * @param x My adsr object <br>
+ * @param controlPeriod samples between two evaluations, 1 for audio rate <br>
+ * At control rate the envelope is evaluated every controlPeriod samples and
+ * interpolated linearly in between. Sub-blocks end at every stage transition,
+ * so short attacks still reach their peak. <br>
+ */
+void vas_adsr_setControlPeriod(vas_adsr *x, int controlPeriod);
+
 /**
  * @related vas_adsr
  * @brief Sets the silent time and sustain time in LOOP(LFO) Mode. <br>
  * @param x My adsr object <br>
  * @param st the parameter for relative silent time <br>
  * @param sus_time the parameter relative sustain time <br>
- Sets the silent time and sustain time in LOOP(LFO) Mode.
+ Sets the silent time and sustain time in LOOP(LFO) Mode. Both are above 0 and
+ below ADSR_MAX, others are ignored.
  */
 void vas_adsr_set_Silent_time(vas_adsr *x,float st, float sus_time);
 
@@ -215,6 +298,43 @@ float vas_adsr_func_slope_up(float x,float q);
  */
 float vas_adsr_func_slope_down(float x,float q);
 
+/**
+ * @related vas_adsr_curves
+ * @brief Starts computing the curves of an ADSR for new q-values <br>
+ * The curves take a few milliseconds at the default table size, too long
+ * for a message handler that shares its thread with the audio. <br>
+ * @param x the ADSR, only its table size and current q-values are read <br>
+ * @param qa q-factor of the attack, 0 or below keeps the current one <br>
+ * @param qd q-factor of the decay, 0 or below keeps the current one <br>
+ * @param qr q-factor of the release, 0 or below keeps the current one <br>
+ * @return the job or NULL if no thread could be started <br>
+ */
+vas_adsr_curves *vas_adsr_curves_start(vas_adsr *x, float qa, float qd, float qr);
+
+/**
+ * @related vas_adsr_curves
+ * @brief Returns 1 once the curves are ready, never blocks <br>
+ * @param x the job <br>
+ */
+int vas_adsr_curves_done(vas_adsr_curves *x);
+
+/**
+ * @related vas_adsr_curves
+ * @brief Waits for the job, hands its curves and q-values to an ADSR and frees the job <br>
+ * Nothing may render the ADSR meanwhile. <br>
+ * @param x the job <br>
+ * @param adsr the ADSR the job was started for <br>
+ * @return the private tables the curves replace, to be freed by the caller with vas_mem_free <br>
+ */
+float *vas_adsr_curves_finish(vas_adsr_curves *x, vas_adsr *adsr);
+
+/**
+ * @related vas_adsr_curves
+ * @brief Drops a job without waiting, a running thread frees it when it is done <br>
+ * @param x the job, may be NULL <br>
+ */
+void vas_adsr_curves_cancel(vas_adsr_curves *x);
+
 #ifdef __cplusplus
 }
 #endif
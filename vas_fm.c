@@ -0,0 +1,673 @@
+/**
+ * @file vas_fm.c
+ * @author Alexander Wessels - responsible for Architecture, OSC-Basic and ADSR Curves Calculation and Trigger Mode. <br>
+ * Gideon Krumbach - responsible for Integration, Mode-Switching Support of Multiple Osc (volume and frequency factors),<br>
+ * ADSR Instances and LOOP(LFO) Mode. <br>
+ */
+#include "vas_fm.h"
+#include "vas_trace.h"
+#include <string.h>
+
+static void vas_fm_selectKernel(vas_fm *x);
+
+vas_fm *vas_fm_new(void)
+{
+    /* engine, then all oscillators, then all ADSRs (packed), the tables follow when they are needed */
+    vas_mem_arena *arena = vas_mem_arena_new(VAS_MEM_ALIGN(sizeof(vas_fm))
+                                             + VAS_MEM_ALIGN(4 * sizeof(vas_osc))
+                                             + VAS_MEM_ALIGN(4 * sizeof(vas_adsr)));
+
+    vas_fm *x = (vas_fm *) vas_mem_arena_alloc(arena, sizeof(vas_fm));
+    x->arena = arena;
+
+    x->master_amp=1;
+    x->master_frequency=440;
+    x->current_algorithm=ALG_1;
+
+    vas_osc *oscs = (vas_osc *) vas_mem_arena_alloc(x->arena, 4 * sizeof(vas_osc));
+    vas_adsr *adsrs = (vas_adsr *) vas_mem_arena_alloc(x->arena, 4 * sizeof(vas_adsr));
+
+    x->osc1 = &oscs[0];
+    x->osc2 = &oscs[1];
+    x->osc3 = &oscs[2];
+    x->osc4 = &oscs[3];
+
+    x->adsr1 = &adsrs[0];
+    x->adsr2 = &adsrs[1];
+    x->adsr3 = &adsrs[2];
+    x->adsr4 = &adsrs[3];
+    for(int i = 0; i < 4; i++)
+    {
+        x->oscs[i] = &oscs[i];
+        x->adsrs[i] = &adsrs[i];
+        /* the default sine and curves are shared, see vas_tables.h */
+        vas_osc_init(x->oscs[i], NULL, SAMPLING_FREQUENCY, x->master_frequency);
+        vas_adsr_init(x->adsrs[i], NULL, SAMPLING_FREQUENCY);
+        x->customSize[i] = 0;
+    }
+
+    x->osc1_active = 1;
+    x->osc2_active = 0;
+    x->osc3_active = 0;
+    x->osc4_active = 0;
+    x->adsr1_active = 0;
+    x->adsr2_active = 0;
+    x->adsr3_active = 0;
+    x->adsr4_active = 0;
+
+    for(int i = 0; i < 4; i++)
+    {
+        x->wavetable[i] = NULL;
+        x->controlPeriod[i] = 1;
+        x->lfo[i] = NULL;
+    }
+    x->lfoMask = 0;
+    x->sineLookup = 0;
+    x->minControlPeriod = 1;
+
+    vas_fm_selectKernel(x);
+
+    return x;
+}
+
+void vas_fm_free(vas_fm *x)
+{
+    /* the engine itself, oscillators and ADSRs live in the arena */
+    for(int i = 0; i < 4; i++)
+    {
+        vas_wavetable_release(x->wavetable[i]);
+        vas_mem_free(x->oscs[i]->tableStorage);
+        vas_mem_free(x->adsrs[i]->tableStorage);
+    }
+    vas_mem_arena_free(x->arena);
+}
+
+/* copies the chain signal after operator index into its tap, silence for inactive operators */
+static void vas_fm_tap(float **taps, int index, int active, const float *signal, int n)
+{
+    if(!taps)
+        return;
+    if(active)
+        vas_util_fcopy(signal, taps[index], n);
+    else
+        vas_util_ffill(taps[index], 0, n);
+}
+
+/*
+ * One kernel per algorithm and operator state, generated by the macros below.
+ * The state of an operator is 0 (oscillator off), 1 (oscillator on) or
+ * 2 (oscillator and ADSR on), the oscillator modes of each algorithm are
+ * fixed at compile time:
+ *
+ *   algorithm 1: every oscillator modulates the next one
+ *   algorithm 2: oscillator 2 is summed, 3 and 4 modulate
+ *   algorithm 3: oscillators 2 and 3 are summed, 4 modulates
+ *   algorithm 4: all oscillators are summed
+ *
+ * Oscillator 1 is always the carrier. vas_fm_selectKernel picks the kernel
+ * whenever the algorithm or an I/O toggle changes. A kernel renders at most
+ * VAS_UTIL_CHUNK samples and applies the envelopes vas_fm_processTaps has
+ * computed for the chunk.
+ *
+ * The carrier and the summed oscillators take no input, so their phases do
+ * not depend on each other. When two or more of them are active,
+ * vas_fm_processTaps renders their raw waves together with
+ * vas_osc_processLanes and the kernel only applies amp and input to them;
+ * modulators always run in the serial chain.
+ */
+#define VAS_FM_MODE_1_2 Modulator
+#define VAS_FM_MODE_1_3 Modulator
+#define VAS_FM_MODE_1_4 Modulator
+#define VAS_FM_MODE_2_2 Sum
+#define VAS_FM_MODE_2_3 Modulator
+#define VAS_FM_MODE_2_4 Modulator
+#define VAS_FM_MODE_3_2 Sum
+#define VAS_FM_MODE_3_3 Sum
+#define VAS_FM_MODE_3_4 Modulator
+#define VAS_FM_MODE_4_2 Sum
+#define VAS_FM_MODE_4_3 Sum
+#define VAS_FM_MODE_4_4 Sum
+
+/* bits of the oscillators without input per algorithm, see independentMask */
+static const int vas_fm_summed[4] = {0x1, 0x3, 0x7, 0xF};
+
+#define VAS_FM_OSC(mode, k, out, n) VAS_FM_OSC_(mode, k, out, n)
+#define VAS_FM_OSC_(mode, k, out, n) VAS_FM_OSC_##mode(k, out, n)
+#define VAS_FM_OSC_Modulator(k, out, n) vas_osc_processModulator(x->osc##k, out, out, n)
+#define VAS_FM_OSC_Carrier(k, out, n) \
+    if(x->waveMask & (1 << (k - 1))) vas_osc_applyCarrier(x->osc##k, x->wave[k - 1], out, n); \
+    else vas_osc_processCarrier(x->osc##k, out, out, n)
+#define VAS_FM_OSC_Sum(k, out, n) \
+    if(x->waveMask & (1 << (k - 1))) vas_osc_applySum(x->osc##k, x->wave[k - 1], out, out, n); \
+    else vas_osc_processSum(x->osc##k, out, out, n)
+
+#define VAS_FM_STAGE(k, state, mode) \
+    if(state) { VAS_FM_OSC(mode, k, out, n); } \
+    if(state == 2) vas_util_fmultiply(x->envelope[k - 1], out, out, n); \
+    vas_fm_tap(taps, k - 1, state, out, n);
+
+#define VAS_FM_KERNEL(alg, s1, s2, s3, s4) \
+static void vas_fm_kernel_##alg##_##s1##s2##s3##s4(vas_fm *x, float *out, float **taps, int n) \
+{ \
+    VAS_FM_STAGE(1, s1, Carrier) \
+    VAS_FM_STAGE(2, s2, VAS_FM_MODE_##alg##_2) \
+    VAS_FM_STAGE(3, s3, VAS_FM_MODE_##alg##_3) \
+    VAS_FM_STAGE(4, s4, VAS_FM_MODE_##alg##_4) \
+}
+
+#define VAS_FM_ENTRY(alg, s1, s2, s3, s4) vas_fm_kernel_##alg##_##s1##s2##s3##s4,
+
+/* calls X for all 81 operator states of an algorithm, index s1 * 27 + s2 * 9 + s3 * 3 + s4 */
+#define VAS_FM_STATES4(X, alg, s1, s2, s3) X(alg, s1, s2, s3, 0) X(alg, s1, s2, s3, 1) X(alg, s1, s2, s3, 2)
+#define VAS_FM_STATES3(X, alg, s1, s2) VAS_FM_STATES4(X, alg, s1, s2, 0) VAS_FM_STATES4(X, alg, s1, s2, 1) VAS_FM_STATES4(X, alg, s1, s2, 2)
+#define VAS_FM_STATES2(X, alg, s1) VAS_FM_STATES3(X, alg, s1, 0) VAS_FM_STATES3(X, alg, s1, 1) VAS_FM_STATES3(X, alg, s1, 2)
+#define VAS_FM_STATES(X, alg) VAS_FM_STATES2(X, alg, 0) VAS_FM_STATES2(X, alg, 1) VAS_FM_STATES2(X, alg, 2)
+
+VAS_FM_STATES(VAS_FM_KERNEL, 1)
+VAS_FM_STATES(VAS_FM_KERNEL, 2)
+VAS_FM_STATES(VAS_FM_KERNEL, 3)
+VAS_FM_STATES(VAS_FM_KERNEL, 4)
+
+static const vas_fm_kernel vas_fm_kernels[4][81] =
+{
+    {VAS_FM_STATES(VAS_FM_ENTRY, 1)},
+    {VAS_FM_STATES(VAS_FM_ENTRY, 2)},
+    {VAS_FM_STATES(VAS_FM_ENTRY, 3)},
+    {VAS_FM_STATES(VAS_FM_ENTRY, 4)}
+};
+
+static int vas_fm_state(int osc_active, int adsr_active)
+{
+    return osc_active ? (adsr_active ? 2 : 1) : 0;
+}
+
+static void vas_fm_selectKernel(vas_fm *x)
+{
+    int state = vas_fm_state(x->osc1_active, x->adsr1_active) * 27
+              + vas_fm_state(x->osc2_active, x->adsr2_active) * 9
+              + vas_fm_state(x->osc3_active, x->adsr3_active) * 3
+              + vas_fm_state(x->osc4_active, x->adsr4_active);
+
+    x->envelopeMask = (state / 27 == 2) | (state / 9 % 3 == 2) << 1
+                    | (state / 3 % 3 == 2) << 2 | (state % 3 == 2) << 3;
+    x->independentMask = 0;
+
+    if(x->current_algorithm >= ALG_1 && x->current_algorithm <= ALG_4)
+    {
+        x->kernel = vas_fm_kernels[x->current_algorithm - 1][state];
+        x->independentMask = vas_fm_summed[x->current_algorithm - 1]
+                           & (x->osc1_active | x->osc2_active << 1 | x->osc3_active << 2 | x->osc4_active << 3);
+    }
+    else
+        x->kernel = NULL;
+}
+
+/* renders the independent oscillators together, unless fewer than two would share the lanes */
+static void vas_fm_renderWaves(vas_fm *x, int n)
+{
+    int mask = x->independentMask;
+
+    /* a computed carrier sine is rotated, which is cheaper than any lane */
+    if(x->osc1->isSine && !x->osc1->morphPairs)
+        mask &= ~1;
+    x->waveMask = mask & (mask - 1) ? mask : 0;
+    if(x->waveMask)
+        vas_osc_processLanes(x->oscs, x->waveMask, x->wave, n);
+}
+
+void vas_fm_process(vas_fm *x, float *in, float *out, int n)
+{
+    vas_fm_processTaps(x, in, out, NULL, n);
+}
+
+void vas_fm_processTaps(vas_fm *x, float *in, float *out, float **taps, int n)
+{
+    VAS_TRACE_BEGIN("vas_fm_process");
+
+    /* the algorithms chain the operators in place, an active carrier overwrites the input */
+    if(!x->osc1_active || !x->kernel)
+        vas_util_fcopy(in, out, n);
+
+    for(int i = 0; x->kernel && i < n; i += VAS_UTIL_CHUNK)
+    {
+        int m = n - i < VAS_UTIL_CHUNK ? n - i : VAS_UTIL_CHUNK;
+        float *chunkTaps[4];
+
+        if(x->envelopeMask & ~x->lfoMask)
+            vas_adsr_processBank(x->adsrs, x->envelopeMask & ~x->lfoMask, x->envelope, m);
+        for(int k = 0; k < 4; k++)
+            if(x->envelopeMask & x->lfoMask & (1 << k))
+                for(int j = 0; j < m; j++)
+                    x->envelope[k][j] = x->lfoValue[k] + (i + j) * x->lfoSlope[k];
+        vas_fm_renderWaves(x, m);
+        if(taps)
+            for(int j = 0; j < 4; j++)
+                chunkTaps[j] = taps[j] + i;
+        x->kernel(x, out + i, taps ? chunkTaps : NULL, m);
+    }
+
+    vas_util_fscale(out, x->master_amp, out, n);
+    if(taps)
+        for(int i = 0; i < 4; i++)
+            vas_util_fscale(taps[i], x->master_amp, taps[i], n);
+
+    VAS_TRACE_END("vas_fm_process");
+}
+
+vas_osc *vas_fm_getOsc(vas_fm *x, int id)
+{
+    switch (id){
+        case OSC1_ID : return x->osc1;
+        case OSC2_ID : return x->osc2;
+        case OSC3_ID : return x->osc3;
+        case OSC4_ID : return x->osc4;
+        default : return NULL;
+    }
+}
+
+vas_adsr *vas_fm_getAdsr(vas_fm *x, int id)
+{
+    switch (id){
+        case ADSR1_ID : return x->adsr1;
+        case ADSR2_ID : return x->adsr2;
+        case ADSR3_ID : return x->adsr3;
+        case ADSR4_ID : return x->adsr4;
+        default : return NULL;
+    }
+}
+
+/* drops the library an oscillator reads from, if any */
+static void vas_fm_releaseWavetable(vas_fm *x, int id)
+{
+    vas_wavetable_release(x->wavetable[id - OSC1_ID]);
+    x->wavetable[id - OSC1_ID] = NULL;
+}
+
+/* gives oscillator k a private table of size floats, the previous one is dropped */
+static void vas_fm_customStorage(vas_fm *x, int k, long size)
+{
+    vas_osc *osc = x->oscs[k];
+
+    if(x->customSize[k] == size)
+        return;
+    vas_mem_free(osc->tableStorage);
+    osc->tableStorage = (float *) vas_mem_allocAs(size * sizeof(float), VAS_MEM_OSCTABLE);
+    x->customSize[k] = size;
+}
+
+/* allocates the private curves of an ADSR once its q-values need them */
+static void vas_fm_prepareCurves(vas_adsr *adsr)
+{
+    if(adsr->tableStorage || !vas_adsr_needsTables(adsr))
+        return;
+    adsr->tableStorage = (float *) vas_mem_allocAs(3 * adsr->tableSize * sizeof(float), VAS_MEM_ENVTABLE);
+    vas_adsr_updateADSR(adsr);
+}
+
+float *vas_fm_customTable(vas_fm *x, int id)
+{
+    vas_osc *osc = vas_fm_getOsc(x, id);
+    if(!osc)
+        return NULL;
+
+    vas_fm_customStorage(x, id - OSC1_ID, osc->tableSize);
+    vas_fm_releaseWavetable(x, id);
+    return vas_osc_customTable(osc);
+}
+
+void vas_fm_referenceTable(vas_fm *x, int id, const float *samples, int length, int sampleStride)
+{
+    vas_osc *osc = vas_fm_getOsc(x, id);
+    if(!osc)
+        return;
+
+    vas_fm_releaseWavetable(x, id);
+    vas_osc_referenceTable(osc, samples, length, sampleStride);
+}
+
+void vas_fm_setTable(vas_fm *x, int id, const float *table, int length)
+{
+    vas_osc *osc = vas_fm_getOsc(x, id);
+    if(!osc || !table || length < 1)
+        return;
+
+    int size = vas_resample_size(length);
+    vas_fm_customStorage(x, id - OSC1_ID, size + 1);
+    vas_fm_releaseWavetable(x, id);
+    float *custom = vas_osc_customTable(osc);
+    vas_resample_cycle(table, length, 1, custom, size);
+    vas_osc_referenceTable(osc, custom, size, 1);
+}
+
+int vas_fm_setWavetable(vas_fm *x, int id, const char *path, int index)
+{
+    vas_osc *osc = vas_fm_getOsc(x, id);
+    vas_wavetable *library;
+    const float *levels;
+
+    if(!osc)
+        return 0;
+
+    library = vas_wavetable_open(path);
+    if(!library)
+        return 0;
+
+    levels = vas_wavetable_get(library, index, 0);
+    if(!levels)
+    {
+        vas_wavetable_release(library);
+        return 0;
+    }
+
+    /* opened before the old one is released, so switching tables of one library never unmaps it */
+    vas_osc_externalTable(osc, levels, library->tableSize, library->levelCount, library->stride);
+    vas_fm_releaseWavetable(x, id);
+    x->wavetable[id - OSC1_ID] = library;
+    return 1;
+}
+
+int vas_fm_setMorph(vas_fm *x, int id, const char *path)
+{
+    vas_osc *osc = vas_fm_getOsc(x, id);
+    vas_wavetable *library;
+    const float *pairs;
+
+    if(!osc)
+        return 0;
+
+    library = vas_wavetable_open(path);
+    if(!library)
+        return 0;
+
+    pairs = vas_wavetable_morph(library);
+    vas_osc_morphTable(osc, pairs, library->tableSize, library->levelCount, library->morphPairs,
+                       library->pairStride, library->morphStride);
+    vas_fm_releaseWavetable(x, id);
+    x->wavetable[id - OSC1_ID] = library;
+    return 1;
+}
+
+void vas_fm_osc_setPosition(vas_fm *x, int id, float position)
+{
+    vas_osc *osc = vas_fm_getOsc(x, id);
+    if(osc)
+        vas_osc_setPosition(osc, position);
+}
+
+void vas_fm_osc_setFrequency(vas_fm *x, int id, float frequency_factor)
+{
+    vas_osc *osc = vas_fm_getOsc(x, id);
+    if(osc)
+        vas_osc_set_frequency_factor(osc, x->master_frequency, frequency_factor);
+}
+
+void vas_fm_osc_set_Master_Frequency(vas_fm *x, float master_frequency)
+{
+    x->master_frequency=master_frequency;
+    vas_osc_set_master_frequency(x->osc1,x-> master_frequency);
+    vas_osc_set_master_frequency(x->osc2,x-> master_frequency);
+    vas_osc_set_master_frequency(x->osc3,x-> master_frequency);
+    vas_osc_set_master_frequency(x->osc4,x-> master_frequency);
+}
+
+void vas_fm_osc_setAmp(vas_fm *x, int id, float amp_factor)
+{
+    vas_osc *osc = vas_fm_getOsc(x, id);
+    if(osc)
+        vas_osc_setAmp(osc, amp_factor);
+}
+
+void vas_fm_osc_set_Master_Amp(vas_fm *x, float master_amp)
+{
+    x->master_amp=master_amp;
+}
+
+void vas_fm_setADSR(vas_fm *x, float a, float d, float s, float r, int id)
+{
+    vas_adsr *adsr = vas_fm_getAdsr(x, id);
+    if(adsr)
+        vas_adsr_setADSR_values(adsr, a, d, s, r);
+}
+
+void vas_fm_set_Silent_time(vas_fm *x, float st, float sus_t, int id)
+{
+    vas_adsr *adsr = vas_fm_getAdsr(x, id);
+    if(adsr)
+        vas_adsr_set_Silent_time(adsr, st, sus_t);
+}
+
+void vas_fm_setADSR_Q(vas_fm *x, float a, float d, float r, int id)
+{
+    vas_adsr *adsr = vas_fm_getAdsr(x, id);
+    if(!adsr)
+        return;
+
+    vas_adsr_setQ(adsr, a, d, r);
+    vas_fm_prepareCurves(adsr);
+}
+
+vas_adsr_curves *vas_fm_startCurves(vas_fm *x, float a, float d, float r, int id)
+{
+    vas_adsr *adsr = vas_fm_getAdsr(x, id);
+    vas_adsr_curves *curves;
+    if(!adsr)
+        return NULL;
+
+    /* the shared curves cover these q-values, nothing to compute */
+    if(adsr->tableSize == VAS_TABLES_SIZE && (a > 0 ? a : adsr->att_q) == 1
+        && (d > 0 ? d : adsr->dec_q) == 1 && (r > 0 ? r : adsr->rel_q) == 1)
+    {
+        vas_fm_setADSR_Q(x, a, d, r, id);
+        return NULL;
+    }
+
+    curves = vas_adsr_curves_start(adsr, a, d, r);
+    if(!curves)
+        vas_fm_setADSR_Q(x, a, d, r, id);
+    return curves;
+}
+
+void vas_fm_finishCurves(vas_fm *x, vas_adsr_curves *curves, int id)
+{
+    vas_adsr *adsr = vas_fm_getAdsr(x, id);
+    if(!adsr)
+    {
+        vas_adsr_curves_cancel(curves);
+        return;
+    }
+    vas_mem_free(vas_adsr_curves_finish(curves, adsr));
+}
+
+int vas_fm_missingCurves(vas_fm *x, int id)
+{
+    vas_adsr *adsr = vas_fm_getAdsr(x, id);
+    return adsr && !adsr->tableStorage && vas_adsr_needsTables(adsr);
+}
+
+void vas_fm_setADSR_rate(vas_fm *x, int controlPeriod, int id)
+{
+    vas_adsr *adsr = vas_fm_getAdsr(x, id);
+    if(!adsr)
+        return;
+
+    x->controlPeriod[id - ADSR1_ID] = controlPeriod;
+    vas_adsr_setControlPeriod(adsr, controlPeriod > x->minControlPeriod ? controlPeriod : x->minControlPeriod);
+}
+
+void vas_fm_setLFO(vas_fm *x, vas_lfo *lfo, int id)
+{
+    int k = id - ADSR1_ID;
+
+    if(k < 0 || k > 3)
+        return;
+    x->lfo[k] = lfo;
+    x->lfoMask = lfo ? x->lfoMask | 1 << k : x->lfoMask & ~(1 << k);
+    x->lfoValue[k] = lfo ? lfo->target : 0;
+    x->lfoSlope[k] = 0;
+}
+
+void vas_fm_advanceLFOs(vas_fm *x, double tick, int n, double seconds)
+{
+    for(int k = 0; k < 4; k++)
+    {
+        vas_lfo *lfo = x->lfo[k];
+        if(!lfo)
+            continue;
+        vas_lfo_advance(lfo, tick, seconds);
+        x->lfoValue[k] = lfo->value;
+        x->lfoSlope[k] = (lfo->target - lfo->value) / n;
+    }
+}
+
+void vas_fm_setQuality(vas_fm *x, int sineLookup, int minControlPeriod)
+{
+    x->sineLookup = sineLookup;
+    x->minControlPeriod = minControlPeriod;
+
+    for(int id = OSC1_ID; id <= OSC4_ID; id++)
+        vas_osc_setSineLookup(vas_fm_getOsc(x, id), sineLookup);
+    for(int id = ADSR1_ID; id <= ADSR4_ID; id++)
+        vas_fm_setADSR_rate(x, x->controlPeriod[id - ADSR1_ID], id);
+}
+
+void vas_fm_toggle_active(vas_fm *x, int id)
+{
+    switch (id){
+        case OSC1_ID :
+            x->osc1_active = abs(x->osc1_active - 1);
+            break;
+        case OSC2_ID :
+            x->osc2_active = abs(x->osc2_active - 1);
+            break;
+        case OSC3_ID :
+            x->osc3_active = abs(x->osc3_active - 1);
+            break;
+        case OSC4_ID :
+            x->osc4_active = abs(x->osc4_active - 1);
+            break;
+        case ADSR1_ID :
+            x->adsr1_active = abs(x->adsr1_active - 1);
+            break;
+        case ADSR2_ID :
+            x->adsr2_active = abs(x->adsr2_active - 1);
+            break;
+        case ADSR3_ID :
+            x->adsr3_active = abs(x->adsr3_active - 1);
+            break;
+        case ADSR4_ID :
+            x->adsr4_active = abs(x->adsr4_active - 1);
+            break;
+    }
+    vas_fm_selectKernel(x);
+}
+
+long vas_fm_releaseUnused(vas_fm *x)
+{
+    int adsrActive[4] = {x->adsr1_active, x->adsr2_active, x->adsr3_active, x->adsr4_active};
+    long released = 0;
+
+    for(int k = 0; k < 4; k++)
+    {
+        vas_osc *osc = x->oscs[k];
+        vas_adsr *adsr = x->adsrs[k];
+
+        /* a custom waveform cannot be computed again, it stays while the oscillator reads it */
+        if(osc->tableStorage && osc->lookupTable != osc->tableStorage)
+        {
+            released += x->customSize[k] * sizeof(float);
+            vas_mem_free(osc->tableStorage);
+            osc->tableStorage = NULL;
+            x->customSize[k] = 0;
+        }
+
+        if(adsr->tableStorage && (!adsrActive[k] || !vas_adsr_needsTables(adsr)))
+        {
+            released += 3 * adsr->tableSize * sizeof(float);
+            vas_mem_free(adsr->tableStorage);
+            adsr->tableStorage = NULL;
+            vas_adsr_updateADSR(adsr);
+        }
+    }
+    return released;
+}
+
+void vas_fm_noteOn(vas_fm *x, float frequency, float velocity)
+{
+    vas_fm_osc_set_Master_Frequency(x,frequency);
+    vas_adsr_noteOn(x->adsr1, velocity);
+    vas_adsr_noteOn(x->adsr2, velocity);
+    vas_adsr_noteOn(x->adsr3, velocity);
+    vas_adsr_noteOn(x->adsr4, velocity);
+}
+
+void vas_fm_noteOff(vas_fm *x)
+{
+    vas_adsr_noteOff(x->adsr1);
+    vas_adsr_noteOff(x->adsr2);
+    vas_adsr_noteOff(x->adsr3);
+    vas_adsr_noteOff(x->adsr4);
+}
+
+void vas_fm_ADSRmode(vas_fm *x, float mode, int id)
+{
+    vas_adsr *adsr = vas_fm_getAdsr(x, id);
+    if(adsr)
+        vas_adsr_modeswitch(adsr, mode);
+}
+
+void vas_fm_algorithmode(vas_fm *x, int alg_mode)
+{
+    x->current_algorithm = alg_mode;
+    vas_fm_selectKernel(x);
+}
+
+void vas_fm_reset_waveform(vas_fm *x, int id)
+{
+    vas_osc *osc = vas_fm_getOsc(x, id);
+    if(!osc)
+        return;
+
+    vas_osc_init(osc, osc->tableStorage, SAMPLING_FREQUENCY, x->master_frequency);
+    vas_osc_setSineLookup(osc, x->sineLookup);
+    vas_fm_releaseWavetable(x, id);
+}
+
+int vas_fm_message(vas_fm *x, const char *selector, int argc, const float *argv)
+{
+    float a[5] = {0, 0, 0, 0, 0};
+    for(int i = 0; i < argc && i < 5; i++)
+        a[i] = argv[i];
+
+    if(!strcmp(selector, "osc_freq"))
+        vas_fm_osc_setFrequency(x, (int)a[0], a[1]);
+    else if(!strcmp(selector, "osc_position"))
+        vas_fm_osc_setPosition(x, (int)a[0], a[1]);
+    else if(!strcmp(selector, "osc_amp"))
+        vas_fm_osc_setAmp(x, (int)a[0], a[1]);
+    else if(!strcmp(selector, "adsr"))
+        vas_fm_setADSR(x, a[0], a[1], a[2], a[3], (int)a[4]);
+    else if(!strcmp(selector, "adsr_Q"))
+        vas_fm_setADSR_Q(x, a[0], a[1], a[2], (int)a[3]);
+    else if(!strcmp(selector, "I/O"))
+        vas_fm_toggle_active(x, (int)a[0]);
+    else if(!strcmp(selector, "noteon"))
+        vas_fm_noteOn(x, a[0], a[1]);
+    else if(!strcmp(selector, "noteoff"))
+        vas_fm_noteOff(x);
+    else if(!strcmp(selector, "adsr_mode"))
+        vas_fm_ADSRmode(x, a[0], (int)a[1]);
+    else if(!strcmp(selector, "silent_time"))
+        vas_fm_set_Silent_time(x, a[0], a[1], (int)a[2]);
+    else if(!strcmp(selector, "osc_master_freq"))
+        vas_fm_osc_set_Master_Frequency(x, a[0]);
+    else if(!strcmp(selector, "osc_master_amp"))
+        vas_fm_osc_set_Master_Amp(x, a[0]);
+    else if(!strcmp(selector, "reset_waveform"))
+        vas_fm_reset_waveform(x, (int)a[0]);
+    else if(!strcmp(selector, "algorithm_mode"))
+        vas_fm_algorithmode(x, (int)a[0]);
+    else
+        return 0;
+
+    return 1;
+}
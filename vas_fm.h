@@ -0,0 +1,461 @@
+/**
+ * @file vas_fm.h
+ * @author Alexander Wessels and Gideon Krumbach<br>
+ * <br>
+ * @brief The FM engine behind rtap_fmMultiOsc~, independent of Pure Data.<br>
+ * <br>
+ * vas_fm owns four oscillators and four ADSRs and chains them according to
+ * the selected algorithm. The functions mirror the messages of the Pure Data
+ * object, so the object and the offline tools share one implementation.
+ * <br>
+ */
+
+#ifndef vas_fm_h
+#define vas_fm_h
+
+#include "vas_mem.h"
+#include "vas_util.h"
+#include "vas_osc.h"
+#include "vas_adsr.h"
+#include "vas_lfo.h"
+#include "vas_wavetable.h"
+#include "vas_resample.h"
+
+#define OSC1_ID 1
+#define OSC2_ID 2
+#define OSC3_ID 3
+#define OSC4_ID 4
+
+#define ADSR1_ID 11
+#define ADSR2_ID 12
+#define ADSR3_ID 13
+#define ADSR4_ID 14
+
+#define ALG_1 1
+#define ALG_2 2
+#define ALG_3 3
+#define ALG_4 4
+
+#define SAMPLING_FREQUENCY 44100
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct vas_fm;
+
+/** Renders one algorithm for one combination of active operators in place on out */
+typedef void (*vas_fm_kernel)(struct vas_fm *x, float *out, float **taps, int n);
+
+/**
+ * @struct vas_fm
+ * @brief A structure for vas_fm object. <br>
+ */
+typedef struct vas_fm
+{
+    vas_osc *osc1;          /**< Pointer to oscillator 1*/
+    int osc1_active;        /**< active/not active Toggle for oscillator 1*/
+    vas_osc *osc2;          /**< Pointer to oscillator 2*/
+    int osc2_active;        /**< active/not active Toggle for oscillator 2*/
+    vas_osc *osc3;          /**< Pointer to oscillator 3*/
+    int osc3_active;        /**< active/not active Toggle for oscillator 3*/
+    vas_osc *osc4;          /**< Pointer to oscillator 4*/
+    int osc4_active;        /**< active/not active Toggle for oscillator 4*/
+    vas_osc *oscs[VAS_OSC_LANES]; /**< oscillator 1 ... 4 as handed to vas_osc_processLanes*/
+    int independentMask;    /**< bit k set if oscillator k + 1 is active and its phase follows no other oscillator*/
+    int waveMask;           /**< oscillators rendered by vas_osc_processLanes in the current chunk*/
+    float wave[VAS_OSC_LANES][VAS_UTIL_CHUNK]; /**< their raw waves, read by the kernels*/
+
+    vas_adsr *adsr1;        /**< Pointer to ADSR 1*/
+    int adsr1_active;       /**< active/not active Toggle for ADSR 1*/
+    vas_adsr *adsr2;        /**< Pointer to ADSR 2*/
+    int adsr2_active;       /**< active/not active Toggle for ADSR 2*/
+    vas_adsr *adsr3;        /**< Pointer to ADSR 3*/
+    int adsr3_active;       /**< active/not active Toggle for ADSR 3*/
+    vas_adsr *adsr4;        /**< Pointer to ADSR 4*/
+    int adsr4_active;       /**< active/not active Toggle for ADSR 4*/
+    vas_adsr *adsrs[VAS_ADSR_LANES]; /**< ADSR 1 ... 4 as handed to vas_adsr_processBank*/
+    int envelopeMask;       /**< bit k set if ADSR k + 1 shapes an active oscillator*/
+    float envelope[VAS_ADSR_LANES][VAS_UTIL_CHUNK]; /**< envelopes of the current chunk, read by the kernels*/
+    vas_lfo *lfo[4];        /**< LFO replacing the envelope of ADSR 1 ... 4, NULL if none, owned by the caller*/
+    int lfoMask;            /**< bit k set if lfo[k] is set*/
+    float lfoValue[4];      /**< output of lfo[k] at the start of the block*/
+    float lfoSlope[4];      /**< increase of lfo[k] per sample of the block*/
+
+    float master_frequency; /**< Master frequency of fmMulitOsc*/
+    float master_amp;       /**< Master amp of fmMulitOsc*/
+    int current_algorithm;  /**< current used Algorithm*/
+    vas_fm_kernel kernel;   /**< kernel for current_algorithm and the active operators, NULL for an unknown algorithm*/
+
+    vas_wavetable *wavetable[4]; /**< Library oscillator 1 ... 4 reads from, NULL if none*/
+
+    int sineLookup;         /**< 1 if oscillators on the default sine read it from the table, see vas_fm_setQuality*/
+    int minControlPeriod;   /**< lower bound of the control period of every ADSR, see vas_fm_setQuality*/
+    int controlPeriod[4];   /**< control period of ADSR 1 ... 4 as set with vas_fm_setADSR_rate*/
+
+    long customSize[4];     /**< floats in the private table of oscillator 1 ... 4, 0 until one is needed*/
+
+    vas_mem_arena *arena;   /**< One aligned block holding this struct, all oscillators and ADSRs*/
+} vas_fm;
+
+/**
+ * @related vas_fm
+ * @brief Creates a new fm object<br>
+ * Oscillator 1 is active, everything else inactive, algorithm 1. All
+ * oscillators and ADSRs start on the shared default tables, private tables
+ * are only allocated by the messages that need them, see vas_fm_releaseUnused. <br>
+ * @return a pointer to the newly created fm object <br>
+ */
+vas_fm *vas_fm_new(void);
+
+/**
+ * @related vas_fm
+ * @brief Frees a fm object<br>
+ * @param x My fm object <br>
+ */
+void vas_fm_free(vas_fm *x);
+
+/**
+ * @related vas_fm
+ * @brief Renders one block. <br>
+ * @param x My fm object <br>
+ * @param in The input vector <br>
+ * @param out The output vector, may be identical to in <br>
+ * @param n The size of the i/o vectors <br>
+ * The input is copied to the output, the current algorithm is performed
+ * in place on the output and the master amp is applied. While oscillator 1
+ * is active the carrier replaces the input, which is then not read. The block is
+ * rendered in chunks of VAS_UTIL_CHUNK samples, the envelopes of each chunk
+ * are computed together by vas_adsr_processBank before the operators run. <br>
+ */
+void vas_fm_process(vas_fm *x, float *in, float *out, int n);
+
+/**
+ * @related vas_fm
+ * @brief Renders one block and also returns the signal of every operator. <br>
+ * @param x My fm object <br>
+ * @param in The input vector <br>
+ * @param out The output vector, may be identical to in <br>
+ * @param taps four vectors of size n, receive the signal after operator 1 ... 4
+ * and its ADSR (silence for inactive operators), with the master amp applied <br>
+ * @param n The size of the i/o vectors <br>
+ */
+void vas_fm_processTaps(vas_fm *x, float *in, float *out, float **taps, int n);
+
+/**
+ * @related vas_fm
+ * @brief Returns the oscillator for an id. <br>
+ * @param x My fm object <br>
+ * @param id OSC1_ID ... OSC4_ID <br>
+ * @return the oscillator or NULL for an unknown id <br>
+ */
+vas_osc *vas_fm_getOsc(vas_fm *x, int id);
+
+/**
+ * @related vas_fm
+ * @brief Returns the ADSR for an id. <br>
+ * @param x My fm object <br>
+ * @param id ADSR1_ID ... ADSR4_ID <br>
+ * @return the ADSR or NULL for an unknown id <br>
+ */
+vas_adsr *vas_fm_getAdsr(vas_fm *x, int id);
+
+/**
+ * @related vas_fm
+ * @brief Resamples one cycle of a waveform into the lookuptable of an oscillator. <br>
+ * The oscillator then reads the table instead of computing the sine. The
+ * waveform may have any length, it is resampled to vas_resample_size(length)
+ * samples on the calling thread. <br>
+ * @param x My fm object <br>
+ * @param id id of the oscillator<br>
+ * @param table one cycle of the waveform <br>
+ * @param length number of samples in table, at least 1 <br>
+ */
+void vas_fm_setTable(vas_fm *x, int id, const float *table, int length);
+
+/**
+ * @related vas_fm
+ * @brief Returns the private table of an oscillator for writing a custom waveform. <br>
+ * A wavetable library the oscillator read from is released. <br>
+ * @param x My fm object <br>
+ * @param id id of the oscillator<br>
+ * @return the table of tableSize samples or NULL for an unknown id <br>
+ */
+float *vas_fm_customTable(vas_fm *x, int id);
+
+/**
+ * @related vas_fm
+ * @brief Lets an oscillator read a table owned by the caller in place. <br>
+ * Nothing is copied, the table has to stay valid until the oscillator gets
+ * another one. A wavetable library the oscillator read from is released. <br>
+ * @param x My fm object <br>
+ * @param id id of the oscillator<br>
+ * @param samples the first sample <br>
+ * @param length samples per cycle <br>
+ * @param sampleStride floats from one sample to the next <br>
+ */
+void vas_fm_referenceTable(vas_fm *x, int id, const float *samples, int length, int sampleStride);
+
+/**
+ * @related vas_fm
+ * @brief Lets an oscillator read a waveform of a wavetable library. <br>
+ * The library is mapped, not copied, and shared with all other users of
+ * the same file. <br>
+ * @param x My fm object <br>
+ * @param id id of the oscillator<br>
+ * @param path file name of the library <br>
+ * @param index waveform in the library <br>
+ * @return 1 on success, 0 if the library cannot be opened or has no such waveform <br>
+ */
+int vas_fm_setWavetable(vas_fm *x, int id, const char *path, int index);
+
+/**
+ * @related vas_fm
+ * @brief Lets an oscillator morph between all waveforms of a wavetable library. <br>
+ * The waveforms are the frames in library order, see vas_fm_osc_setPosition.
+ * The interleaved frame pairs are built once per library and shared. <br>
+ * @param x My fm object <br>
+ * @param id id of the oscillator<br>
+ * @param path file name of the library <br>
+ * @return 1 on success, 0 if the library cannot be opened <br>
+ */
+int vas_fm_setMorph(vas_fm *x, int id, const char *path);
+
+/**
+ * @related vas_fm
+ * @brief Sets the morph position of an oscillator. <br>
+ * @param x My fm object <br>
+ * @param id id of oscillator<br>
+ * @param position frame of the library, fractions crossfade between neighbouring frames <br>
+ */
+void vas_fm_osc_setPosition(vas_fm *x, int id, float position);
+
+/**
+ * @related vas_fm
+ * @brief Sets frequency factor of oscillator. <br>
+ * @param x My fm object <br>
+ * @param id id of oscillator<br>
+ * @param frequency_factor frequency factor of osc<br>
+ */
+void vas_fm_osc_setFrequency(vas_fm *x, int id, float frequency_factor);
+
+/**
+ * @related vas_fm
+ * @brief Updates current master frequency <br>
+ * @param x My fm object <br>
+ * @param master_frequency master frequency of fm object<br>
+ */
+void vas_fm_osc_set_Master_Frequency(vas_fm *x, float master_frequency);
+
+/**
+ * @related vas_fm
+ * @brief Sets amp of oscillator. <br>
+ * @param x My fm object <br>
+ * @param id id of oscillator<br>
+ * @param amp_factor amp factor of oscillator<br>
+ */
+void vas_fm_osc_setAmp(vas_fm *x, int id, float amp_factor);
+
+/**
+ * @related vas_fm
+ * @brief Updates current master amp. <br>
+ * @param x My fm object <br>
+ * @param master_amp master amp of fm object<br>
+ */
+void vas_fm_osc_set_Master_Amp(vas_fm *x, float master_amp);
+
+/**
+ * @related vas_fm
+ * @brief Sets ADSR Parameters. <br>
+ * @param x My fm object <br>
+ * @param a parameter for attack time<br>
+ * @param d parameter for decay time<br>
+ * @param s parameter for sustain volume<br>
+ * @param r parameter for release time<br>
+ * @param id id of adsr<br>
+ */
+void vas_fm_setADSR(vas_fm *x, float a, float d, float s, float r, int id);
+
+/**
+ * @related vas_fm
+ * @brief Sets the silent time and sustain time in LOOP(LFO) Mode. <br>
+ * @param x My fm object <br>
+ * @param st the parameter for relative silent time <br>
+ * @param sus_t the parameter relative sustain time <br>
+ * @param id id of adsr<br>
+ */
+void vas_fm_set_Silent_time(vas_fm *x, float st, float sus_t, int id);
+
+/**
+ * @related vas_fm
+ * @brief Sets Q-ADR Parameters. <br>
+ * @param x My fm object <br>
+ * @param a parameter for Q-attack<br>
+ * @param d parameter for Q-decay<br>
+ * @param r parameter for Q-release<br>
+ * @param id id of adsr<br>
+ */
+void vas_fm_setADSR_Q(vas_fm *x, float a, float d, float r, int id);
+
+/**
+ * @related vas_fm
+ * @brief Sets Q-ADR Parameters without computing the curves on this thread. <br>
+ * The ADSR keeps its current q-values and curves until the job is handed to
+ * vas_fm_finishCurves. Q-values the shared curves cover are set right away,
+ * as they are when no thread can be started. <br>
+ * @param x My fm object <br>
+ * @param a parameter for Q-attack, 0 or below keeps the current one<br>
+ * @param d parameter for Q-decay, 0 or below keeps the current one<br>
+ * @param r parameter for Q-release, 0 or below keeps the current one<br>
+ * @param id id of adsr<br>
+ * @return the job computing the curves or NULL if nothing is left to do <br>
+ */
+vas_adsr_curves *vas_fm_startCurves(vas_fm *x, float a, float d, float r, int id);
+
+/**
+ * @related vas_fm
+ * @brief Installs the curves of a job from vas_fm_startCurves. <br>
+ * Call from the message thread with nothing rendering, once
+ * vas_adsr_curves_done returns 1 so it does not wait. <br>
+ * @param x My fm object <br>
+ * @param curves the job <br>
+ * @param id id of adsr the job was started for<br>
+ */
+void vas_fm_finishCurves(vas_fm *x, vas_adsr_curves *curves, int id);
+
+/**
+ * @related vas_fm
+ * @brief Returns 1 if an ADSR needs private curves it does not have. <br>
+ * That is the case for an ADSR switched on after vas_fm_releaseUnused freed
+ * its curves, vas_fm_startCurves with all q-values 0 computes them again. <br>
+ * @param x My fm object <br>
+ * @param id id of adsr<br>
+ */
+int vas_fm_missingCurves(vas_fm *x, int id);
+
+/**
+ * @related vas_fm
+ * @brief Lets an LFO replace the envelope of an ADSR. <br>
+ * @param x My fm object <br>
+ * @param lfo the LFO, owned by the caller, NULL to return to the ADSR <br>
+ * @param id id of adsr<br>
+ * The LFO shapes the oscillator only while the ADSR is active, the ADSR
+ * itself stands still meanwhile. <br>
+ */
+void vas_fm_setLFO(vas_fm *x, vas_lfo *lfo, int id);
+
+/**
+ * @related vas_fm
+ * @brief Moves the LFOs on and takes over their output for the next block. <br>
+ * @param x My fm object <br>
+ * @param tick logical time of the scheduler tick, see vas_lfo_advance <br>
+ * @param n samples of the next block <br>
+ * @param seconds duration of the next block <br>
+ * Call before every block from the thread that runs the scheduler. The
+ * block itself may then be rendered on another thread, it only reads the
+ * values taken over here. <br>
+ */
+void vas_fm_advanceLFOs(vas_fm *x, double tick, int n, double seconds);
+
+/**
+ * @related vas_fm
+ * @brief Sets the evaluation rate of an ADSR. <br>
+ * @param x My fm object <br>
+ * @param controlPeriod samples between two evaluations, 1 for audio rate <br>
+ * @param id id of adsr<br>
+ */
+void vas_fm_setADSR_rate(vas_fm *x, int controlPeriod, int id);
+
+/**
+ * @related vas_fm
+ * @brief Lowers or restores the rendering quality to save CPU time. <br>
+ * Settings made with the other functions are kept and apply again when the
+ * quality is restored. <br>
+ * @param x My fm object <br>
+ * @param sineLookup 1 to read the default sine from the table instead of computing it <br>
+ * @param minControlPeriod the ADSRs are evaluated at least every minControlPeriod samples, 1 for full quality <br>
+ */
+void vas_fm_setQuality(vas_fm *x, int sineLookup, int minControlPeriod);
+
+/**
+ * @related vas_fm
+ * @brief Toggles the active oscillators and ADSRs. <br>
+ * @param x My fm object <br>
+ * @param id the oscillator or adsr id<br>
+ */
+void vas_fm_toggle_active(vas_fm *x, int id);
+
+/**
+ * @related vas_fm
+ * @brief Frees the private tables no part needs at the moment. <br>
+ * @param x My fm object <br>
+ * The curves of ADSRs that are switched off or back on q-values of 1 and
+ * the custom waveforms oscillators no longer read are freed. An ADSR
+ * switched back on runs on the shared curves until vas_fm_setADSR_Q or
+ * vas_fm_startCurves computes its own again, see vas_fm_missingCurves.
+ * Call from the message thread, some time after the parts were switched
+ * off, so toggling them back and forth does not allocate every time. <br>
+ * @return bytes freed <br>
+ */
+long vas_fm_releaseUnused(vas_fm *x);
+
+/**
+ * @related vas_fm
+ * @brief Triggers a note_on in all ADSRs and resets the master frequency. <br>
+ * @param x My fm object <br>
+ * @param frequency of noteon<br>
+ * @param velocity sound level in Terms of MIDI  <br>
+ */
+void vas_fm_noteOn(vas_fm *x, float frequency, float velocity);
+
+/**
+ * @related vas_fm
+ * @brief Triggers a note_off in all ADSRs. <br>
+ * @param x My fm object <br>
+ */
+void vas_fm_noteOff(vas_fm *x);
+
+/**
+ * @related vas_fm
+ * @brief Switches between TRIGGER and LOOP(LFO) Mode of ADSR. <br>
+ * @param x My fm object <br>
+ * @param mode the parameter that adjusts the ADSR mode<br>
+ * @param id ID of ADSR<br>
+ */
+void vas_fm_ADSRmode(vas_fm *x, float mode, int id);
+
+/**
+ * @related vas_fm
+ * @brief Updates the current algorithm. <br>
+ * @param x My fm object <br>
+ * @param alg_mode current algorithm id<br>
+ */
+void vas_fm_algorithmode(vas_fm *x, int alg_mode);
+
+/**
+ * @related vas_fm
+ * @brief Reset waveform of oscillator to sinewave. <br>
+ * @param x My fm object <br>
+ * @param id the oscillator id<br>
+ */
+void vas_fm_reset_waveform(vas_fm *x, int id);
+
+/**
+ * @related vas_fm
+ * @brief Dispatches a message with numeric arguments by selector. <br>
+ * Understands the same selectors and argument order as rtap_fmMultiOsc~
+ * (osc_freq, adsr, algorithm_mode, ...), missing arguments are 0 like
+ * A_DEFFLOAT. Used by the offline tools to replay Pure Data messages. <br>
+ * @param x My fm object <br>
+ * @param selector the message name <br>
+ * @param argc number of arguments <br>
+ * @param argv the arguments <br>
+ * @return 1 if the selector is known, 0 otherwise <br>
+ */
+int vas_fm_message(vas_fm *x, const char *selector, int argc, const float *argv);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* vas_fm_h */
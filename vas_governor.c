@@ -0,0 +1,181 @@
+/**
+ * @file vas_governor.c
+ * @brief Process-wide CPU budget with graceful quality degradation <br>
+ */
+#include "vas_governor.h"
+#include "vas_mem.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/** Consecutive ticks over budget before the quality is stepped down, about 6 ms at 64 samples */
+#define VAS_GOVERNOR_DOWNTICKS 4
+/** Consecutive ticks with headroom before the quality is stepped up, about 0.5 s at 64 samples */
+#define VAS_GOVERNOR_UPTICKS 345
+/** A tick has headroom below this fraction of the budget */
+#define VAS_GOVERNOR_HEADROOM 0.6
+
+/* share of the voices rendered in the tiers from VAS_GOVERNOR_TIER_VOICES on, in quarters */
+static const int vas_governor_quarters[VAS_GOVERNOR_TIERS] = {4, 4, 4, 3, 2, 1};
+
+static vas_governor *vas_governor_shared;
+
+vas_governor *vas_governor_acquire(void)
+{
+    if(!vas_governor_shared)
+        vas_governor_shared = (vas_governor *) vas_mem_alloc(sizeof(vas_governor));
+    vas_governor_shared->refCount++;
+    return vas_governor_shared;
+}
+
+void vas_governor_release(vas_governor *x)
+{
+    if(!x || --x->refCount > 0)
+        return;
+    vas_governor_shared = NULL;
+    vas_mem_free(x);
+}
+
+double vas_governor_now(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER count, frequency;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (double)count.QuadPart / frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+}
+
+/* renders the newest voices of the current tier and drops the others */
+static void vas_governor_assignVoices(vas_governor *x)
+{
+    int keep = (x->voiceCount * vas_governor_quarters[x->tier] + 3) / 4;
+    int rank = 0;
+
+    if(keep < 1)
+        keep = 1;
+    for(vas_governor_voice *voice = x->newest; voice; voice = voice->older)
+        voice->active = rank++ < keep;
+    x->voicesDirty = 0;
+}
+
+static void vas_governor_setTier(vas_governor *x, int tier)
+{
+    if(tier == x->tier)
+        return;
+    x->tier = tier;
+    x->decisions++;
+    x->over = 0;
+    x->under = 0;
+    x->voicesDirty = 1;
+}
+
+/* decides the tier from the load of the tick that just ended */
+static void vas_governor_finish(vas_governor *x)
+{
+    if(x->deadline <= 0)
+        return;
+
+    x->load = (float)(x->seconds / x->deadline);
+    if(x->budget <= 0)
+        return;
+
+    if(x->load > x->budget)
+    {
+        x->under = 0;
+        if(++x->over >= VAS_GOVERNOR_DOWNTICKS && x->tier < VAS_GOVERNOR_TIERS - 1)
+            vas_governor_setTier(x, x->tier + 1);
+    }
+    else if(x->load < x->budget * VAS_GOVERNOR_HEADROOM)
+    {
+        x->over = 0;
+        if(++x->under >= VAS_GOVERNOR_UPTICKS && x->tier > 0)
+            vas_governor_setTier(x, x->tier - 1);
+    }
+    else
+    {
+        x->over = 0;
+        x->under = 0;
+    }
+}
+
+void vas_governor_setBudget(vas_governor *x, float budget)
+{
+    x->budget = budget > 0 ? budget : 0;
+    if(!x->budget)
+        vas_governor_setTier(x, 0);
+    x->over = 0;
+    x->under = 0;
+}
+
+void vas_governor_enter(vas_governor *x, double tick)
+{
+    if(tick != x->tick)
+    {
+        vas_governor_finish(x);
+        x->tick = tick;
+        x->seconds = 0;
+        x->deadline = 0;
+    }
+    if(x->voicesDirty)
+        vas_governor_assignVoices(x);
+}
+
+void vas_governor_account(vas_governor *x, double seconds, double deadline)
+{
+    x->seconds += seconds;
+    if(deadline > x->deadline)
+        x->deadline = deadline;
+}
+
+static void vas_governor_unlink(vas_governor *x, vas_governor_voice *voice)
+{
+    if(voice->newer)
+        voice->newer->older = voice->older;
+    else
+        x->newest = voice->older;
+    if(voice->older)
+        voice->older->newer = voice->newer;
+    else
+        x->oldest = voice->newer;
+    voice->newer = voice->older = NULL;
+}
+
+void vas_governor_addVoice(vas_governor *x, vas_governor_voice *voice)
+{
+    voice->active = 1;
+    voice->newer = x->oldest;
+    voice->older = NULL;
+    if(x->oldest)
+        x->oldest->older = voice;
+    else
+        x->newest = voice;
+    x->oldest = voice;
+    x->voiceCount++;
+    x->voicesDirty = 1;
+}
+
+void vas_governor_removeVoice(vas_governor *x, vas_governor_voice *voice)
+{
+    vas_governor_unlink(x, voice);
+    x->voiceCount--;
+    x->voicesDirty = 1;
+}
+
+void vas_governor_noteOn(vas_governor *x, vas_governor_voice *voice)
+{
+    if(x->newest == voice)
+        return;
+    vas_governor_unlink(x, voice);
+    voice->older = x->newest;
+    x->newest->newer = voice;
+    x->newest = voice;
+    x->voicesDirty = 1;
+}
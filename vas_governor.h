@@ -0,0 +1,153 @@
+/**
+ * @file vas_governor.h
+ * @brief Process-wide CPU budget with graceful quality degradation <br>
+ * <br>
+ * All instances share one governor. Every instance reports the time its
+ * blocks took, the governor sums them per scheduler tick and compares the sum
+ * with a budget, a fraction of the tick's deadline. While the budget is
+ * exceeded the quality is stepped down one tier at a time, when there is
+ * enough headroom again it is stepped back up:
+ * <br>
+ *   tier 0  full quality <br>
+ *   tier 1  the default sine is read from the table instead of computed <br>
+ *   tier 2  the ADSRs run at control rate, every VAS_GOVERNOR_CONTROLPERIOD samples <br>
+ *   tier 3  only the newest 3/4 of the voices are rendered <br>
+ *   tier 4  only the newest 1/2 of the voices are rendered <br>
+ *   tier 5  only the newest 1/4 of the voices are rendered <br>
+ * <br>
+ * A voice is one registered instance, its age is the time of its last
+ * note on. At least one voice is always rendered.
+ * <br>
+ * Not thread safe: all calls must come from the thread that runs the
+ * scheduler, in Pure Data the one that runs both the messages and the DSP.
+ * <br>
+ */
+
+#ifndef vas_governor_h
+#define vas_governor_h
+
+#define VAS_GOVERNOR_TIERS 6
+#define VAS_GOVERNOR_TIER_LOOKUP 1
+#define VAS_GOVERNOR_TIER_CONTROLRATE 2
+#define VAS_GOVERNOR_TIER_VOICES 3
+
+/** Control period of the ADSRs from VAS_GOVERNOR_TIER_CONTROLRATE on */
+#define VAS_GOVERNOR_CONTROLPERIOD 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct vas_governor_voice
+ * @brief Registration of one instance, owned by the instance. <br>
+ */
+typedef struct vas_governor_voice
+{
+    int active;             /**< 0 while the governor drops this voice*/
+    struct vas_governor_voice *newer; /**< voice with the next newer note on, NULL for the newest*/
+    struct vas_governor_voice *older; /**< voice with the next older note on, NULL for the oldest*/
+} vas_governor_voice;
+
+/**
+ * @struct vas_governor
+ * @brief The shared governor. <br>
+ */
+typedef struct vas_governor
+{
+    float budget;           /**< fraction of the deadline all instances together may use, 0 if off*/
+    int tier;               /**< current quality tier, 0 ... VAS_GOVERNOR_TIERS - 1*/
+    unsigned int decisions; /**< incremented on every tier change*/
+    float load;             /**< time of the last finished tick as fraction of its deadline*/
+
+    double tick;            /**< logical time of the tick being summed*/
+    double seconds;         /**< time reported in this tick*/
+    double deadline;        /**< longest deadline reported in this tick*/
+    int over;               /**< consecutive ticks over budget*/
+    int under;              /**< consecutive ticks with headroom*/
+
+    int refCount;           /**< number of vas_governor_acquire without vas_governor_release*/
+    int voiceCount;         /**< registered voices*/
+    int voicesDirty;        /**< 1 if the voice order changed since the voices were last assigned*/
+    vas_governor_voice *newest; /**< voice with the newest note on*/
+    vas_governor_voice *oldest; /**< voice with the oldest note on*/
+} vas_governor;
+
+/**
+ * @related vas_governor
+ * @brief Returns the shared governor, creating it on first use <br>
+ * @return the governor <br>
+ */
+vas_governor *vas_governor_acquire(void);
+
+/**
+ * @related vas_governor
+ * @brief Drops one reference, the governor is freed with the last one <br>
+ * @param x the governor <br>
+ */
+void vas_governor_release(vas_governor *x);
+
+/**
+ * @related vas_governor
+ * @brief Sets the budget <br>
+ * Turning the governor off restores full quality right away. <br>
+ * @param x the governor <br>
+ * @param budget fraction of the deadline, 0 to turn the governor off <br>
+ */
+void vas_governor_setBudget(vas_governor *x, float budget);
+
+/**
+ * @related vas_governor
+ * @brief Starts the accounting of a block <br>
+ * The first call of a new tick finishes the previous tick and decides the
+ * tier, so tier and voice states are up to date for the block that follows. <br>
+ * @param x the governor <br>
+ * @param tick logical time of the scheduler tick <br>
+ */
+void vas_governor_enter(vas_governor *x, double tick);
+
+/**
+ * @related vas_governor
+ * @brief Adds the time of a block to the current tick <br>
+ * @param x the governor <br>
+ * @param seconds time the block took <br>
+ * @param deadline duration of the block in seconds <br>
+ */
+void vas_governor_account(vas_governor *x, double seconds, double deadline);
+
+/**
+ * @related vas_governor
+ * @brief Returns a monotonic time stamp for measuring blocks <br>
+ * @return seconds since an arbitrary start <br>
+ */
+double vas_governor_now(void);
+
+/**
+ * @related vas_governor_voice
+ * @brief Registers a voice as the oldest one <br>
+ * @param x the governor <br>
+ * @param voice the voice, owned by the caller <br>
+ */
+void vas_governor_addVoice(vas_governor *x, vas_governor_voice *voice);
+
+/**
+ * @related vas_governor_voice
+ * @brief Unregisters a voice <br>
+ * @param x the governor <br>
+ * @param voice the voice <br>
+ */
+void vas_governor_removeVoice(vas_governor *x, vas_governor_voice *voice);
+
+/**
+ * @related vas_governor_voice
+ * @brief Makes a voice the newest one, call on every note on <br>
+ * @param x the governor <br>
+ * @param voice the voice <br>
+ */
+void vas_governor_noteOn(vas_governor *x, vas_governor_voice *voice);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* vas_governor_h */
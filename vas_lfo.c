@@ -0,0 +1,141 @@
+/**
+ * @file vas_lfo.c
+ * @brief Control rate LFOs, shareable by name across instances <br>
+ */
+#include "vas_lfo.h"
+#include "vas_mem.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define VAS_LFO_STAGES 5
+
+static vas_lfo *vas_lfo_registry;
+
+vas_lfo *vas_lfo_acquire(const char *name)
+{
+    vas_lfo *x;
+
+    for(x = vas_lfo_registry; x; x = x->next)
+    {
+        if(!strncmp(x->name, name, VAS_LFO_NAMESIZE - 1))
+        {
+            x->refCount++;
+            return x;
+        }
+    }
+
+    x = (vas_lfo *) vas_mem_alloc(sizeof(vas_lfo));
+    strncpy(x->name, name, VAS_LFO_NAMESIZE - 1);
+    x->shape = VAS_LFO_SINE;
+    x->frequency = 1;
+    x->tick = -1;
+    x->refCount = 1;
+    x->next = vas_lfo_registry;
+    vas_lfo_registry = x;
+    return x;
+}
+
+void vas_lfo_release(vas_lfo *x)
+{
+    if(!x || --x->refCount > 0)
+        return;
+
+    for(vas_lfo **link = &vas_lfo_registry; *link; link = &(*link)->next)
+    {
+        if(*link == x)
+        {
+            *link = x->next;
+            break;
+        }
+    }
+    vas_mem_free(x);
+}
+
+float vas_lfo_evaluate(vas_lfo *x, double phase)
+{
+    switch(x->shape)
+    {
+        case VAS_LFO_SINE:
+            return (float)(0.5 - 0.5 * cos(2 * M_PI * phase));
+        case VAS_LFO_TRIANGLE:
+            return (float)(phase < 0.5 ? 2 * phase : 2 - 2 * phase);
+        case VAS_LFO_RAMP:
+            return (float)phase;
+        case VAS_LFO_ADSR:
+        {
+            double position = phase * VAS_LFO_TABLESIZE;
+            int index = (int)position;
+            if(index >= VAS_LFO_TABLESIZE)
+                index = VAS_LFO_TABLESIZE - 1;
+            float fraction = (float)(position - index);
+            return x->table[index] + fraction * (x->table[index + 1] - x->table[index]);
+        }
+        default:
+            return 0;
+    }
+}
+
+void vas_lfo_setShape(vas_lfo *x, int shape)
+{
+    if(shape < VAS_LFO_SINE || shape > VAS_LFO_ADSR)
+        return;
+    x->shape = shape;
+    x->target = vas_lfo_evaluate(x, x->phase);
+}
+
+void vas_lfo_setFrequency(vas_lfo *x, float frequency)
+{
+    x->frequency = frequency;
+}
+
+void vas_lfo_setADSR(vas_lfo *x, vas_adsr *adsr, float sampleRate)
+{
+    vas_adsr stage = *adsr;
+    float step[VAS_LFO_STAGES];
+    double end[VAS_LFO_STAGES];
+    double length = 0;
+
+    /* the loop runs attack, decay, sustain, release and silent, then starts over */
+    stage.currentMode = MODE_LFO;
+    stage.resultvolume = stage.sus_v;
+    for(int s = 0; s < VAS_LFO_STAGES; s++)
+    {
+        stage.currentStage = s;
+        step[s] = vas_adsr_get_stepSize(&stage);
+        length += stage.tableSize / step[s];
+        end[s] = length;
+    }
+
+    for(int i = 0, s = 0; i < VAS_LFO_TABLESIZE; i++)
+    {
+        double time = length * i / VAS_LFO_TABLESIZE;
+
+        while(s < VAS_LFO_STAGES - 1 && time >= end[s])
+            s++;
+        stage.currentStage = s;
+        stage.currentIndex = (float)((time - (s ? end[s - 1] : 0)) * step[s]);
+        if(stage.currentIndex > stage.tableSize - 1)
+            stage.currentIndex = stage.tableSize - 1;
+        x->table[i] = vas_adsr_get_current_value(&stage);
+    }
+    x->table[VAS_LFO_TABLESIZE] = x->table[0];
+
+    x->frequency = (float)(sampleRate / length);
+    vas_lfo_setShape(x, VAS_LFO_ADSR);
+}
+
+void vas_lfo_advance(vas_lfo *x, double tick, double seconds)
+{
+    if(tick == x->tick)
+        return;
+    x->tick = tick;
+
+    x->phase += x->frequency * seconds;
+    x->phase -= floor(x->phase);
+    x->value = x->target;
+    x->target = vas_lfo_evaluate(x, x->phase);
+}
@@ -0,0 +1,124 @@
+/**
+ * @file vas_lfo.h
+ * @brief Control rate LFOs, shareable by name across instances <br>
+ * <br>
+ * A vas_lfo is evaluated once per block and interpolated linearly in
+ * between, unlike a vas_adsr in LOOP(LFO) mode, which runs its stages on
+ * every sample. The output runs from 0 to 1, so an LFO can replace the
+ * envelope of an ADSR slot. Shapes are sine, triangle, ramp and the loop of
+ * an ADSR, captured once into a table by vas_lfo_setADSR.
+ * <br>
+ * LFOs are acquired by name. All users of a name share one LFO, which
+ * vas_lfo_advance moves on only once per scheduler tick, so it is computed
+ * once per block for the whole patch.
+ * <br>
+ * Not thread safe: all calls must come from the thread that runs the
+ * scheduler, see vas_governor.
+ * <br>
+ */
+
+#ifndef vas_lfo_h
+#define vas_lfo_h
+
+#include "vas_adsr.h"
+
+#define VAS_LFO_SINE 0
+#define VAS_LFO_TRIANGLE 1
+#define VAS_LFO_RAMP 2
+#define VAS_LFO_ADSR 3
+
+/** Samples per cycle of the ADSR shape */
+#define VAS_LFO_TABLESIZE 256
+#define VAS_LFO_NAMESIZE 64
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct vas_lfo
+ * @brief A shared LFO. <br>
+ */
+typedef struct vas_lfo
+{
+    int shape;              /**< VAS_LFO_SINE, _TRIANGLE, _RAMP or _ADSR*/
+    float frequency;        /**< cycles per second*/
+    double phase;           /**< position in the cycle at the end of the current block, 0 ... 1*/
+    float value;            /**< output at the start of the current block*/
+    float target;           /**< output at the end of the current block*/
+    double tick;            /**< logical time of the current block*/
+    float table[VAS_LFO_TABLESIZE + 1]; /**< one cycle of the ADSR shape, the last sample repeating the first*/
+
+    char name[VAS_LFO_NAMESIZE]; /**< name the LFO was acquired with*/
+    int refCount;           /**< number of vas_lfo_acquire without vas_lfo_release*/
+    struct vas_lfo *next;   /**< next LFO in the registry*/
+} vas_lfo;
+
+/**
+ * @related vas_lfo
+ * @brief Returns the LFO of a name, creating it on first use <br>
+ * A new LFO is a 1 Hz sine. <br>
+ * @param name the name, truncated to VAS_LFO_NAMESIZE - 1 characters <br>
+ * @return the LFO <br>
+ */
+vas_lfo *vas_lfo_acquire(const char *name);
+
+/**
+ * @related vas_lfo
+ * @brief Drops one reference, the LFO is freed with the last one <br>
+ * @param x the LFO, may be NULL <br>
+ */
+void vas_lfo_release(vas_lfo *x);
+
+/**
+ * @related vas_lfo
+ * @brief Sets the shape <br>
+ * VAS_LFO_ADSR plays the table of the last vas_lfo_setADSR, silence before. <br>
+ * @param x the LFO <br>
+ * @param shape VAS_LFO_SINE, _TRIANGLE, _RAMP or _ADSR <br>
+ */
+void vas_lfo_setShape(vas_lfo *x, int shape);
+
+/**
+ * @related vas_lfo
+ * @brief Sets the frequency <br>
+ * @param x the LFO <br>
+ * @param frequency cycles per second, negative values run the cycle backwards <br>
+ */
+void vas_lfo_setFrequency(vas_lfo *x, float frequency);
+
+/**
+ * @related vas_lfo
+ * @brief Captures one loop of an ADSR in LOOP(LFO) mode and plays it <br>
+ * The stages are evaluated where the ADSR would be at every table position,
+ * with the sustain of full velocity. Shape and frequency are set so the LFO
+ * repeats the loop at the speed of the ADSR. <br>
+ * @param x the LFO <br>
+ * @param adsr the ADSR, not changed <br>
+ * @param sampleRate samples per second the ADSR runs at <br>
+ */
+void vas_lfo_setADSR(vas_lfo *x, vas_adsr *adsr, float sampleRate);
+
+/**
+ * @related vas_lfo
+ * @brief Moves the LFO on by one block, once per tick <br>
+ * Further calls with the same tick, e.g. from other instances, do nothing. <br>
+ * @param x the LFO <br>
+ * @param tick logical time of the scheduler tick <br>
+ * @param seconds duration of the block <br>
+ */
+void vas_lfo_advance(vas_lfo *x, double tick, double seconds);
+
+/**
+ * @related vas_lfo
+ * @brief Returns the output at a position in the cycle <br>
+ * @param x the LFO <br>
+ * @param phase 0 ... 1 <br>
+ */
+float vas_lfo_evaluate(vas_lfo *x, double phase);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* vas_lfo_h */
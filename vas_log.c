@@ -0,0 +1,76 @@
+/**
+ * @file vas_log.c
+ * @brief Lock-free error reporting from the audio path <br>
+ */
+#include "vas_log.h"
+#include <stdio.h>
+#include <stdatomic.h>
+
+typedef struct vas_log_slot
+{
+    const char *format;
+    long value;
+    atomic_int ready;       /* set by the writer once format and value are stored */
+} vas_log_slot;
+
+static vas_log_slot vas_log_slots[VAS_LOG_SIZE];
+static atomic_uint vas_log_head;    /* next slot to claim, shared by all writers */
+static atomic_uint vas_log_tail;    /* next slot to drain */
+static atomic_uint vas_log_dropped;
+
+void vas_log_write(const char *format, long value)
+{
+    unsigned int head = atomic_load(&vas_log_head);
+    vas_log_slot *slot;
+
+    do
+    {
+        if(head - atomic_load(&vas_log_tail) >= VAS_LOG_SIZE)
+        {
+            atomic_fetch_add(&vas_log_dropped, 1);
+            return;
+        }
+    }
+    while(!atomic_compare_exchange_weak(&vas_log_head, &head, head + 1));
+
+    slot = &vas_log_slots[head & (VAS_LOG_SIZE - 1)];
+    slot->format = format;
+    slot->value = value;
+    atomic_store_explicit(&slot->ready, 1, memory_order_release);
+}
+
+int vas_log_pending(void)
+{
+    return atomic_load(&vas_log_head) != atomic_load(&vas_log_tail) || atomic_load(&vas_log_dropped);
+}
+
+int vas_log_drain(void (*print)(const char *line))
+{
+    char line[VAS_LOG_LINESIZE];
+    unsigned int tail = atomic_load(&vas_log_tail);
+    unsigned int dropped;
+    int count = 0;
+
+    while(1)
+    {
+        vas_log_slot *slot = &vas_log_slots[tail & (VAS_LOG_SIZE - 1)];
+
+        /* a claimed slot that is not written yet ends this drain, the next one picks it up */
+        if(!atomic_load_explicit(&slot->ready, memory_order_acquire))
+            break;
+        snprintf(line, sizeof(line), slot->format, slot->value);
+        atomic_store(&slot->ready, 0);
+        atomic_store(&vas_log_tail, ++tail);
+        print(line);
+        count++;
+    }
+
+    dropped = atomic_exchange(&vas_log_dropped, 0);
+    if(dropped)
+    {
+        snprintf(line, sizeof(line), "%u messages dropped, the log was full", dropped);
+        print(line);
+        count++;
+    }
+    return count;
+}
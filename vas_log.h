@@ -0,0 +1,50 @@
+/**
+ * @file vas_log.h
+ * @brief Lock-free error reporting from the audio path <br>
+ * <br>
+ * DSP code must not print: stdio takes locks and may allocate. vas_log_write
+ * only stores the pointer to a format string and one value in a fixed ring
+ * of VAS_LOG_SIZE slots, from any thread and without locks. The host drains
+ * the ring outside the audio path, e.g. rtap_fmMultiOsc~ from a Pd clock,
+ * and formats the messages there. Messages that find the ring full are
+ * counted and reported as dropped.
+ * <br>
+ */
+
+#ifndef vas_log_h
+#define vas_log_h
+
+/** Slots in the ring, a power of two */
+#define VAS_LOG_SIZE 64
+/** Longest line vas_log_drain passes on, including the terminating zero */
+#define VAS_LOG_LINESIZE 256
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Queues a message, real-time safe and callable from any thread <br>
+ * @param format a string literal with at most one %ld, only the pointer is stored <br>
+ * @param value the value printed for %ld <br>
+ */
+void vas_log_write(const char *format, long value);
+
+/**
+ * @brief Returns 1 if messages are waiting to be drained <br>
+ */
+int vas_log_pending(void);
+
+/**
+ * @brief Formats and hands on all queued messages <br>
+ * Not real-time safe. Only one thread may drain at a time. <br>
+ * @param print called with each line, without newline <br>
+ * @return number of lines <br>
+ */
+int vas_log_drain(void (*print)(const char *line));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* vas_log_h */
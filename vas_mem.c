@@ -4,7 +4,45 @@
 
 #include "vas_mem.h"
 
-void *vas_mem_alloc(long size)
+#include <stdio.h>
+
+#ifdef VAS_MEM_TRACK
+#include <stdatomic.h>
+
+/** Bytes in front of every block, keeps the payload aligned like malloc does */
+#define VAS_MEM_HEADER 16
+
+typedef struct vas_mem_counter
+{
+    atomic_long bytes;
+    atomic_long peak;
+    atomic_long blocks;
+    atomic_long allocations;
+} vas_mem_counter;
+
+/* one per category and one for all of them */
+static vas_mem_counter vas_mem_counters[VAS_MEM_CATEGORIES + 1];
+
+static void vas_mem_countIn(vas_mem_counter *counter, long bytes, int blocks)
+{
+    long now = atomic_fetch_add(&counter->bytes, bytes) + bytes;
+    long peak = atomic_load(&counter->peak);
+
+    while(now > peak && !atomic_compare_exchange_weak(&counter->peak, &peak, now))
+        ;
+    atomic_fetch_add(&counter->blocks, blocks);
+    if(blocks > 0)
+        atomic_fetch_add(&counter->allocations, blocks);
+}
+
+static void vas_mem_count(int category, long bytes, int blocks)
+{
+    vas_mem_countIn(&vas_mem_counters[category], bytes, blocks);
+    vas_mem_countIn(&vas_mem_counters[VAS_MEM_ALL], bytes, blocks);
+}
+#endif
+
+static void *vas_mem_sysAlloc(long size)
 {
     
 #ifdef MAXMSPSDK
@@ -13,17 +51,17 @@ void *vas_mem_alloc(long size)
 
 #elif defined(PUREDATA)
     
-    return malloc(size);
+    return calloc(1, size);
     
 #else
     
-    return malloc(size);
+    return calloc(1, size);
     
 #endif
     
 }
 
-void *vas_mem_resize(void *ptr, long size)
+static void *vas_mem_sysResize(void *ptr, long size)
 {
     
 #ifdef MAXMSPSDK
@@ -47,23 +85,203 @@ void *vas_mem_resize(void *ptr, long size)
     
 }
 
-void vas_mem_free(void *ptr)
+static void vas_mem_sysFree(void *ptr)
 {
     
 #ifdef MAXMSPSDK
-    if(ptr)
-        sysmem_freeptr(ptr);
+    sysmem_freeptr(ptr);
     
 #elif defined(PUREDATA)
-    if(ptr)
-        free(ptr);
+    free(ptr);
     
 #else
-    if(ptr)
-        free(ptr);
+    free(ptr);
     
 #endif
     
 }
 
+void *vas_mem_allocAs(long size, int category)
+{
+#ifdef VAS_MEM_TRACK
+    long *header = (long *) vas_mem_sysAlloc(size + VAS_MEM_HEADER);
+
+    if(!header)
+        return NULL;
+    header[0] = size;
+    header[1] = category;
+    vas_mem_count(category, size, 1);
+    return (char *)header + VAS_MEM_HEADER;
+#else
+    (void)category;
+    return vas_mem_sysAlloc(size);
+#endif
+}
+
+void *vas_mem_alloc(long size)
+{
+    return vas_mem_allocAs(size, VAS_MEM_INSTANCE);
+}
+
+void *vas_mem_resize(void *ptr, long size)
+{
+#ifdef VAS_MEM_TRACK
+    long *header;
+    long oldSize;
+    int category;
+
+    if(!ptr)
+        return vas_mem_alloc(size);
+
+    header = (long *)((char *)ptr - VAS_MEM_HEADER);
+    oldSize = header[0];
+    category = (int)header[1];
+    header = (long *) vas_mem_sysResize(header, size + VAS_MEM_HEADER);
+    header[0] = size;
+    header[1] = category;
+    vas_mem_count(category, size - oldSize, 0);
+    return (char *)header + VAS_MEM_HEADER;
+#else
+    return vas_mem_sysResize(ptr, size);
+#endif
+}
+
+void vas_mem_free(void *ptr)
+{
+    if(!ptr)
+        return;
+
+#ifdef VAS_MEM_TRACK
+    long *header = (long *)((char *)ptr - VAS_MEM_HEADER);
+    vas_mem_count((int)header[1], -header[0], -1);
+    vas_mem_sysFree(header);
+#else
+    vas_mem_sysFree(ptr);
+#endif
+}
+
+int vas_mem_tracking(void)
+{
+#ifdef VAS_MEM_TRACK
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void vas_mem_getStats(int category, vas_mem_stats *stats)
+{
+#ifdef VAS_MEM_TRACK
+    vas_mem_counter *counter = &vas_mem_counters[category];
+
+    stats->bytes = atomic_load(&counter->bytes);
+    stats->peak = atomic_load(&counter->peak);
+    stats->blocks = atomic_load(&counter->blocks);
+    stats->allocations = atomic_load(&counter->allocations);
+#else
+    (void)category;
+    memset(stats, 0, sizeof(vas_mem_stats));
+#endif
+}
+
+const char *vas_mem_categoryName(int category)
+{
+    static const char *names[VAS_MEM_CATEGORIES + 1] = {"scratch", "instance", "osctable", "envtable", "all"};
+
+    return category >= 0 && category <= VAS_MEM_ALL ? names[category] : "?";
+}
+
+void vas_mem_report(void (*print)(const char *line))
+{
+    char line[128];
+
+    if(!vas_mem_tracking())
+    {
+        print("memory is not tracked, build with make MEMTRACK=1");
+        return;
+    }
+
+    snprintf(line, sizeof(line), "%-10s %14s %14s %10s %12s", "memory", "bytes", "peak", "blocks", "allocations");
+    print(line);
+    for(int category = 0; category <= VAS_MEM_ALL; category++)
+    {
+        vas_mem_stats stats;
+
+        vas_mem_getStats(category, &stats);
+        snprintf(line, sizeof(line), "%-10s %14ld %14ld %10ld %12ld",
+                 vas_mem_categoryName(category), stats.bytes, stats.peak, stats.blocks, stats.allocations);
+        print(line);
+    }
+}
+
+vas_mem_arena *vas_mem_arena_new(long size)
+{
+    long headerSize = VAS_MEM_ALIGN(sizeof(vas_mem_arena));
+    long payloadSize = VAS_MEM_ALIGN(size);
+    char *block = (char *) vas_mem_alloc(headerSize + payloadSize + VAS_MEM_CACHELINE - 1);
+    char *start;
+    vas_mem_arena *x;
+
+    if(!block)
+        return NULL;
+
+    /* the block is already zeroed, pages that are never written are never committed */
+    start = (char *)(((size_t)block + VAS_MEM_CACHELINE - 1) & ~((size_t)VAS_MEM_CACHELINE - 1));
+
+    x = (vas_mem_arena *)start;
+    x->block = block;
+    x->data = start + headerSize;
+    x->size = payloadSize;
+    x->used = 0;
+    return x;
+}
+
+void *vas_mem_arena_allocAs(vas_mem_arena *x, long size, int category)
+{
+    void *ptr;
+    size = VAS_MEM_ALIGN(size);
+
+    if(x->used + size > x->size)
+        return NULL;
+
+    ptr = x->data + x->used;
+    x->used += size;
+
+#ifdef VAS_MEM_TRACK
+    if(category != VAS_MEM_INSTANCE)
+    {
+        vas_mem_countIn(&vas_mem_counters[VAS_MEM_INSTANCE], -size, 0);
+        vas_mem_countIn(&vas_mem_counters[category], size, 1);
+        x->moved[category] += size;
+        x->chunks[category]++;
+    }
+#else
+    (void)category;
+#endif
+    return ptr;
+}
+
+void *vas_mem_arena_alloc(vas_mem_arena *x, long size)
+{
+    return vas_mem_arena_allocAs(x, size, VAS_MEM_INSTANCE);
+}
+
+void vas_mem_arena_free(vas_mem_arena *x)
+{
+    if(!x)
+        return;
+
+#ifdef VAS_MEM_TRACK
+    /* hand the chunks back to the instance, which the whole block is freed as */
+    for(int category = 0; category < VAS_MEM_CATEGORIES; category++)
+    {
+        if(!x->chunks[category])
+            continue;
+        vas_mem_countIn(&vas_mem_counters[category], -x->moved[category], -x->chunks[category]);
+        vas_mem_countIn(&vas_mem_counters[VAS_MEM_INSTANCE], x->moved[category], 0);
+    }
+#endif
+    vas_mem_free(x->block);
+}
+
 #endif
@@ -11,6 +11,15 @@
  * Max/MSP SDK suggests using the Max/MSP "sysmem_" - routines
  * instead of malloc/calloc/free
  * So for Max/MSP define the Preprocessor macro "MAXMSPSDK"
+ * <br>
+ * The arena functions carve several objects out of one cache-line aligned
+ * block, so that an instance can be created with a single allocation and
+ * destroyed with a single free.
+ * <br>
+ * Built with VAS_MEM_TRACK (make MEMTRACK=1), every block carries its size
+ * and category in a small header, and bytes, blocks and peak usage are
+ * counted per category, see vas_mem_getStats and vas_mem_report. Chunks taken
+ * from an arena are moved from VAS_MEM_INSTANCE to their own category.
  */
 
 #ifndef vas_memory_h
@@ -27,16 +36,130 @@
 #include "ext_obex.h"
 #endif
 
+#define VAS_MEM_CACHELINE 64
+
+/* categories memory is accounted in */
+#define VAS_MEM_SCRATCH 0   /**< temporary buffers, e.g. of imports and file I/O*/
+#define VAS_MEM_INSTANCE 1  /**< objects and their state*/
+#define VAS_MEM_OSCTABLE 2  /**< oscillator waveforms*/
+#define VAS_MEM_ENVTABLE 3  /**< ADSR curves*/
+#define VAS_MEM_CATEGORIES 4
+/** All categories together, for vas_mem_getStats */
+#define VAS_MEM_ALL VAS_MEM_CATEGORIES
+
+/** Rounds size up to the next multiple of VAS_MEM_CACHELINE */
+#define VAS_MEM_ALIGN(size) ((((long)(size)) + VAS_MEM_CACHELINE - 1) & ~((long)VAS_MEM_CACHELINE - 1))
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/**
+ * @struct vas_mem_arena
+ * @brief A bump allocator living at the start of its own aligned block. <br>
+ */
+typedef struct vas_mem_arena
+{
+    void *block;    /**< the pointer returned by vas_mem_alloc, needed for freeing*/
+    char *data;     /**< first cache-line aligned byte after the arena header*/
+    long size;      /**< usable bytes behind data*/
+    long used;      /**< bytes already handed out*/
+    long moved[VAS_MEM_CATEGORIES]; /**< bytes handed out per category, counted with VAS_MEM_TRACK only*/
+    int chunks[VAS_MEM_CATEGORIES]; /**< chunks handed out per category, counted with VAS_MEM_TRACK only*/
+} vas_mem_arena;
+
+/**
+ * @struct vas_mem_stats
+ * @brief Usage of one category, see vas_mem_getStats. <br>
+ */
+typedef struct vas_mem_stats
+{
+    long bytes;         /**< bytes allocated now*/
+    long peak;          /**< most bytes allocated at any time*/
+    long blocks;        /**< blocks allocated now, arena chunks count in their category but not in VAS_MEM_ALL*/
+    long allocations;   /**< blocks allocated so far*/
+} vas_mem_stats;
+
+/** Returns zeroed memory, like sysmem_newptrclear, accounted as VAS_MEM_INSTANCE */
 void *vas_mem_alloc(long size);
 
+/**
+ * @brief Returns zeroed memory accounted in a category <br>
+ * @param size number of bytes <br>
+ * @param category VAS_MEM_SCRATCH, _INSTANCE, _OSCTABLE or _ENVTABLE <br>
+ * @return the memory or NULL <br>
+ */
+void *vas_mem_allocAs(long size, int category);
+
+/** Resizes and clears memory, which stays in its category */
 void *vas_mem_resize(void *ptr, long size);
 
 void vas_mem_free(void *ptr);
 
+/**
+ * @brief Returns 1 if the library was built with VAS_MEM_TRACK <br>
+ */
+int vas_mem_tracking(void);
+
+/**
+ * @brief Reads the usage of a category, all zero without VAS_MEM_TRACK <br>
+ * Safe to call from any thread, the numbers may be a moment apart. <br>
+ * @param category VAS_MEM_SCRATCH ... VAS_MEM_ENVTABLE or VAS_MEM_ALL <br>
+ * @param stats receives the usage <br>
+ */
+void vas_mem_getStats(int category, vas_mem_stats *stats);
+
+/**
+ * @brief Returns a short name of a category without spaces, e.g. "osctable" <br>
+ * @param category VAS_MEM_SCRATCH ... VAS_MEM_ENVTABLE or VAS_MEM_ALL <br>
+ */
+const char *vas_mem_categoryName(int category);
+
+/**
+ * @brief Writes a table of the usage of all categories <br>
+ * @param print called with each line, without newline <br>
+ */
+void vas_mem_report(void (*print)(const char *line));
+
+/**
+ * @related vas_mem_arena
+ * @brief Creates a new zeroed arena with room for size bytes <br>
+ * Header and payload share one allocation. Every chunk handed out
+ * by vas_mem_arena_alloc starts on a cache line. Callers should
+ * reserve VAS_MEM_ALIGN(n) for every chunk of n bytes they plan to take. <br>
+ * @param size number of payload bytes <br>
+ * @return the arena or NULL if the allocation failed <br>
+ */
+vas_mem_arena *vas_mem_arena_new(long size);
+
+/**
+ * @related vas_mem_arena
+ * @brief Takes the next cache-line aligned chunk from the arena <br>
+ * @param x the arena <br>
+ * @param size number of bytes <br>
+ * @return a pointer into the arena or NULL if it is exhausted <br>
+ */
+void *vas_mem_arena_alloc(vas_mem_arena *x, long size);
+
+/**
+ * @related vas_mem_arena
+ * @brief Takes the next chunk from the arena and accounts it in a category <br>
+ * The arena itself is accounted as VAS_MEM_INSTANCE, the chunk is moved from
+ * there to the category until the arena is freed. <br>
+ * @param x the arena <br>
+ * @param size number of bytes <br>
+ * @param category VAS_MEM_SCRATCH, _INSTANCE, _OSCTABLE or _ENVTABLE <br>
+ * @return a pointer into the arena or NULL if it is exhausted <br>
+ */
+void *vas_mem_arena_allocAs(vas_mem_arena *x, long size, int category);
+
+/**
+ * @related vas_mem_arena
+ * @brief Frees the arena and everything that was taken from it <br>
+ * @param x the arena <br>
+ */
+void vas_mem_arena_free(vas_mem_arena *x);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,72 +1,708 @@
 #include "vas_osc.h"
+#include "vas_trace.h"
+#include "vas_log.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VAS_OSC_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VAS_OSC_ARM
+#include <arm_neon.h>
+#endif
 
 vas_osc *vas_osc_new(int tableSize, float master_frequency)
 {
     vas_osc *x = (vas_osc *)malloc(sizeof(vas_osc));
+    vas_osc_init(x, (float *) vas_mem_allocAs(tableSize * sizeof(float), VAS_MEM_OSCTABLE), tableSize, master_frequency);
+    return x;
+}
 
+void vas_osc_init(vas_osc *x, float *lookupTable, int tableSize, float master_frequency)
+{
     x->tableSize = tableSize;
-    x->lookupTable = (float *) vas_mem_alloc(x-> tableSize * sizeof(float));
+    x->tableStorage = lookupTable;
     x->currentIndex = 0;
+    x->isSine = 1;
+    x->defaultSine = 1;
+    x->tableScale = 1;
+    x->sampleStride = 1;
+    x->levelCount = 0;
+    x->levels = NULL;
+    x->morphPairs = 0;
 
     x->frequency = master_frequency;
     x->amp = 1;
     x->frequency_factor = 1;
 
-    float stepSize = (M_PI*2) / (float)tableSize;
-    float currentX = 0;
-    
-    for(int i = 0; i < x->tableSize; i++)
+    /* the default size is generated at build time, see vas_tables_gen.c */
+    if(tableSize == VAS_TABLES_SIZE)
     {
-        x->lookupTable[i] = sinf(currentX);
-        currentX += stepSize;
+        x->lookupTable = (float *)vas_tables_sine;
+        return;
     }
- 
-    return x;
+
+    x->lookupTable = lookupTable;
+    for(int i = 0; i < x->tableSize; i++)
+        x->lookupTable[i] = (float)sin(M_PI * 2 * i / tableSize);
+}
+
+float *vas_osc_customTable(vas_osc *x)
+{
+    x->lookupTable = x->tableStorage;
+    x->tableScale = 1;
+    x->sampleStride = 1;
+    x->isSine = 0;
+    x->defaultSine = 0;
+    x->levelCount = 0;
+    x->levels = NULL;
+    x->morphPairs = 0;
+    return x->lookupTable;
+}
+
+void vas_osc_externalTable(vas_osc *x, const float *levels, int levelSize, int levelCount, long levelStride)
+{
+    x->levels = levels;
+    x->levelSize = levelSize;
+    x->levelCount = levelCount;
+    x->levelStride = levelStride;
+    x->lookupTable = (float *)levels;
+    x->tableScale = (float)levelSize / x->tableSize;
+    x->sampleStride = 1;
+    x->isSine = 0;
+    x->defaultSine = 0;
+    x->morphPairs = 0;
+}
+
+void vas_osc_referenceTable(vas_osc *x, const float *samples, int length, int sampleStride)
+{
+    x->lookupTable = (float *)samples;
+    /* without a guard sample the index must stay below length even after rounding */
+    x->tableScale = (length - 0.5F) / x->tableSize;
+    x->sampleStride = sampleStride;
+    x->isSine = 0;
+    x->defaultSine = 0;
+    x->levelCount = 0;
+    x->levels = NULL;
+    x->morphPairs = 0;
+}
+
+void vas_osc_morphTable(vas_osc *x, const float *pairs, int levelSize, int levelCount, int pairCount, long pairStride, long levelStride)
+{
+    x->pairs = pairs;
+    x->levelSize = levelSize;
+    x->levelCount = levelCount;
+    x->morphPairs = pairCount;
+    x->pairStride = pairStride;
+    x->pairLevelStride = levelStride;
+    x->levels = NULL;
+    x->lookupTable = (float *)pairs;
+    x->tableScale = (float)levelSize / x->tableSize;
+    x->sampleStride = 1;
+    x->isSine = 0;
+    x->defaultSine = 0;
+    x->position = 0;
+    x->morphFraction = 0;
+}
+
+void vas_osc_setPosition(vas_osc *x, float position)
+{
+    float last = x->morphPairs;
+    x->position = position < 0 ? 0 : (position > last ? last : position);
+}
+
+void vas_osc_setSineLookup(vas_osc *x, int lookup)
+{
+    if(x->defaultSine)
+        x->isSine = !lookup;
 }
 
 void vas_osc_free(vas_osc *x)
 {
-    vas_mem_free(x->lookupTable);
+    vas_mem_free(x->tableStorage);
     free(x);
 }
 
-void vas_osc_process(vas_osc *x, float *in, float *out, int vectorSize, int mode)
+/* advances the phase and writes the raw table values of one chunk */
+static inline void vas_osc_lookup(vas_osc *x, float *in, float *dest, int n, const int mode)
+{
+    float *table = x->lookupTable;
+    float index = x->currentIndex;
+    float tableSize = x->tableSize;
+    float scale = x->tableScale;
+    int stride = x->sampleStride;
+
+    for(int i = 0; i < n; i++)
+    {
+        /* external tables repeat their first sample, rounding up to the end is safe */
+        dest[i] = table[(int)(index * scale) * stride];
+
+        if(mode == MODE_MOD_WITH_INPUT)
+            index += (1 + in[i]) * x->frequency;
+        else
+            index += x->frequency;
+
+        if(index >= tableSize)
+            index -= tableSize;
+        else if(index < 0)
+            index += tableSize;
+    }
+    x->currentIndex = index;
+}
+
+/* like vas_osc_lookup, but crossfades the two interleaved frames of the current pair */
+static inline void vas_osc_lookupMorph(vas_osc *x, float *in, float *dest, int n, const int mode)
+{
+    const float *pair = x->lookupTable;
+    float index = x->currentIndex;
+    float tableSize = x->tableSize;
+    float scale = x->tableScale;
+    float fraction = x->morphFraction;
+
+    for(int i = 0; i < n; i++)
+    {
+        const float *frames = pair + 2 * (int)(index * scale);
+        dest[i] = frames[0] + fraction * (frames[1] - frames[0]);
+
+        if(mode == MODE_MOD_WITH_INPUT)
+            index += (1 + in[i]) * x->frequency;
+        else
+            index += x->frequency;
+
+        if(index >= tableSize)
+            index -= tableSize;
+        else if(index < 0)
+            index += tableSize;
+    }
+    x->currentIndex = index;
+}
+
+/* advances the phase like vas_osc_lookup and computes the sine without the table */
+static inline void vas_osc_sine(vas_osc *x, float *in, float *dest, int n, const int mode)
+{
+    float index = x->currentIndex;
+    float tableSize = x->tableSize;
+    float toPhase = 1.0F / tableSize;
+
+    for(int i = 0; i < n; i++)
+    {
+        dest[i] = index * toPhase;
+
+        if(mode == MODE_MOD_WITH_INPUT)
+            index += (1 + in[i]) * x->frequency;
+        else
+            index += x->frequency;
+
+        if(index >= tableSize)
+            index -= tableSize;
+        else if(index < 0)
+            index += tableSize;
+    }
+    x->currentIndex = index;
+
+    vas_util_fsine(dest, dest, n);
+}
+
+/*
+ * sine of an unmodulated carrier by rotating four phasors, each one sample
+ * apart, by four samples at a time. The phasors and the rotation are set up
+ * with vas_util_fsine from the exact phase in every chunk, so the recurrence
+ * cannot drift.
+ */
+static void vas_osc_rotate(vas_osc *x, float *dest, int n)
+{
+    float tableSize = x->tableSize;
+    float step = x->frequency / tableSize;
+    float phase = x->currentIndex / tableSize;
+    float seed[10], value[10];
+    float *re = value + 4, *im = value;
+    int i = 0;
+
+    /* sines of the four phasors and the rotation, then their cosines */
+    for(int k = 0; k < 4; k++)
+    {
+        seed[k] = phase + k * step;
+        seed[k + 4] = seed[k] + 0.25F;
+    }
+    seed[8] = 4 * step;
+    seed[9] = seed[8] + 0.25F;
+    vas_util_fsine(seed, value, 10);
+
+    for(; i + 4 <= n; i += 4)
+    {
+        for(int k = 0; k < 4; k++)
+        {
+            float r = re[k];
+            dest[i + k] = im[k];
+            re[k] = r * value[9] - im[k] * value[8];
+            im[k] = im[k] * value[9] + r * value[8];
+        }
+    }
+    for(int k = 0; i < n; i++, k++)
+        dest[i] = im[k];
+
+    x->currentIndex = fmodf(x->currentIndex + n * x->frequency, tableSize);
+    if(x->currentIndex < 0)
+        x->currentIndex += tableSize;
+}
+
+/* the first level of an external table without harmonics above Nyquist, or the last one */
+static int vas_osc_level(vas_osc *x)
+{
+    float highest = x->tableSize / (2 * fabsf(x->frequency) + 1e-9F);
+    int level = 0;
+
+    while(level < x->levelCount - 1 && (x->levelSize / 2 >> level) > highest)
+        level++;
+    return level;
+}
+
+/* points lookupTable at the pair of frames around the position, in the level for the frequency */
+static void vas_osc_selectPair(vas_osc *x)
+{
+    int pair = (int)x->position;
+
+    if(pair > x->morphPairs - 1)
+        pair = x->morphPairs - 1;
+    x->morphFraction = x->position - pair;
+    x->lookupTable = (float *)(x->pairs + vas_osc_level(x) * x->pairLevelStride + pair * x->pairStride);
+}
+
+/* picks the level or morph pair for the current frequency and position, once per block */
+static void vas_osc_prepare(vas_osc *x)
+{
+    if(x->morphPairs)
+        vas_osc_selectPair(x);
+    else if(x->levelCount > 1)
+        x->lookupTable = (float *)(x->levels + vas_osc_level(x) * x->levelStride);
+}
+
+/* the raw waveform of one chunk, before amp and input are applied */
+static inline void vas_osc_wave(vas_osc *x, float *in, float *table, int n, const int mode)
 {
-    int i = vectorSize;
-    float currentValue;
-    
-    while(i--)
+    if(x->morphPairs)
+        vas_osc_lookupMorph(x, in, table, n, mode);
+    else if(!x->isSine)
+        vas_osc_lookup(x, in, table, n, mode);
+    else if(mode == MODE_CARRIER_NO_INPUT)
+        vas_osc_rotate(x, table, n);
+    else
+        vas_osc_sine(x, in, table, n, mode);
+}
+
+/* applies amp and input to the raw waveform of one chunk, table is used as scratch */
+static inline void vas_osc_combine(vas_osc *x, float *in, float *table, float *out, int n, const int mode)
+{
+    float amp = x->amp;
+
+    switch(mode) {
+
+    case MODE_MOD_WITH_INPUT:
+
+        vas_util_fmix(in, table, amp, out, n);
+        break;
+
+    case MODE_CARRIER_NO_INPUT:
+
+        vas_util_fscale(table, amp, out, n);
+        break;
+
+    case MODE_SUM_WITH_IN:
+
+        vas_util_fmix(in, table, amp, table, n);
+        vas_util_fscale(table, amp, table, n);
+        vas_util_fadd(table, in, out, n);
+        vas_util_fscale(out, 1 - amp/2, out, n);
+        break;
+
+    default: vas_log_write("vas_osc_combine: unknown mode %ld", (long)mode); break;
+    }
+}
+
+/* the block loop, inlined into one function per mode so mode is a constant */
+static inline void vas_osc_processMode(vas_osc *x, float *in, float *out, int vectorSize, const int mode)
+{
+    float table[VAS_UTIL_CHUNK];
+
+    VAS_TRACE_BEGIN("vas_osc_process");
+
+    vas_osc_prepare(x);
+
+    while(vectorSize > 0)
     {
-        int intIndex = floor(x->currentIndex);
-        currentValue = (1-(x->amp))*(*in)+x->lookupTable[intIndex]*x->amp;
+        int n = vectorSize < VAS_UTIL_CHUNK ? vectorSize : VAS_UTIL_CHUNK;
+
+        vas_osc_wave(x, in, table, n, mode);
+        vas_osc_combine(x, in, table, out, n, mode);
+
+        in += n;
+        out += n;
+        vectorSize -= n;
+    }
+
+    VAS_TRACE_END("vas_osc_process");
+}
+
+void vas_osc_processModulator(vas_osc *x, float *in, float *out, int vectorSize)
+{
+    vas_osc_processMode(x, in, out, vectorSize, MODE_MOD_WITH_INPUT);
+}
 
-        switch(mode) {
+void vas_osc_processCarrier(vas_osc *x, float *in, float *out, int vectorSize)
+{
+    vas_osc_processMode(x, in, out, vectorSize, MODE_CARRIER_NO_INPUT);
+}
 
-	    case MODE_MOD_WITH_INPUT:
+void vas_osc_processSum(vas_osc *x, float *in, float *out, int vectorSize)
+{
+    vas_osc_processMode(x, in, out, vectorSize, MODE_SUM_WITH_IN);
+}
 
-            x->currentIndex += (1 + *in++) * x->frequency;
+void vas_osc_process(vas_osc *x, float *in, float *out, int vectorSize, int mode)
+{
+    switch(mode) {
+
+        case MODE_MOD_WITH_INPUT:
+            vas_osc_processModulator(x, in, out, vectorSize);
             break;
 
-	    case MODE_CARRIER_NO_INPUT:
-            
-            x->currentIndex += x->frequency;
-            currentValue = x->lookupTable[intIndex]*x->amp;
+        case MODE_CARRIER_NO_INPUT:
+            vas_osc_processCarrier(x, in, out, vectorSize);
             break;
 
         case MODE_SUM_WITH_IN:
-
-            currentValue = ((x->amp)*currentValue + *in++)*(1-((x->amp)/2));
-            x->currentIndex += x->frequency;
+            vas_osc_processSum(x, in, out, vectorSize);
             break;
 
-	    default: printf("fehler"); break;
+        default: vas_log_write("vas_osc_process: unknown mode %ld", (long)mode); break;
+    }
+}
+
+/* ---------------------------------------------------------------- oscillator lanes */
+
+/*
+ * The state of up to four oscillators without input, one per lane. Table,
+ * external table and morphing oscillators are all read as
+ * first + fraction * (second - first) from frame = table + (int)(index * scale) * stride
+ * with second = frame[offset], a plain table has fraction and offset 0.
+ * Lanes in sineMask output the phase instead, vas_util_fsine follows.
+ * Lanes outside the mask run with frequency 0 on a silent table.
+ */
+typedef struct vas_osc_lanes
+{
+    float index[VAS_OSC_LANES];
+    float frequency[VAS_OSC_LANES];
+    float size[VAS_OSC_LANES];
+    float toPhase[VAS_OSC_LANES];
+    float scale[VAS_OSC_LANES];
+    float fraction[VAS_OSC_LANES];
+    int stride[VAS_OSC_LANES];
+    int offset[VAS_OSC_LANES];
+    const float *table[VAS_OSC_LANES];
+    int sineMask;           /* lanes computing the sine */
+} vas_osc_lanes;
+
+static const float vas_osc_silence[1];
+
+static void vas_osc_clearLane(vas_osc_lanes *l, int k)
+{
+    l->index[k] = 0;
+    l->frequency[k] = 0;
+    l->size[k] = 1;
+    l->toPhase[k] = 0;
+    l->scale[k] = 0;
+    l->fraction[k] = 0;
+    l->stride[k] = 0;
+    l->offset[k] = 0;
+    l->table[k] = vas_osc_silence;
+}
+
+/* mirrors the branches of vas_osc_wave for an oscillator without input */
+static void vas_osc_setLane(vas_osc_lanes *l, int k, vas_osc *x)
+{
+    l->index[k] = x->currentIndex;
+    l->frequency[k] = x->frequency;
+    l->size[k] = x->tableSize;
+    l->toPhase[k] = 1.0F / x->tableSize;
+    l->table[k] = x->lookupTable;
+
+    if(x->morphPairs)
+    {
+        l->scale[k] = x->tableScale;
+        l->fraction[k] = x->morphFraction;
+        l->stride[k] = 2;
+        l->offset[k] = 1;
+    }
+    else if(!x->isSine)
+    {
+        l->scale[k] = x->tableScale;
+        l->stride[k] = x->sampleStride;
+    }
+    else
+        l->sineMask |= 1 << k;
+}
+
+#ifdef VAS_OSC_X86
+
+#define VAS_OSC_SSE2_TARGET __attribute__((target("sse2")))
+
+/*
+ * One sample of all lanes. The wrap is a branch as in vas_osc_lookup, it is
+ * rarely taken, so the phase chain is a single add per sample.
+ */
+VAS_OSC_SSE2_TARGET static inline __m128 vas_osc_laneSample_sse2(const vas_osc_lanes *l, __m128 *phase, __m128 frequency,
+    __m128 size, __m128 scale, __m128 fraction, __m128 toPhase, __m128 sine, const int gather, const int morph)
+{
+    __m128 index = *phase;
+    __m128 value = _mm_mul_ps(index, toPhase);
+
+    if(gather)
+    {
+        int position[VAS_OSC_LANES];
+        float first[VAS_OSC_LANES], second[VAS_OSC_LANES];
+
+        _mm_storeu_si128((__m128i *)position, _mm_cvttps_epi32(_mm_mul_ps(index, scale)));
+        for(int k = 0; k < VAS_OSC_LANES; k++)
+        {
+            const float *frame = l->table[k] + position[k] * l->stride[k];
+            first[k] = frame[0];
+            if(morph)
+                second[k] = frame[l->offset[k]];
+        }
+
+        __m128 table = _mm_loadu_ps(first);
+        if(morph)
+            table = _mm_add_ps(table, _mm_mul_ps(fraction, _mm_sub_ps(_mm_loadu_ps(second), table)));
+        value = _mm_or_ps(_mm_and_ps(sine, value), _mm_andnot_ps(sine, table));
+    }
+
+    index = _mm_add_ps(index, frequency);
+    __m128 over = _mm_cmpge_ps(index, size);
+    __m128 under = _mm_cmplt_ps(index, _mm_setzero_ps());
+    if(_mm_movemask_ps(_mm_or_ps(over, under)))
+        index = _mm_add_ps(_mm_sub_ps(index, _mm_and_ps(over, size)), _mm_and_ps(under, size));
+    *phase = index;
+    return value;
+}
+
+VAS_OSC_SSE2_TARGET static inline void vas_osc_laneLoop_sse2(vas_osc_lanes *l, float waves[][VAS_UTIL_CHUNK], int n, const int gather, const int morph)
+{
+    __m128 index = _mm_loadu_ps(l->index);
+    __m128 frequency = _mm_loadu_ps(l->frequency);
+    __m128 size = _mm_loadu_ps(l->size);
+    __m128 toPhase = _mm_loadu_ps(l->toPhase);
+    __m128 scale = _mm_loadu_ps(l->scale);
+    __m128 fraction = _mm_loadu_ps(l->fraction);
+    __m128 sine = _mm_castsi128_ps(_mm_set_epi32(-((l->sineMask >> 3) & 1), -((l->sineMask >> 2) & 1),
+                                                 -((l->sineMask >> 1) & 1), -(l->sineMask & 1)));
+    int i = 0;
+
+#define VAS_OSC_LANESAMPLE_SSE2() vas_osc_laneSample_sse2(l, &index, frequency, size, scale, fraction, toPhase, sine, gather, morph)
+
+    /* four samples of four lanes, transposed into the waves */
+    for(; i + 4 <= n; i += 4)
+    {
+        __m128 s0 = VAS_OSC_LANESAMPLE_SSE2();
+        __m128 s1 = VAS_OSC_LANESAMPLE_SSE2();
+        __m128 s2 = VAS_OSC_LANESAMPLE_SSE2();
+        __m128 s3 = VAS_OSC_LANESAMPLE_SSE2();
+        _MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+        _mm_storeu_ps(waves[0] + i, s0);
+        _mm_storeu_ps(waves[1] + i, s1);
+        _mm_storeu_ps(waves[2] + i, s2);
+        _mm_storeu_ps(waves[3] + i, s3);
+    }
+    for(; i < n; i++)
+    {
+        float value[VAS_OSC_LANES];
+        _mm_storeu_ps(value, VAS_OSC_LANESAMPLE_SSE2());
+        for(int k = 0; k < VAS_OSC_LANES; k++)
+            waves[k][i] = value[k];
+    }
+
+#undef VAS_OSC_LANESAMPLE_SSE2
+
+    _mm_storeu_ps(l->index, index);
+}
+
+/* one loop per combination of table reads, so the unused ones are compiled out */
+VAS_OSC_SSE2_TARGET static void vas_osc_renderLanes_sse2(vas_osc_lanes *l, float waves[][VAS_UTIL_CHUNK], int n, int gather, int morph)
+{
+    if(morph)
+        vas_osc_laneLoop_sse2(l, waves, n, 1, 1);
+    else if(gather)
+        vas_osc_laneLoop_sse2(l, waves, n, 1, 0);
+    else
+        vas_osc_laneLoop_sse2(l, waves, n, 0, 0);
+}
+
+#define vas_osc_renderLanes vas_osc_renderLanes_sse2
+#define VAS_OSC_VECTOR(kernels) ((kernels) == VAS_UTIL_SSE2 || (kernels) == VAS_UTIL_AVX2)
+
+#endif /* VAS_OSC_X86 */
+
+#ifdef VAS_OSC_ARM
+
+/* see vas_osc_laneSample_sse2 */
+static inline float32x4_t vas_osc_laneSample_neon(const vas_osc_lanes *l, float32x4_t *phase, float32x4_t frequency,
+    float32x4_t size, float32x4_t scale, float32x4_t fraction, float32x4_t toPhase, uint32x4_t sine, const int gather, const int morph)
+{
+    float32x4_t index = *phase;
+    float32x4_t value = vmulq_f32(index, toPhase);
+
+    if(gather)
+    {
+        int32_t position[VAS_OSC_LANES];
+        float first[VAS_OSC_LANES], second[VAS_OSC_LANES];
+
+        vst1q_s32(position, vcvtq_s32_f32(vmulq_f32(index, scale)));
+        for(int k = 0; k < VAS_OSC_LANES; k++)
+        {
+            const float *frame = l->table[k] + position[k] * l->stride[k];
+            first[k] = frame[0];
+            if(morph)
+                second[k] = frame[l->offset[k]];
+        }
+
+        float32x4_t table = vld1q_f32(first);
+        if(morph)
+            table = vaddq_f32(table, vmulq_f32(fraction, vsubq_f32(vld1q_f32(second), table)));
+        value = vbslq_f32(sine, value, table);
+    }
+
+    index = vaddq_f32(index, frequency);
+    uint32x4_t over = vcgeq_f32(index, size);
+    uint32x4_t under = vcltq_f32(index, vdupq_n_f32(0));
+    uint32x4_t wrapped = vorrq_u32(over, under);
+    uint32x2_t folded = vorr_u32(vget_low_u32(wrapped), vget_high_u32(wrapped));
+    if(vget_lane_u32(vpmax_u32(folded, folded), 0))
+    {
+        float32x4_t zero = vdupq_n_f32(0);
+        index = vaddq_f32(index, vsubq_f32(vbslq_f32(under, size, zero), vbslq_f32(over, size, zero)));
+    }
+    *phase = index;
+    return value;
+}
+
+static inline void vas_osc_laneLoop_neon(vas_osc_lanes *l, float waves[][VAS_UTIL_CHUNK], int n, const int gather, const int morph)
+{
+    const uint32_t sineBits[VAS_OSC_LANES] = {
+        -(uint32_t)(l->sineMask & 1), -(uint32_t)((l->sineMask >> 1) & 1),
+        -(uint32_t)((l->sineMask >> 2) & 1), -(uint32_t)((l->sineMask >> 3) & 1)};
+    float32x4_t index = vld1q_f32(l->index);
+    float32x4_t frequency = vld1q_f32(l->frequency);
+    float32x4_t size = vld1q_f32(l->size);
+    float32x4_t toPhase = vld1q_f32(l->toPhase);
+    float32x4_t scale = vld1q_f32(l->scale);
+    float32x4_t fraction = vld1q_f32(l->fraction);
+    uint32x4_t sine = vld1q_u32(sineBits);
+    int i = 0;
+
+#define VAS_OSC_LANESAMPLE_NEON() vas_osc_laneSample_neon(l, &index, frequency, size, scale, fraction, toPhase, sine, gather, morph)
+
+    /* four samples of four lanes, transposed into the waves */
+    for(; i + 4 <= n; i += 4)
+    {
+        float32x4_t s0 = VAS_OSC_LANESAMPLE_NEON();
+        float32x4_t s1 = VAS_OSC_LANESAMPLE_NEON();
+        float32x4_t s2 = VAS_OSC_LANESAMPLE_NEON();
+        float32x4_t s3 = VAS_OSC_LANESAMPLE_NEON();
+        float32x4x2_t t01 = vtrnq_f32(s0, s1);
+        float32x4x2_t t23 = vtrnq_f32(s2, s3);
+        vst1q_f32(waves[0] + i, vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0])));
+        vst1q_f32(waves[1] + i, vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1])));
+        vst1q_f32(waves[2] + i, vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0])));
+        vst1q_f32(waves[3] + i, vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1])));
+    }
+    for(; i < n; i++)
+    {
+        float value[VAS_OSC_LANES];
+        vst1q_f32(value, VAS_OSC_LANESAMPLE_NEON());
+        for(int k = 0; k < VAS_OSC_LANES; k++)
+            waves[k][i] = value[k];
+    }
+
+#undef VAS_OSC_LANESAMPLE_NEON
+
+    vst1q_f32(l->index, index);
+}
+
+static void vas_osc_renderLanes_neon(vas_osc_lanes *l, float waves[][VAS_UTIL_CHUNK], int n, int gather, int morph)
+{
+    if(morph)
+        vas_osc_laneLoop_neon(l, waves, n, 1, 1);
+    else if(gather)
+        vas_osc_laneLoop_neon(l, waves, n, 1, 0);
+    else
+        vas_osc_laneLoop_neon(l, waves, n, 0, 0);
+}
+
+#define vas_osc_renderLanes vas_osc_renderLanes_neon
+#define VAS_OSC_VECTOR(kernels) ((kernels) == VAS_UTIL_NEON)
+
+#endif /* VAS_OSC_ARM */
+
+#ifndef VAS_OSC_VECTOR
+#define VAS_OSC_VECTOR(kernels) 0
+#endif
+
+void vas_osc_processLanes(vas_osc **oscs, int mask, float waves[][VAS_UTIL_CHUNK], int n)
+{
+    VAS_TRACE_BEGIN("vas_osc_processLanes");
+
+    for(int k = 0; k < VAS_OSC_LANES; k++)
+        if(mask & (1 << k))
+            vas_osc_prepare(oscs[k]);
+
+#ifdef vas_osc_renderLanes
+    if(VAS_OSC_VECTOR(vas_util_getKernels()))
+    {
+        vas_osc_lanes lanes;
+        int morph = 0;
+
+        lanes.sineMask = 0;
+        for(int k = 0; k < VAS_OSC_LANES; k++)
+        {
+            vas_osc_clearLane(&lanes, k);
+            if(mask & (1 << k))
+            {
+                vas_osc_setLane(&lanes, k, oscs[k]);
+                morph |= oscs[k]->morphPairs;
+            }
         }
 
-        *out++ = currentValue;
+        vas_osc_renderLanes(&lanes, waves, n, (mask & ~lanes.sineMask) != 0, morph != 0);
+
+        for(int k = 0; k < VAS_OSC_LANES; k++)
+        {
+            if(!(mask & (1 << k)))
+                continue;
+            oscs[k]->currentIndex = lanes.index[k];
+            if(lanes.sineMask & (1 << k))
+                vas_util_fsine(waves[k], waves[k], n);
+        }
 
-        if(x->currentIndex >= x->tableSize)
-         x->currentIndex -= x->tableSize;
+        VAS_TRACE_END("vas_osc_processLanes");
+        return;
     }
+#endif
+
+    for(int k = 0; k < VAS_OSC_LANES; k++)
+        if(mask & (1 << k))
+            vas_osc_wave(oscs[k], waves[k], waves[k], n, MODE_SUM_WITH_IN);
+
+    VAS_TRACE_END("vas_osc_processLanes");
+}
+
+void vas_osc_applyCarrier(vas_osc *x, float *wave, float *out, int n)
+{
+    vas_osc_combine(x, NULL, wave, out, n, MODE_CARRIER_NO_INPUT);
+}
+
+void vas_osc_applySum(vas_osc *x, float *wave, float *in, float *out, int n)
+{
+    vas_osc_combine(x, in, wave, out, n, MODE_SUM_WITH_IN);
 }
 
 void vas_osc_set_frequency_factor(vas_osc *x,float master_frequency, float frequency_factor)
@@ -17,11 +17,15 @@
 #include <math.h>
 #include "vas_mem.h"
 #include "vas_util.h"
+#include "vas_tables.h"
 
 #define MODE_MOD_WITH_INPUT 0 
 #define MODE_CARRIER_NO_INPUT 1
 #define MODE_SUM_WITH_IN 2
 
+/** Oscillators rendered together by vas_osc_processLanes */
+#define VAS_OSC_LANES 4
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -33,12 +37,30 @@ extern "C" {
  */
 typedef struct vas_osc
 {
-    int tableSize;          /**< tablesize of vas_osc object*/
+    /* hot: touched on every sample by vas_osc_process */
     float currentIndex;     /**< current Index from tablesize*/
     float frequency;        /**< frequency of osc*/
     float amp;              /**< amplitude of osc*/
-    float *lookupTable;     /**< the pointer to the lookupTable*/
+    int tableSize;          /**< tablesize of vas_osc object*/
+    float *lookupTable;     /**< the pointer to the lookupTable, the shared vas_tables_sine, tableStorage or an external level*/
+    float tableScale;       /**< size of lookupTable relative to tableSize, the phase runs over tableSize*/
+    int sampleStride;       /**< floats from one sample of lookupTable to the next, 1 except for referenced tables*/
+    int isSine;             /**< 1 while the table holds the default sine, the sine is then computed without the table*/
+    int levelCount;         /**< band-limited levels of an external table, 0 for the own tables*/
+    int morphPairs;         /**< frame pairs of a morphing table, 0 if the osc does not morph*/
+    float morphFraction;    /**< weight of the second frame of the current pair*/
+
+    /* cold: only touched by the setters */
     float frequency_factor; /**< frequency factor of osc*/
+    float *tableStorage;    /**< private table for custom waveforms, owned by the caller of vas_osc_init*/
+    const float *levels;    /**< first level of the external table*/
+    long levelStride;       /**< floats from one level of the external table to the next*/
+    int levelSize;          /**< samples per cycle of the external table*/
+    const float *pairs;     /**< first frame pair of the morphing table*/
+    long pairStride;        /**< floats from one frame pair to the next*/
+    long pairLevelStride;   /**< floats from one level of frame pairs to the next*/
+    float position;         /**< morph position, 0 ... morphPairs, frame 0 to the last frame*/
+    int defaultSine;        /**< 1 while the osc plays the sine of vas_osc_init, whether computed or looked up*/
 
 } vas_osc;
 
@@ -52,6 +74,93 @@ typedef struct vas_osc
  */
 vas_osc *vas_osc_new(int tableSize, float master_frequency);
 
+/**
+ * @related vas_osc
+ * @brief Initializes an osc object in memory owned by the caller<br>
+ * Used when the osc and its table live inside a vas_mem_arena. <br>
+ * The osc plays one period of a sine wave and isSine is set. With the default
+ * table size the shared vas_tables_sine is used and lookupTable is left untouched,
+ * otherwise the sine is computed into lookupTable. <br>
+ * @param x My osc object <br>
+ * @param lookupTable storage for tableSize floats, used for custom waveforms <br>
+ * @param tableSize tablesize of osc object <br>
+ * @param master_frequency master frequency of rtap_fmMultiOsc object<br>
+ */
+void vas_osc_init(vas_osc *x, float *lookupTable, int tableSize, float master_frequency);
+
+/**
+ * @related vas_osc
+ * @brief Returns the private table for writing a custom waveform<br>
+ * The osc reads this table from now on and isSine is cleared, so the caller
+ * has to write all tableSize samples. <br>
+ * @param x My osc object <br>
+ * @return the table <br>
+ */
+float *vas_osc_customTable(vas_osc *x);
+
+/**
+ * @related vas_osc
+ * @brief Reads an external read-only table, e.g. from a vas_wavetable library<br>
+ * The table is not copied and has to stay valid until the osc gets another
+ * table. The osc picks the level per block from its frequency: the first one
+ * whose harmonics (levelSize / 2 >> level) stay below Nyquist, or the last. <br>
+ * @param x My osc object <br>
+ * @param levels levelCount levels of levelSize + 1 samples, the last repeating the first <br>
+ * @param levelSize samples per cycle, may differ from tableSize <br>
+ * @param levelCount number of levels, at least 1 <br>
+ * @param levelStride floats from one level to the next <br>
+ */
+void vas_osc_externalTable(vas_osc *x, const float *levels, int levelSize, int levelCount, long levelStride);
+
+/**
+ * @related vas_osc
+ * @brief Reads a table owned by someone else in place, e.g. the storage of a Pd array<br>
+ * The samples are not copied, changes to them are heard right away. The table
+ * has to stay valid until the osc gets another table. It needs no guard
+ * sample, the phase is mapped to 0 ... length - 1/2. <br>
+ * @param x My osc object <br>
+ * @param samples the first sample <br>
+ * @param length samples per cycle, may differ from tableSize <br>
+ * @param sampleStride floats from one sample to the next <br>
+ */
+void vas_osc_referenceTable(vas_osc *x, const float *samples, int length, int sampleStride);
+
+/**
+ * @related vas_osc
+ * @brief Morphs between the frames of an external read-only table<br>
+ * The frames are stored as interleaved pairs (frame p, frame p + 1), see
+ * vas_wavetable_morph, so both samples of a phase are read from the same
+ * cache line. The table is not copied. The osc picks the pair and the level
+ * per block from the position and its frequency. The position is reset to 0. <br>
+ * @param x My osc object <br>
+ * @param pairs first pair of level 0, levelSize + 1 sample pairs per pair <br>
+ * @param levelSize samples per cycle <br>
+ * @param levelCount number of band-limited levels, at least 1 <br>
+ * @param pairCount pairs per level, at least 1 <br>
+ * @param pairStride floats from one pair to the next <br>
+ * @param levelStride floats from one level of pairs to the next <br>
+ */
+void vas_osc_morphTable(vas_osc *x, const float *pairs, int levelSize, int levelCount, int pairCount, long pairStride, long levelStride);
+
+/**
+ * @related vas_osc
+ * @brief Sets the morph position. <br>
+ * @param x My osc object <br>
+ * @param position 0 for the first frame ... number of frames - 1 for the last,
+ * fractions crossfade between neighbouring frames. Clipped to that range. <br>
+ */
+void vas_osc_setPosition(vas_osc *x, float position);
+
+/**
+ * @related vas_osc
+ * @brief Chooses how the default sine is produced. <br>
+ * The table lookup is cheaper than the computed sine but less exact. Has no
+ * effect while the osc plays a custom or external table. <br>
+ * @param x My osc object <br>
+ * @param lookup 1 to read the sine from the table, 0 to compute it <br>
+ */
+void vas_osc_setSineLookup(vas_osc *x, int lookup);
+
 /**
  * @related vas_osc
  * @brief Frees a osc object<br>
@@ -69,9 +178,67 @@ void vas_osc_free(vas_osc *x);
  * @param out The output vector <br>
  * @param vector_size The size of the i/o vectors <br>
  * The function vas_osc_process processes a oscillator depending on OSC Mode. <br>
+ * While isSine is set the sine is evaluated with vas_util_fsine instead of
+ * the lookupTable, an unmodulated carrier uses a quadrature rotation. <br>
  */
 void vas_osc_process(vas_osc *x, float *in, float *out, int vector_size, int mode);
 
+/**
+ * @related vas_osc
+ * @brief vas_osc_process with mode MODE_MOD_WITH_INPUT, compiled for that mode only. <br>
+ */
+void vas_osc_processModulator(vas_osc *x, float *in, float *out, int vector_size);
+
+/**
+ * @related vas_osc
+ * @brief vas_osc_process with mode MODE_CARRIER_NO_INPUT, compiled for that mode only. <br>
+ */
+void vas_osc_processCarrier(vas_osc *x, float *in, float *out, int vector_size);
+
+/**
+ * @related vas_osc
+ * @brief vas_osc_process with mode MODE_SUM_WITH_IN, compiled for that mode only. <br>
+ */
+void vas_osc_processSum(vas_osc *x, float *in, float *out, int vector_size);
+
+/**
+ * @related vas_osc
+ * @brief Renders the raw waveforms of up to VAS_OSC_LANES oscillators at once. <br>
+ * @param oscs VAS_OSC_LANES osc objects, entries outside mask may be NULL <br>
+ * @param mask bit k set renders oscs[k] into waves[k] <br>
+ * @param waves receives one chunk per lane, lanes outside mask are used as scratch <br>
+ * @param n samples to render, at most VAS_UTIL_CHUNK <br>
+ * Only for oscillators whose phase does not follow an input, i.e. in
+ * MODE_CARRIER_NO_INPUT or MODE_SUM_WITH_IN. With SSE2 or NEON kernels
+ * selected the phases of all lanes advance in one vector and the tables are
+ * read with one gather per sample. The waves are the table values (or the
+ * computed sine) before amp and input are applied, pass them to
+ * vas_osc_applyCarrier or vas_osc_applySum. A computed sine of a carrier is
+ * better rendered by vas_osc_processCarrier, which rotates it. <br>
+ */
+void vas_osc_processLanes(vas_osc **oscs, int mask, float waves[][VAS_UTIL_CHUNK], int n);
+
+/**
+ * @related vas_osc
+ * @brief Finishes a wave of vas_osc_processLanes like vas_osc_processCarrier. <br>
+ * @param x My osc object <br>
+ * @param wave the raw wave of x <br>
+ * @param out The output vector <br>
+ * @param n samples, at most VAS_UTIL_CHUNK <br>
+ */
+void vas_osc_applyCarrier(vas_osc *x, float *wave, float *out, int n);
+
+/**
+ * @related vas_osc
+ * @brief Finishes a wave of vas_osc_processLanes like vas_osc_processSum. <br>
+ * @param x My osc object <br>
+ * @param wave the raw wave of x, used as scratch <br>
+ * @param in The input vector <br>
+ * @param out The output vector, may be identical to in <br>
+ * @param n samples, at most VAS_UTIL_CHUNK <br>
+ */
+void vas_osc_applySum(vas_osc *x, float *wave, float *in, float *out, int n);
+
 /**
  * @related vas_osc
  * @brief Sets frequency factor of oscillator. <br>
@@ -0,0 +1,358 @@
+/**
+ * @file vas_pool.c
+ * @brief Process-wide work-stealing thread pool <br>
+ */
+#include "vas_pool.h"
+#include "vas_mem.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <limits.h>
+#else
+#include <unistd.h>
+#include <sched.h>
+#include <errno.h>
+#endif
+
+/** Idle rounds a worker spins before it sleeps, about the length of a 64 sample block */
+#define VAS_POOL_SPINS 20000
+/** Rounds a waiter spins before it yields the core to the worker running the job */
+#define VAS_POOL_WAITSPINS 1000
+
+static vas_pool *vas_pool_shared;
+/* replaces deque entries of forgotten jobs, never runs because it is never queued */
+static vas_pool_job vas_pool_nothing = {NULL, NULL, VAS_POOL_DONE};
+static pthread_mutex_t vas_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void vas_pool_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static void vas_pool_yield(void)
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+static int vas_pool_cores(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    return (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+static void vas_pool_semaphoreInit(vas_pool_semaphore *s)
+{
+#if defined(_WIN32)
+    *s = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+#elif defined(__APPLE__)
+    *s = dispatch_semaphore_create(0);
+#else
+    sem_init(s, 0, 0);
+#endif
+}
+
+static void vas_pool_semaphoreDestroy(vas_pool_semaphore *s)
+{
+#if defined(_WIN32)
+    CloseHandle(*s);
+#elif defined(__APPLE__)
+    dispatch_release(*s);
+#else
+    sem_destroy(s);
+#endif
+}
+
+/* never waits, unlike signalling a condition variable under its mutex */
+static void vas_pool_semaphorePost(vas_pool_semaphore *s)
+{
+#if defined(_WIN32)
+    ReleaseSemaphore(*s, 1, NULL);
+#elif defined(__APPLE__)
+    dispatch_semaphore_signal(*s);
+#else
+    sem_post(s);
+#endif
+}
+
+static void vas_pool_semaphoreWait(vas_pool_semaphore *s)
+{
+#if defined(_WIN32)
+    WaitForSingleObject(*s, INFINITE);
+#elif defined(__APPLE__)
+    dispatch_semaphore_wait(*s, DISPATCH_TIME_FOREVER);
+#else
+    while(sem_wait(s) && errno == EINTR)
+        ;
+#endif
+}
+
+/* takes one of the sleeping workers, returns 0 if none is left */
+static int vas_pool_claimSleeper(vas_pool *x)
+{
+    int sleeping = atomic_load(&x->sleeping);
+
+    while(sleeping > 0 && !atomic_compare_exchange_weak(&x->sleeping, &sleeping, sleeping - 1))
+        ;
+    return sleeping > 0;
+}
+
+static void vas_pool_lockQueue(vas_pool_queue *q)
+{
+    while(atomic_flag_test_and_set_explicit(&q->lock, memory_order_acquire))
+        vas_pool_relax();
+}
+
+static void vas_pool_unlockQueue(vas_pool_queue *q)
+{
+    atomic_flag_clear_explicit(&q->lock, memory_order_release);
+}
+
+static int vas_pool_push(vas_pool_queue *q, vas_pool_job *job)
+{
+    int pushed = 0;
+
+    vas_pool_lockQueue(q);
+    if(q->bottom - q->top < VAS_POOL_QUEUESIZE)
+    {
+        q->jobs[q->bottom++ & (VAS_POOL_QUEUESIZE - 1)] = job;
+        pushed = 1;
+    }
+    vas_pool_unlockQueue(q);
+    return pushed;
+}
+
+/*
+ * takes the newest job for the owner, the oldest one for a thief, and claims
+ * it while the deque is locked, so a worker never touches a job after
+ * vas_pool_forget. Returns NULL for an empty deque and vas_pool_nothing for
+ * a job that was already run by a waiter.
+ */
+static vas_pool_job *vas_pool_take(vas_pool_queue *q, int steal)
+{
+    vas_pool_job *job = NULL;
+
+    vas_pool_lockQueue(q);
+    if(q->bottom != q->top)
+    {
+        int expected = VAS_POOL_QUEUED;
+
+        job = steal ? q->jobs[q->top++ & (VAS_POOL_QUEUESIZE - 1)] : q->jobs[--q->bottom & (VAS_POOL_QUEUESIZE - 1)];
+        if(!atomic_compare_exchange_strong(&job->state, &expected, VAS_POOL_RUNNING))
+            job = &vas_pool_nothing;
+    }
+    vas_pool_unlockQueue(q);
+    return job;
+}
+
+/* runs a queued job on the calling thread unless a worker got to it first */
+static void vas_pool_execute(vas_pool_job *job)
+{
+    int expected = VAS_POOL_QUEUED;
+
+    if(atomic_compare_exchange_strong(&job->state, &expected, VAS_POOL_RUNNING))
+    {
+        job->run(job->arg);
+        atomic_store(&job->state, VAS_POOL_DONE);
+    }
+}
+
+typedef struct vas_pool_worker
+{
+    vas_pool *pool;
+    int index;
+} vas_pool_worker;
+
+static void *vas_pool_thread(void *arg)
+{
+    vas_pool_worker *worker = (vas_pool_worker *)arg;
+    vas_pool *x = worker->pool;
+    int index = worker->index;
+    int spins = 0;
+
+    vas_mem_free(worker);
+
+    while(atomic_load(&x->running))
+    {
+        vas_pool_job *job = vas_pool_take(&x->queues[index], 0);
+
+        for(int i = 1; !job && i < x->workerCount; i++)
+            job = vas_pool_take(&x->queues[(index + i) % x->workerCount], 1);
+
+        if(job)
+        {
+            atomic_fetch_sub(&x->pending, 1);
+            if(job != &vas_pool_nothing)
+            {
+                job->run(job->arg);
+                atomic_store(&job->state, VAS_POOL_DONE);
+            }
+            spins = 0;
+            continue;
+        }
+
+        if(++spins < VAS_POOL_SPINS)
+        {
+            vas_pool_relax();
+            continue;
+        }
+
+        /*
+         * announce the sleep before looking at pending a last time, a
+         * submission increments pending before it looks at sleeping, so one
+         * of the two sees the other and no wakeup gets lost
+         */
+        atomic_fetch_add(&x->sleeping, 1);
+        if(atomic_load(&x->running) && !atomic_load(&x->pending))
+            vas_pool_semaphoreWait(&x->wake);
+        /* a submission that claimed this worker already posted, take that post */
+        else if(!vas_pool_claimSleeper(x))
+            vas_pool_semaphoreWait(&x->wake);
+        spins = 0;
+    }
+    return NULL;
+}
+
+static vas_pool *vas_pool_new(void)
+{
+    vas_pool *x = (vas_pool *) vas_mem_alloc(sizeof(vas_pool));
+    int cores = vas_pool_cores();
+
+    /* without a spare core the jobs run inline in vas_pool_submit */
+    x->workerCount = cores > 1 ? cores - 1 : 0;
+    if(x->workerCount > VAS_POOL_MAXWORKERS)
+        x->workerCount = VAS_POOL_MAXWORKERS;
+    x->queues = (vas_pool_queue *) vas_mem_alloc((x->workerCount + 1) * sizeof(vas_pool_queue));
+    for(int i = 0; i < x->workerCount; i++)
+        atomic_flag_clear(&x->queues[i].lock);
+
+    atomic_init(&x->running, 1);
+    atomic_init(&x->pending, 0);
+    atomic_init(&x->next, 0);
+    atomic_init(&x->sleeping, 0);
+    vas_pool_semaphoreInit(&x->wake);
+
+    for(int i = 0; i < x->workerCount; i++)
+    {
+        vas_pool_worker *worker = (vas_pool_worker *) vas_mem_alloc(sizeof(vas_pool_worker));
+        worker->pool = x;
+        worker->index = i;
+        pthread_create(&x->threads[i], NULL, vas_pool_thread, worker);
+    }
+    return x;
+}
+
+static void vas_pool_free(vas_pool *x)
+{
+    atomic_store(&x->running, 0);
+    /* one post per worker, the ones awake find running cleared without it */
+    for(int i = 0; i < x->workerCount; i++)
+        vas_pool_semaphorePost(&x->wake);
+
+    for(int i = 0; i < x->workerCount; i++)
+        pthread_join(x->threads[i], NULL);
+
+    vas_pool_semaphoreDestroy(&x->wake);
+    vas_mem_free(x->queues);
+    vas_mem_free(x);
+}
+
+vas_pool *vas_pool_acquire(void)
+{
+    vas_pool *x;
+
+    pthread_mutex_lock(&vas_pool_lock);
+    if(!vas_pool_shared)
+        vas_pool_shared = vas_pool_new();
+    vas_pool_shared->refCount++;
+    x = vas_pool_shared;
+    pthread_mutex_unlock(&vas_pool_lock);
+    return x;
+}
+
+void vas_pool_release(vas_pool *x)
+{
+    if(!x)
+        return;
+
+    pthread_mutex_lock(&vas_pool_lock);
+    if(--x->refCount > 0)
+    {
+        pthread_mutex_unlock(&vas_pool_lock);
+        return;
+    }
+    vas_pool_shared = NULL;
+    pthread_mutex_unlock(&vas_pool_lock);
+
+    vas_pool_free(x);
+}
+
+void vas_pool_job_init(vas_pool_job *job, vas_pool_function run, void *arg)
+{
+    job->run = run;
+    job->arg = arg;
+    atomic_init(&job->state, VAS_POOL_IDLE);
+}
+
+void vas_pool_submit(vas_pool *x, vas_pool_job *job)
+{
+    unsigned int first = atomic_fetch_add(&x->next, 1);
+
+    atomic_store(&job->state, VAS_POOL_QUEUED);
+
+    for(int i = 0; i < x->workerCount; i++)
+    {
+        if(vas_pool_push(&x->queues[(first + i) % x->workerCount], job))
+        {
+            atomic_fetch_add(&x->pending, 1);
+            /* see vas_pool_thread for why this wakeup cannot get lost */
+            if(vas_pool_claimSleeper(x))
+                vas_pool_semaphorePost(&x->wake);
+            return;
+        }
+    }
+
+    vas_pool_execute(job);
+}
+
+void vas_pool_forget(vas_pool *x, vas_pool_job *job)
+{
+    vas_pool_wait(job);
+
+    for(int i = 0; i < x->workerCount; i++)
+    {
+        vas_pool_queue *q = &x->queues[i];
+
+        vas_pool_lockQueue(q);
+        for(unsigned int k = q->top; k != q->bottom; k++)
+            if(q->jobs[k & (VAS_POOL_QUEUESIZE - 1)] == job)
+                q->jobs[k & (VAS_POOL_QUEUESIZE - 1)] = &vas_pool_nothing;
+        vas_pool_unlockQueue(q);
+    }
+}
+
+void vas_pool_wait(vas_pool_job *job)
+{
+    int spins = 0;
+
+    vas_pool_execute(job);
+    while(atomic_load(&job->state) == VAS_POOL_RUNNING)
+    {
+        if(++spins < VAS_POOL_WAITSPINS)
+            vas_pool_relax();
+        else
+            vas_pool_yield();
+    }
+}
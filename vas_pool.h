@@ -0,0 +1,151 @@
+/**
+ * @file vas_pool.h
+ * @brief Process-wide work-stealing thread pool <br>
+ * <br>
+ * All users share one pool with a worker per core but one, the calling
+ * thread being the remaining one. On a single core there are no workers
+ * and submitted jobs run right away. Every worker has its own bounded deque:
+ * submitted jobs are dealt round-robin to the deques, a worker takes the
+ * newest job of its own deque and steals the oldest job of another deque
+ * when its own one is empty, so uneven job costs even out over the cores.
+ * <br>
+ * A job that a waiter ran itself leaves a stale entry in a deque, which the
+ * worker skips. vas_pool_forget removes these entries before the job's memory
+ * is freed.
+ * <br>
+ * Submitting and waiting neither allocate nor take a mutex, so both may be
+ * called from the audio thread: a sleeping worker is woken by posting a
+ * semaphore, which never waits for the worker. A job that has not been
+ * started when it is waited for runs on the waiting thread.
+ * <br>
+ */
+
+#ifndef vas_pool_h
+#define vas_pool_h
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#if defined(_WIN32)
+/** a semaphore HANDLE, windows.h stays out of the header */
+typedef void *vas_pool_semaphore;
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+typedef dispatch_semaphore_t vas_pool_semaphore;
+#else
+#include <semaphore.h>
+typedef sem_t vas_pool_semaphore;
+#endif
+
+/** Capacity of every worker deque, a power of two */
+#define VAS_POOL_QUEUESIZE 1024
+#define VAS_POOL_MAXWORKERS 64
+
+#define VAS_POOL_IDLE 0
+#define VAS_POOL_QUEUED 1
+#define VAS_POOL_RUNNING 2
+#define VAS_POOL_DONE 3
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*vas_pool_function)(void *arg);
+
+/**
+ * @struct vas_pool_job
+ * @brief A unit of work, owned by the submitter and reused for every submission. <br>
+ */
+typedef struct vas_pool_job
+{
+    vas_pool_function run;  /**< the work*/
+    void *arg;              /**< argument of run*/
+    atomic_int state;       /**< VAS_POOL_IDLE, _QUEUED, _RUNNING or _DONE*/
+} vas_pool_job;
+
+/**
+ * @struct vas_pool_queue
+ * @brief The deque of one worker, guarded by a spin lock. <br>
+ */
+typedef struct vas_pool_queue
+{
+    atomic_flag lock;       /**< held only for a push or pop*/
+    unsigned int top;       /**< oldest job, where thieves take from*/
+    unsigned int bottom;    /**< one behind the newest job, where the owner takes from*/
+    vas_pool_job *jobs[VAS_POOL_QUEUESIZE]; /**< ring of jobs*/
+    char padding[64];       /**< keeps the locks of neighbouring deques on different cache lines*/
+} vas_pool_queue;
+
+/**
+ * @struct vas_pool
+ * @brief The shared pool. <br>
+ */
+typedef struct vas_pool
+{
+    int workerCount;        /**< number of worker threads*/
+    int refCount;           /**< number of vas_pool_acquire without vas_pool_release*/
+    pthread_t threads[VAS_POOL_MAXWORKERS]; /**< the workers*/
+    vas_pool_queue *queues; /**< one deque per worker*/
+
+    atomic_int running;     /**< cleared to stop the workers*/
+    atomic_int pending;     /**< jobs in all deques*/
+    atomic_uint next;       /**< deque for the next submission*/
+    atomic_int sleeping;    /**< workers going to sleep on wake that no submission has posted for yet*/
+    vas_pool_semaphore wake; /**< posted once for every sleeping worker a submission wakes*/
+} vas_pool;
+
+/**
+ * @related vas_pool
+ * @brief Returns the shared pool, starting it on first use <br>
+ * @return the pool <br>
+ */
+vas_pool *vas_pool_acquire(void);
+
+/**
+ * @related vas_pool
+ * @brief Drops one reference, the workers are stopped with the last one <br>
+ * @param x the pool <br>
+ */
+void vas_pool_release(vas_pool *x);
+
+/**
+ * @related vas_pool_job
+ * @brief Prepares a job for submission <br>
+ * @param job the job <br>
+ * @param run the work <br>
+ * @param arg argument of run <br>
+ */
+void vas_pool_job_init(vas_pool_job *job, vas_pool_function run, void *arg);
+
+/**
+ * @related vas_pool
+ * @brief Queues a job, it must not be queued or running already <br>
+ * If all deques are full the job runs right away on the calling thread. <br>
+ * @param x the pool <br>
+ * @param job the job <br>
+ */
+void vas_pool_submit(vas_pool *x, vas_pool_job *job);
+
+/**
+ * @related vas_pool_job
+ * @brief Returns when the last submission of a job has finished <br>
+ * Runs the job on the calling thread if no worker has started it yet,
+ * returns immediately if it was never submitted. <br>
+ * @param job the job <br>
+ */
+void vas_pool_wait(vas_pool_job *job);
+
+/**
+ * @related vas_pool
+ * @brief Waits for a job and removes all its entries from the deques <br>
+ * Call before the memory of the job is freed or reused for something else. <br>
+ * @param x the pool <br>
+ * @param job the job <br>
+ */
+void vas_pool_forget(vas_pool *x, vas_pool_job *job);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* vas_pool_h */
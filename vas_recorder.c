@@ -0,0 +1,134 @@
+/**
+ * @file vas_recorder.c
+ * @brief Non-blocking disk recorder <br>
+ */
+#include "vas_recorder.h"
+#include "vas_wav.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/** Frames the writer collects before it writes to disk */
+#define VAS_RECORDER_WRITESIZE 32768
+#define VAS_RECORDER_POLL_MS 10
+
+static void vas_recorder_sleep(int ms)
+{
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    struct timespec ts = {0, ms * 1000000L};
+    nanosleep(&ts, NULL);
+#endif
+}
+
+static void *vas_recorder_thread(void *arg)
+{
+    vas_recorder *x = (vas_recorder *)arg;
+    vas_wav *wav = vas_wav_open(x->path, x->sampleRate, 1);
+    float *chunk;
+
+    if(!wav)
+    {
+        atomic_store(&x->state, VAS_RECORDER_ERROR);
+        return NULL;
+    }
+
+    chunk = (float *) vas_mem_allocAs(VAS_RECORDER_WRITESIZE * sizeof(float), VAS_MEM_SCRATCH);
+
+    while(1)
+    {
+        int stopping = atomic_load(&x->stopRequested);
+        unsigned int available = vas_ringbuffer_getReadSpace(x->ring);
+
+        /* wait for a large chunk unless we are flushing the rest */
+        if(available >= VAS_RECORDER_WRITESIZE || (stopping && available > 0))
+        {
+            unsigned int n = vas_ringbuffer_read(x->ring, chunk, VAS_RECORDER_WRITESIZE);
+            atomic_fetch_add(&x->writtenFrames, vas_wav_write(wav, chunk, n));
+        }
+        else if(stopping)
+            break;
+        else
+            vas_recorder_sleep(VAS_RECORDER_POLL_MS);
+    }
+
+    vas_wav_close(wav);
+    vas_mem_free(chunk);
+    return NULL;
+}
+
+vas_recorder *vas_recorder_new(unsigned int capacity)
+{
+    vas_recorder *x = (vas_recorder *) vas_mem_alloc(sizeof(vas_recorder));
+
+    x->ring = vas_ringbuffer_new(capacity);
+    x->threadRunning = 0;
+    x->path[0] = 0;
+    x->sampleRate = 44100;
+    atomic_init(&x->state, VAS_RECORDER_IDLE);
+    atomic_init(&x->stopRequested, 0);
+    atomic_init(&x->overruns, 0);
+    atomic_init(&x->droppedFrames, 0);
+    atomic_init(&x->writtenFrames, 0);
+    return x;
+}
+
+void vas_recorder_free(vas_recorder *x)
+{
+    vas_recorder_stop(x);
+    vas_ringbuffer_free(x->ring);
+    vas_mem_free(x);
+}
+
+int vas_recorder_start(vas_recorder *x, const char *path, int sampleRate)
+{
+    if(x->threadRunning)
+        return 0;
+
+    strncpy(x->path, path, VAS_RECORDER_PATHSIZE - 1);
+    x->path[VAS_RECORDER_PATHSIZE - 1] = 0;
+    x->sampleRate = sampleRate;
+
+    vas_ringbuffer_reset(x->ring);
+    atomic_store(&x->stopRequested, 0);
+    atomic_store(&x->overruns, 0);
+    atomic_store(&x->droppedFrames, 0);
+    atomic_store(&x->writtenFrames, 0);
+    atomic_store(&x->state, VAS_RECORDER_RECORDING);
+
+    if(pthread_create(&x->thread, NULL, vas_recorder_thread, x))
+    {
+        atomic_store(&x->state, VAS_RECORDER_ERROR);
+        return 0;
+    }
+    x->threadRunning = 1;
+    return 1;
+}
+
+void vas_recorder_write(vas_recorder *x, const float *samples, int n)
+{
+    if(atomic_load_explicit(&x->state, memory_order_relaxed) != VAS_RECORDER_RECORDING)
+        return;
+
+    if(!vas_ringbuffer_write(x->ring, samples, n))
+    {
+        atomic_fetch_add_explicit(&x->overruns, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&x->droppedFrames, n, memory_order_relaxed);
+    }
+}
+
+void vas_recorder_stop(vas_recorder *x)
+{
+    if(!x->threadRunning)
+        return;
+
+    if(atomic_load(&x->state) == VAS_RECORDER_RECORDING)
+        atomic_store(&x->state, VAS_RECORDER_IDLE);
+    atomic_store(&x->stopRequested, 1);
+    pthread_join(x->thread, NULL);
+    x->threadRunning = 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * @file vas_recorder.h
+ * @brief Non-blocking disk recorder <br>
+ * <br>
+ * The audio thread copies its output into a preallocated lock-free ring
+ * buffer with vas_recorder_write. A writer thread drains the ring buffer
+ * to a WAV file in large sequential writes. When the ring buffer is full
+ * the block is dropped and counted as overrun, the audio thread never
+ * waits, allocates or touches the file.
+ * <br>
+ */
+
+#ifndef vas_recorder_h
+#define vas_recorder_h
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "vas_ringbuffer.h"
+
+#define VAS_RECORDER_PATHSIZE 1024
+
+#define VAS_RECORDER_IDLE 0
+#define VAS_RECORDER_RECORDING 1
+#define VAS_RECORDER_ERROR 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct vas_recorder
+ * @brief A structure for vas_recorder object. <br>
+ */
+typedef struct vas_recorder
+{
+    vas_ringbuffer *ring;           /**< samples on their way from the audio thread to the writer*/
+    pthread_t thread;               /**< the writer thread*/
+    int threadRunning;              /**< the writer thread has been started and not joined*/
+    char path[VAS_RECORDER_PATHSIZE]; /**< file name of the current recording*/
+    int sampleRate;                 /**< sample rate written to the file*/
+
+    atomic_int state;               /**< VAS_RECORDER_IDLE, _RECORDING or _ERROR*/
+    atomic_int stopRequested;       /**< set by vas_recorder_stop, read by the writer*/
+    atomic_int overruns;            /**< number of blocks dropped because the ring buffer was full*/
+    atomic_long droppedFrames;      /**< number of frames in those blocks*/
+    atomic_long writtenFrames;      /**< frames written to the file*/
+} vas_recorder;
+
+/**
+ * @related vas_recorder
+ * @brief Creates a new recorder <br>
+ * @param capacity ring buffer capacity in samples <br>
+ * @return the recorder <br>
+ */
+vas_recorder *vas_recorder_new(unsigned int capacity);
+
+/**
+ * @related vas_recorder
+ * @brief Stops a running recording and frees the recorder <br>
+ */
+void vas_recorder_free(vas_recorder *x);
+
+/**
+ * @related vas_recorder
+ * @brief Starts recording to a file <br>
+ * The file is created by the writer thread. <br>
+ * @param x My recorder <br>
+ * @param path file name <br>
+ * @param sampleRate sample rate <br>
+ * @return 1 if the recording was started, 0 if one is already running <br>
+ */
+int vas_recorder_start(vas_recorder *x, const char *path, int sampleRate);
+
+/**
+ * @related vas_recorder
+ * @brief Queues one block for recording, real-time safe <br>
+ * Does nothing while not recording. <br>
+ * @param x My recorder <br>
+ * @param samples the block <br>
+ * @param n number of samples <br>
+ */
+void vas_recorder_write(vas_recorder *x, const float *samples, int n);
+
+/**
+ * @related vas_recorder
+ * @brief Stops recording, waits until the writer has flushed and closed the file <br>
+ * @param x My recorder <br>
+ */
+void vas_recorder_stop(vas_recorder *x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* vas_recorder_h */
@@ -0,0 +1,134 @@
+/**
+ * @file vas_resample.c
+ * @brief Resampling of single cycle waveforms to the table size of the oscillators <br>
+ */
+#include "vas_resample.h"
+#include "vas_mem.h"
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/** Zero crossings of the sinc on each side of a sample, at the lower of both rates */
+#define VAS_RESAMPLE_ZEROS 16
+
+int vas_resample_size(int length)
+{
+    int size = VAS_RESAMPLE_MINSIZE;
+
+    while(size < length && size < VAS_RESAMPLE_MAXSIZE)
+        size *= 2;
+    return size;
+}
+
+void vas_resample_cycle(const float *in, int length, int inStride, float *out, int size)
+{
+    /* the cutoff relative to the input rate, below 1 if harmonics have to go */
+    double cutoff = size < length ? (double)size / length : 1;
+    double halfWidth = VAS_RESAMPLE_ZEROS / cutoff;
+    double step = (double)length / size;
+
+    if(size == length)
+    {
+        for(int j = 0; j < size; j++)
+            out[j] = in[(long)j * inStride];
+        out[size] = out[0];
+        return;
+    }
+
+    for(int j = 0; j < size; j++)
+    {
+        double position = j * step;
+        long first = (long)ceil(position - halfWidth);
+        long last = (long)floor(position + halfWidth);
+        double sum = 0;
+
+        for(long k = first; k <= last; k++)
+        {
+            double t = k - position;
+            double x = M_PI * cutoff * t;
+            double sinc = x == 0 ? 1 : sin(x) / x;
+            /* Blackman window over -halfWidth ... halfWidth */
+            double w = 0.42 + 0.5 * cos(M_PI * t / halfWidth) + 0.08 * cos(2 * M_PI * t / halfWidth);
+            long index = k % length;
+
+            if(index < 0)
+                index += length;
+            sum += in[index * inStride] * cutoff * sinc * w;
+        }
+        out[j] = (float)sum;
+    }
+    out[size] = out[0];
+}
+
+static void *vas_resample_thread(void *arg)
+{
+    vas_resample_job *x = (vas_resample_job *)arg;
+    int expected = VAS_RESAMPLE_RUNNING;
+
+    vas_resample_cycle(x->source, x->length, 1, x->table, x->size);
+    vas_mem_free(x->source);
+    x->source = NULL;
+
+    /* nobody waits for a cancelled job, it cleans up after itself */
+    if(!atomic_compare_exchange_strong(&x->state, &expected, VAS_RESAMPLE_DONE))
+    {
+        vas_mem_free(x->table);
+        vas_mem_free(x);
+    }
+    return NULL;
+}
+
+vas_resample_job *vas_resample_start(const float *in, int length, int inStride)
+{
+    vas_resample_job *x = (vas_resample_job *) vas_mem_allocAs(sizeof(vas_resample_job), VAS_MEM_SCRATCH);
+
+    x->length = length;
+    x->size = vas_resample_size(length);
+    x->source = (float *) vas_mem_allocAs(length * sizeof(float), VAS_MEM_SCRATCH);
+    x->table = (float *) vas_mem_allocAs((x->size + 1) * sizeof(float), VAS_MEM_OSCTABLE);
+    for(int i = 0; i < length; i++)
+        x->source[i] = in[(long)i * inStride];
+    atomic_init(&x->state, VAS_RESAMPLE_RUNNING);
+
+    if(pthread_create(&x->thread, NULL, vas_resample_thread, x))
+    {
+        vas_mem_free(x->source);
+        vas_mem_free(x->table);
+        vas_mem_free(x);
+        return NULL;
+    }
+    return x;
+}
+
+int vas_resample_done(vas_resample_job *x)
+{
+    return atomic_load(&x->state) == VAS_RESAMPLE_DONE;
+}
+
+float *vas_resample_finish(vas_resample_job *x, int *size)
+{
+    float *table = x->table;
+
+    pthread_join(x->thread, NULL);
+    *size = x->size;
+    vas_mem_free(x);
+    return table;
+}
+
+void vas_resample_cancel(vas_resample_job *x)
+{
+    int expected = VAS_RESAMPLE_RUNNING;
+
+    if(!x)
+        return;
+
+    if(atomic_compare_exchange_strong(&x->state, &expected, VAS_RESAMPLE_CANCELLED))
+        pthread_detach(x->thread);
+    else
+    {
+        int size;
+        vas_mem_free(vas_resample_finish(x, &size));
+    }
+}
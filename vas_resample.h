@@ -0,0 +1,104 @@
+/**
+ * @file vas_resample.h
+ * @brief Resampling of single cycle waveforms to the table size of the oscillators <br>
+ * <br>
+ * A waveform of any length, e.g. a 256 sample single cycle or a cycle cut
+ * from a recording, is resampled to a power of two between
+ * VAS_RESAMPLE_MINSIZE and VAS_RESAMPLE_MAXSIZE with a windowed sinc
+ * interpolator that treats the waveform as periodic. Short waveforms are
+ * interpolated up, so the truncating table lookup of the oscillator stays
+ * clean; long ones are low-passed and reduced, which keeps the tables small
+ * enough to stay in the cache. At VAS_RESAMPLE_MAXSIZE samples only harmonics
+ * above 4095 are lost, which are above Nyquist for every fundamental above 6 Hz.
+ * <br>
+ * vas_resample_start runs the resampling on a thread of its own, so it can
+ * be requested from the audio thread without stalling it.
+ * <br>
+ */
+
+#ifndef vas_resample_h
+#define vas_resample_h
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define VAS_RESAMPLE_MINSIZE 2048
+#define VAS_RESAMPLE_MAXSIZE 8192
+
+#define VAS_RESAMPLE_RUNNING 0
+#define VAS_RESAMPLE_DONE 1
+#define VAS_RESAMPLE_CANCELLED 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct vas_resample_job
+ * @brief A waveform being resampled in the background. <br>
+ */
+typedef struct vas_resample_job
+{
+    pthread_t thread;       /**< the thread doing the work*/
+    atomic_int state;       /**< VAS_RESAMPLE_RUNNING, _DONE or _CANCELLED*/
+    float *source;          /**< copy of the waveform*/
+    int length;             /**< samples in source*/
+    float *table;           /**< the result, size + 1 samples, the last repeating the first*/
+    int size;               /**< samples per cycle of table*/
+} vas_resample_job;
+
+/**
+ * @brief Returns the table size a waveform is resampled to <br>
+ * @param length samples of the waveform <br>
+ * @return the next power of two, at least VAS_RESAMPLE_MINSIZE and at most VAS_RESAMPLE_MAXSIZE <br>
+ */
+int vas_resample_size(int length);
+
+/**
+ * @brief Resamples one cycle of a periodic waveform <br>
+ * @param in the waveform <br>
+ * @param length samples in the waveform <br>
+ * @param inStride floats from one input sample to the next <br>
+ * @param out receives size + 1 samples, the last repeating the first <br>
+ * @param size samples per cycle of out <br>
+ */
+void vas_resample_cycle(const float *in, int length, int inStride, float *out, int size);
+
+/**
+ * @related vas_resample_job
+ * @brief Copies a waveform and starts resampling it to vas_resample_size(length) samples <br>
+ * @param in the waveform <br>
+ * @param length samples in the waveform, at least 1 <br>
+ * @param inStride floats from one input sample to the next <br>
+ * @return the job or NULL if no thread could be started <br>
+ */
+vas_resample_job *vas_resample_start(const float *in, int length, int inStride);
+
+/**
+ * @related vas_resample_job
+ * @brief Returns 1 once the table is ready, never blocks <br>
+ * @param x the job <br>
+ */
+int vas_resample_done(vas_resample_job *x);
+
+/**
+ * @related vas_resample_job
+ * @brief Waits for the job and frees it <br>
+ * @param x the job <br>
+ * @param size receives the samples per cycle of the table <br>
+ * @return the table, to be freed by the caller with vas_mem_free <br>
+ */
+float *vas_resample_finish(vas_resample_job *x, int *size);
+
+/**
+ * @related vas_resample_job
+ * @brief Drops a job without waiting, a running thread frees it when it is done <br>
+ * @param x the job, may be NULL <br>
+ */
+void vas_resample_cancel(vas_resample_job *x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* vas_resample_h */
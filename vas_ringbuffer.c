@@ -0,0 +1,82 @@
+/**
+ * @file vas_ringbuffer.c
+ * @brief Lock-free single producer / single consumer ring buffer for floats <br>
+ */
+#include "vas_ringbuffer.h"
+
+vas_ringbuffer *vas_ringbuffer_new(unsigned int minSize)
+{
+    vas_ringbuffer *x = (vas_ringbuffer *) vas_mem_alloc(sizeof(vas_ringbuffer));
+    unsigned int size = 1;
+
+    while(size < minSize)
+        size <<= 1;
+
+    x->buffer = (float *) vas_mem_alloc(size * sizeof(float));
+    x->size = size;
+    x->mask = size - 1;
+    atomic_init(&x->writeIndex, 0);
+    atomic_init(&x->readIndex, 0);
+    return x;
+}
+
+void vas_ringbuffer_free(vas_ringbuffer *x)
+{
+    vas_mem_free(x->buffer);
+    vas_mem_free(x);
+}
+
+unsigned int vas_ringbuffer_getWriteSpace(vas_ringbuffer *x)
+{
+    unsigned int w = atomic_load_explicit(&x->writeIndex, memory_order_relaxed);
+    unsigned int r = atomic_load_explicit(&x->readIndex, memory_order_acquire);
+    return x->size - (w - r);
+}
+
+unsigned int vas_ringbuffer_getReadSpace(vas_ringbuffer *x)
+{
+    unsigned int w = atomic_load_explicit(&x->writeIndex, memory_order_acquire);
+    unsigned int r = atomic_load_explicit(&x->readIndex, memory_order_relaxed);
+    return w - r;
+}
+
+int vas_ringbuffer_write(vas_ringbuffer *x, const float *data, unsigned int n)
+{
+    unsigned int w = atomic_load_explicit(&x->writeIndex, memory_order_relaxed);
+    unsigned int start, first;
+
+    if(vas_ringbuffer_getWriteSpace(x) < n)
+        return 0;
+
+    start = w & x->mask;
+    first = x->size - start < n ? x->size - start : n;
+    memcpy(x->buffer + start, data, first * sizeof(float));
+    memcpy(x->buffer, data + first, (n - first) * sizeof(float));
+
+    atomic_store_explicit(&x->writeIndex, w + n, memory_order_release);
+    return 1;
+}
+
+unsigned int vas_ringbuffer_read(vas_ringbuffer *x, float *dest, unsigned int n)
+{
+    unsigned int r = atomic_load_explicit(&x->readIndex, memory_order_relaxed);
+    unsigned int available = vas_ringbuffer_getReadSpace(x);
+    unsigned int start, first;
+
+    if(n > available)
+        n = available;
+
+    start = r & x->mask;
+    first = x->size - start < n ? x->size - start : n;
+    memcpy(dest, x->buffer + start, first * sizeof(float));
+    memcpy(dest + first, x->buffer, (n - first) * sizeof(float));
+
+    atomic_store_explicit(&x->readIndex, r + n, memory_order_release);
+    return n;
+}
+
+void vas_ringbuffer_reset(vas_ringbuffer *x)
+{
+    atomic_store(&x->writeIndex, 0);
+    atomic_store(&x->readIndex, 0);
+}
@@ -0,0 +1,84 @@
+/**
+ * @file vas_ringbuffer.h
+ * @brief Lock-free single producer / single consumer ring buffer for floats <br>
+ * <br>
+ * One thread writes (usually the audio thread), one other thread reads.
+ * Neither side ever blocks or allocates. The capacity is rounded up to a
+ * power of two.
+ * <br>
+ */
+
+#ifndef vas_ringbuffer_h
+#define vas_ringbuffer_h
+
+#include <stdatomic.h>
+#include "vas_mem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct vas_ringbuffer
+ * @brief A structure for vas_ringbuffer object. <br>
+ */
+typedef struct vas_ringbuffer
+{
+    float *buffer;              /**< the samples*/
+    unsigned int size;          /**< capacity, a power of two*/
+    unsigned int mask;          /**< size - 1*/
+    atomic_uint writeIndex;     /**< total number of samples written, only changed by the producer*/
+    atomic_uint readIndex;      /**< total number of samples read, only changed by the consumer*/
+} vas_ringbuffer;
+
+/**
+ * @related vas_ringbuffer
+ * @brief Creates a new ring buffer <br>
+ * @param minSize minimum capacity in samples <br>
+ * @return the ring buffer <br>
+ */
+vas_ringbuffer *vas_ringbuffer_new(unsigned int minSize);
+
+/**
+ * @related vas_ringbuffer
+ * @brief Frees a ring buffer <br>
+ */
+void vas_ringbuffer_free(vas_ringbuffer *x);
+
+/**
+ * @related vas_ringbuffer
+ * @brief Number of samples the producer can write without overwriting unread data <br>
+ */
+unsigned int vas_ringbuffer_getWriteSpace(vas_ringbuffer *x);
+
+/**
+ * @related vas_ringbuffer
+ * @brief Number of samples the consumer can read <br>
+ */
+unsigned int vas_ringbuffer_getReadSpace(vas_ringbuffer *x);
+
+/**
+ * @related vas_ringbuffer
+ * @brief Writes n samples if they fit completely <br>
+ * @return 1 if the samples were written, 0 if there was not enough space <br>
+ */
+int vas_ringbuffer_write(vas_ringbuffer *x, const float *data, unsigned int n);
+
+/**
+ * @related vas_ringbuffer
+ * @brief Reads up to n samples <br>
+ * @return the number of samples read <br>
+ */
+unsigned int vas_ringbuffer_read(vas_ringbuffer *x, float *dest, unsigned int n);
+
+/**
+ * @related vas_ringbuffer
+ * @brief Empties the buffer, only call while neither side is active <br>
+ */
+void vas_ringbuffer_reset(vas_ringbuffer *x);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* vas_ringbuffer_h */
@@ -0,0 +1,258 @@
+/**
+ * @file vas_rtcheck.c
+ * @brief Debug build that flags calls which are not real-time safe <br>
+ */
+#include "vas_rtcheck.h"
+#include <stdio.h>
+
+#ifdef VAS_RTCHECK
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "vas_log.h"
+
+static const char *vas_rtcheck_names[VAS_RTCHECK_KINDS] = {"allocation", "free", "lock", "stdio"};
+
+static _Thread_local int vas_rtcheck_depth;
+static atomic_long vas_rtcheck_counts[VAS_RTCHECK_KINDS];
+
+/* one literal per kind, vas_log only keeps the pointer */
+static const char *vas_rtcheck_messages[VAS_RTCHECK_KINDS] =
+{
+    "rtcheck: allocation in the audio path, called from 0x%lx",
+    "rtcheck: free in the audio path, called from 0x%lx",
+    "rtcheck: lock in the audio path, called from 0x%lx",
+    "rtcheck: stdio in the audio path, called from 0x%lx",
+};
+
+void vas_rtcheck_enter(void)
+{
+    vas_rtcheck_depth++;
+}
+
+void vas_rtcheck_leave(void)
+{
+    vas_rtcheck_depth--;
+}
+
+static void vas_rtcheck_flag(int kind, void *caller)
+{
+    if(vas_rtcheck_depth <= 0)
+        return;
+    if(atomic_fetch_add(&vas_rtcheck_counts[kind], 1) == 0)
+        vas_log_write(vas_rtcheck_messages[kind], (long)caller);
+}
+
+long vas_rtcheck_count(int kind)
+{
+    return atomic_load(&vas_rtcheck_counts[kind]);
+}
+
+long vas_rtcheck_report(void (*print)(const char *line))
+{
+    char line[128];
+    long total = 0;
+
+    for(int kind = 0; kind < VAS_RTCHECK_KINDS; kind++)
+    {
+        long count = vas_rtcheck_count(kind);
+
+        snprintf(line, sizeof(line), "rtcheck: %-12s %8ld calls in the audio path", vas_rtcheck_names[kind], count);
+        print(line);
+        total += count;
+    }
+    return total;
+}
+
+/* the wrappers, linked in place of the originals with -Wl,--wrap=<name> */
+
+#define VAS_RTCHECK_CALLER __builtin_return_address(0)
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+int __real_posix_memalign(void **ptr, size_t alignment, size_t size);
+void *__real_aligned_alloc(size_t alignment, size_t size);
+int __real_pthread_mutex_lock(pthread_mutex_t *mutex);
+int __real_pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex);
+int __real_pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *time);
+int __real_pthread_join(pthread_t thread, void **result);
+int __real_puts(const char *s);
+int __real_fputs(const char *s, FILE *file);
+int __real_putchar(int c);
+size_t __real_fwrite(const void *ptr, size_t size, size_t count, FILE *file);
+FILE *__real_fopen(const char *path, const char *mode);
+int __real_fclose(FILE *file);
+int __real_fflush(FILE *file);
+int __vprintf_chk(int flag, const char *format, va_list args);
+int __vfprintf_chk(FILE *file, int flag, const char *format, va_list args);
+
+void *__wrap_malloc(size_t size)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_ALLOC, VAS_RTCHECK_CALLER);
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_ALLOC, VAS_RTCHECK_CALLER);
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_ALLOC, VAS_RTCHECK_CALLER);
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_FREE, VAS_RTCHECK_CALLER);
+    __real_free(ptr);
+}
+
+int __wrap_posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_ALLOC, VAS_RTCHECK_CALLER);
+    return __real_posix_memalign(ptr, alignment, size);
+}
+
+void *__wrap_aligned_alloc(size_t alignment, size_t size)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_ALLOC, VAS_RTCHECK_CALLER);
+    return __real_aligned_alloc(alignment, size);
+}
+
+int __wrap_pthread_mutex_lock(pthread_mutex_t *mutex)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_LOCK, VAS_RTCHECK_CALLER);
+    return __real_pthread_mutex_lock(mutex);
+}
+
+int __wrap_pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_LOCK, VAS_RTCHECK_CALLER);
+    return __real_pthread_cond_wait(cond, mutex);
+}
+
+int __wrap_pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *time)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_LOCK, VAS_RTCHECK_CALLER);
+    return __real_pthread_cond_timedwait(cond, mutex, time);
+}
+
+int __wrap_pthread_join(pthread_t thread, void **result)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_LOCK, VAS_RTCHECK_CALLER);
+    return __real_pthread_join(thread, result);
+}
+
+int __wrap_printf(const char *format, ...)
+{
+    va_list args;
+    int result;
+
+    vas_rtcheck_flag(VAS_RTCHECK_STDIO, VAS_RTCHECK_CALLER);
+    va_start(args, format);
+    result = vprintf(format, args);
+    va_end(args);
+    return result;
+}
+
+int __wrap_fprintf(FILE *file, const char *format, ...)
+{
+    va_list args;
+    int result;
+
+    vas_rtcheck_flag(VAS_RTCHECK_STDIO, VAS_RTCHECK_CALLER);
+    va_start(args, format);
+    result = vfprintf(file, format, args);
+    va_end(args);
+    return result;
+}
+
+/* what printf and fprintf become with _FORTIFY_SOURCE */
+int __wrap___printf_chk(int flag, const char *format, ...)
+{
+    va_list args;
+    int result;
+
+    vas_rtcheck_flag(VAS_RTCHECK_STDIO, VAS_RTCHECK_CALLER);
+    va_start(args, format);
+    result = __vprintf_chk(flag, format, args);
+    va_end(args);
+    return result;
+}
+
+int __wrap___fprintf_chk(FILE *file, int flag, const char *format, ...)
+{
+    va_list args;
+    int result;
+
+    vas_rtcheck_flag(VAS_RTCHECK_STDIO, VAS_RTCHECK_CALLER);
+    va_start(args, format);
+    result = __vfprintf_chk(file, flag, format, args);
+    va_end(args);
+    return result;
+}
+
+int __wrap_puts(const char *s)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_STDIO, VAS_RTCHECK_CALLER);
+    return __real_puts(s);
+}
+
+int __wrap_fputs(const char *s, FILE *file)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_STDIO, VAS_RTCHECK_CALLER);
+    return __real_fputs(s, file);
+}
+
+int __wrap_putchar(int c)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_STDIO, VAS_RTCHECK_CALLER);
+    return __real_putchar(c);
+}
+
+size_t __wrap_fwrite(const void *ptr, size_t size, size_t count, FILE *file)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_STDIO, VAS_RTCHECK_CALLER);
+    return __real_fwrite(ptr, size, count, file);
+}
+
+FILE *__wrap_fopen(const char *path, const char *mode)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_STDIO, VAS_RTCHECK_CALLER);
+    return __real_fopen(path, mode);
+}
+
+int __wrap_fclose(FILE *file)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_STDIO, VAS_RTCHECK_CALLER);
+    return __real_fclose(file);
+}
+
+int __wrap_fflush(FILE *file)
+{
+    vas_rtcheck_flag(VAS_RTCHECK_STDIO, VAS_RTCHECK_CALLER);
+    return __real_fflush(file);
+}
+
+#else
+
+long vas_rtcheck_count(int kind)
+{
+    (void)kind;
+    return 0;
+}
+
+long vas_rtcheck_report(void (*print)(const char *line))
+{
+    print("real-time safety is not checked, build with make RTCHECK=1");
+    return 0;
+}
+
+#endif
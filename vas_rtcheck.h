@@ -0,0 +1,73 @@
+/**
+ * @file vas_rtcheck.h
+ * @brief Debug build that flags calls which are not real-time safe <br>
+ * <br>
+ * Build with -DVAS_RTCHECK (make RTCHECK=1, GNU ld only) to link the object
+ * and the offline tools with --wrap for the allocator, mutexes, condition
+ * variables and stdio. VAS_RTCHECK_ENTER and VAS_RTCHECK_LEAVE bracket the
+ * perform routines; every wrapped call a thread makes in between is counted
+ * by kind, and the first one of each kind is queued to vas_log together with
+ * the address it was called from (gdb "info symbol" names the function).
+ * Calls outside the brackets, e.g. from message handlers, are not flagged.
+ * Without VAS_RTCHECK the macros expand to nothing.
+ * <br>
+ */
+
+#ifndef vas_rtcheck_h
+#define vas_rtcheck_h
+
+/* kinds of calls that are flagged */
+#define VAS_RTCHECK_ALLOC 0     /**< malloc, calloc, realloc, aligned allocations*/
+#define VAS_RTCHECK_FREE 1      /**< free*/
+#define VAS_RTCHECK_LOCK 2      /**< mutex locks, condition waits, joins*/
+#define VAS_RTCHECK_STDIO 3     /**< printing and file I/O*/
+#define VAS_RTCHECK_KINDS 4
+
+#ifdef VAS_RTCHECK
+
+#define VAS_RTCHECK_ENTER() vas_rtcheck_enter()
+#define VAS_RTCHECK_LEAVE() vas_rtcheck_leave()
+
+#else
+
+#define VAS_RTCHECK_ENTER() ((void)0)
+#define VAS_RTCHECK_LEAVE() ((void)0)
+
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef VAS_RTCHECK
+
+/**
+ * @brief Marks the calling thread as running the audio path, may nest <br>
+ */
+void vas_rtcheck_enter(void);
+
+/**
+ * @brief Ends the innermost vas_rtcheck_enter of the calling thread <br>
+ */
+void vas_rtcheck_leave(void);
+
+#endif
+
+/**
+ * @brief Returns the number of flagged calls of a kind, 0 without VAS_RTCHECK <br>
+ * @param kind VAS_RTCHECK_ALLOC ... VAS_RTCHECK_STDIO <br>
+ */
+long vas_rtcheck_count(int kind);
+
+/**
+ * @brief Writes the number of flagged calls of every kind <br>
+ * @param print called with each line, without newline <br>
+ * @return total number of flagged calls <br>
+ */
+long vas_rtcheck_report(void (*print)(const char *line));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* vas_rtcheck_h */
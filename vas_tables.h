@@ -0,0 +1,32 @@
+/**
+ * @file vas_tables.h
+ * @brief Default lookup tables, generated at build time <br>
+ * <br>
+ * vas_tables.c is written by vas_tables_gen (see Makefile) and holds the
+ * default sine of vas_osc and the default (q = 1) envelope curves of
+ * vas_adsr as read-only data. All instances share them, so creating an
+ * oscillator or ADSR with the default table size needs no maths at all.
+ * <br>
+ */
+
+#ifndef vas_tables_h
+#define vas_tables_h
+
+/** Size of the generated tables, the table size rtap_fmMultiOsc~ uses */
+#define VAS_TABLES_SIZE 44100
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** One period of a sine wave, as vas_osc_init computes it */
+extern const float vas_tables_sine[VAS_TABLES_SIZE];
+
+/** Attack, decay and release curve for q = 1 one after another, as vas_adsr_updateADSR computes them */
+extern const float vas_tables_adsr[3 * VAS_TABLES_SIZE];
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* vas_tables_h */
@@ -0,0 +1,43 @@
+/**
+ * @file vas_tables_gen.c
+ * @brief Writes vas_tables.c to stdout <br>
+ * <br>
+ * Run by the Makefile on the build machine. The formulas must stay in sync
+ * with vas_osc_init and vas_adsr_updateADSR, which compute the same tables
+ * for other table sizes and q factors. Values are printed as hex floats,
+ * so the generated tables are bit-exact. <br>
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include "vas_tables.h"
+
+static void gen_print(const char *name, const float *table, int size)
+{
+    printf("const float %s[%d] =\n{\n", name, size);
+    for(int i = 0; i < size; i++)
+        printf("    %aF,\n", table[i]);
+    printf("};\n\n");
+}
+
+int main(void)
+{
+    static float sine[VAS_TABLES_SIZE];
+    static float adsr[3 * VAS_TABLES_SIZE];
+    for(int i = 0; i < VAS_TABLES_SIZE; i++)
+        sine[i] = (float)sin(M_PI * 2 * i / VAS_TABLES_SIZE);
+
+    for(int i = 0; i < VAS_TABLES_SIZE; i++)
+    {
+        float x_val = (float)i / (float)VAS_TABLES_SIZE;
+        adsr[i] = powf(x_val, 1);
+        adsr[VAS_TABLES_SIZE + i] = 1.0F - powf(x_val, 1);
+        adsr[2 * VAS_TABLES_SIZE + i] = 1.0F - powf(x_val, 1);
+    }
+
+    printf("/* generated by vas_tables_gen, do not edit */\n\n");
+    printf("#include \"vas_tables.h\"\n\n");
+    gen_print("vas_tables_sine", sine, VAS_TABLES_SIZE);
+    gen_print("vas_tables_adsr", adsr, 3 * VAS_TABLES_SIZE);
+    return 0;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file vas_trace.c
+ * @brief Compile-time optional event tracing in Chrome trace format <br>
+ */
+#include "vas_trace.h"
+
+#ifdef VAS_TRACE
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+typedef struct vas_trace_record
+{
+    const char *name;
+    long long timestamp;    /* ns */
+    char phase;
+} vas_trace_record;
+
+typedef struct vas_trace_buffer
+{
+    atomic_ulong count;     /* events written so far, only changed by the owning thread */
+    vas_trace_record records[VAS_TRACE_EVENTS];
+} vas_trace_buffer;
+
+/* static, so the pages are only committed by threads that actually trace */
+static vas_trace_buffer vas_trace_buffers[VAS_TRACE_THREADS];
+static atomic_int vas_trace_threads;
+static _Thread_local vas_trace_buffer *vas_trace_local;
+static _Thread_local int vas_trace_full;
+
+static long long vas_trace_now(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (long long)((double)counter.QuadPart * 1e9 / frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+void vas_trace_event(const char *name, char phase)
+{
+    vas_trace_buffer *buffer = vas_trace_local;
+    unsigned long count;
+    vas_trace_record *record;
+
+    if(!buffer)
+    {
+        int index;
+        if(vas_trace_full)
+            return;
+        index = atomic_fetch_add(&vas_trace_threads, 1);
+        if(index >= VAS_TRACE_THREADS)
+        {
+            vas_trace_full = 1;
+            return;
+        }
+        buffer = vas_trace_local = &vas_trace_buffers[index];
+    }
+
+    count = atomic_load_explicit(&buffer->count, memory_order_relaxed);
+    record = &buffer->records[count % VAS_TRACE_EVENTS];
+    record->name = name;
+    record->timestamp = vas_trace_now();
+    record->phase = phase;
+    atomic_store_explicit(&buffer->count, count + 1, memory_order_release);
+}
+
+long vas_trace_dump(const char *path)
+{
+    FILE *file = fopen(path, "w");
+    int threads = atomic_load(&vas_trace_threads);
+    long written = 0;
+
+    if(!file)
+        return -1;
+    if(threads > VAS_TRACE_THREADS)
+        threads = VAS_TRACE_THREADS;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for(int t = 0; t < threads; t++)
+    {
+        vas_trace_buffer *buffer = &vas_trace_buffers[t];
+        unsigned long count = atomic_load_explicit(&buffer->count, memory_order_acquire);
+        unsigned long first = count > VAS_TRACE_EVENTS ? count - VAS_TRACE_EVENTS : 0;
+
+        /* the owner keeps writing, so skip a margin of events that may be overwritten meanwhile */
+        if(count > VAS_TRACE_EVENTS)
+            first += VAS_TRACE_EVENTS / 16;
+
+        for(unsigned long i = first; i < count; i++)
+        {
+            vas_trace_record *record = &buffer->records[i % VAS_TRACE_EVENTS];
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+                written ? ",\n" : "", record->name, record->phase, record->timestamp / 1000.0, t + 1);
+            written++;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return written;
+}
+
+#else
+
+long vas_trace_dump(const char *path)
+{
+    (void)path;
+    return -1;
+}
+
+#endif
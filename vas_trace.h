@@ -0,0 +1,60 @@
+/**
+ * @file vas_trace.h
+ * @brief Compile-time optional event tracing in Chrome trace format <br>
+ * <br>
+ * Build with -DVAS_TRACE (make TRACE=1) to record begin and end events of
+ * the DSP routines and message handlers. Every thread writes into its own
+ * preallocated buffer without locks, vas_trace_dump writes all buffers as
+ * JSON that chrome://tracing and Perfetto can open. Without VAS_TRACE the
+ * macros expand to nothing.
+ * <br>
+ */
+
+#ifndef vas_trace_h
+#define vas_trace_h
+
+/** Number of threads that can record events */
+#define VAS_TRACE_THREADS 16
+/** Events per thread, older events are overwritten */
+#define VAS_TRACE_EVENTS 65536
+
+#ifdef VAS_TRACE
+
+#define VAS_TRACE_BEGIN(name) vas_trace_event(name, 'B')
+#define VAS_TRACE_END(name) vas_trace_event(name, 'E')
+
+#else
+
+#define VAS_TRACE_BEGIN(name) ((void)0)
+#define VAS_TRACE_END(name) ((void)0)
+
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifdef VAS_TRACE
+
+/**
+ * @brief Records one event in the buffer of the calling thread <br>
+ * @param name a string literal, only the pointer is stored <br>
+ * @param phase 'B' for begin, 'E' for end <br>
+ */
+void vas_trace_event(const char *name, char phase);
+
+#endif
+
+/**
+ * @brief Writes the recorded events of all threads to a JSON file <br>
+ * @param path file name <br>
+ * @return number of events written, -1 if the file could not be created
+ * or tracing was not compiled in <br>
+ */
+long vas_trace_dump(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* vas_trace_h */
@@ -0,0 +1,607 @@
+/**
+ * @file vas_util.c
+ * @author Thomas Resch <br>
+ * Audiocommunication Group, Technische Universität Berlin <br>
+ * @brief Scalar, SSE2, AVX2 and NEON vector kernels with runtime dispatch <br>
+ */
+
+#include "vas_util.h"
+#include <string.h>
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VAS_UTIL_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define VAS_UTIL_ARM
+#include <arm_neon.h>
+#endif
+
+typedef struct vas_util_kernels
+{
+    void (*fadd)(const float *in1, const float *in2, float *dest, int length);
+    void (*fmultiply)(const float *in1, const float *in2, float *dest, int length);
+    void (*fscale)(const float *in, float scale, float *dest, int length);
+    void (*fmultiplyAccumulate)(const float *in1, const float *in2, float *dest, int length);
+    void (*fmix)(const float *in1, const float *in2, float mix, float *dest, int length);
+    void (*fclip)(const float *in, float min, float max, float *dest, int length);
+    void (*ffill)(float *dest, float value, int length);
+    void (*fcopy)(const float *in, float *dest, int length);
+    void (*fsine)(const float *phase, float *dest, int length);
+} vas_util_kernels;
+
+/*
+ * sin(2 pi x) for x in [-0.25, 0.25] as odd polynomial of degree 9,
+ * coefficients fitted for minimal maximum error (5e-8, about 1e-7 in float).
+ * The phase is reduced to [-0.5, 0.5] and folded into [-0.25, 0.25]
+ * with sin(2 pi x) = sin(2 pi (0.5 - x)).
+ */
+#define VAS_UTIL_SIN_C1 6.28318501F
+#define VAS_UTIL_SIN_C3 -41.3416557F
+#define VAS_UTIL_SIN_C5 81.6010056F
+#define VAS_UTIL_SIN_C7 -76.5498047F
+#define VAS_UTIL_SIN_C9 39.5368423F
+
+/* ---------------------------------------------------------------- scalar */
+
+static void vas_util_fadd_scalar(const float *in1, const float *in2, float *dest, int length)
+{
+    for(int i = 0; i < length; i++)
+        dest[i] = in1[i] + in2[i];
+}
+
+static void vas_util_fmultiply_scalar(const float *in1, const float *in2, float *dest, int length)
+{
+    for(int i = 0; i < length; i++)
+        dest[i] = in1[i] * in2[i];
+}
+
+static void vas_util_fscale_scalar(const float *in, float scale, float *dest, int length)
+{
+    for(int i = 0; i < length; i++)
+        dest[i] = in[i] * scale;
+}
+
+static void vas_util_fmultiplyAccumulate_scalar(const float *in1, const float *in2, float *dest, int length)
+{
+    for(int i = 0; i < length; i++)
+        dest[i] += in1[i] * in2[i];
+}
+
+static void vas_util_fmix_scalar(const float *in1, const float *in2, float mix, float *dest, int length)
+{
+    float dry = 1 - mix;
+    for(int i = 0; i < length; i++)
+        dest[i] = dry * in1[i] + mix * in2[i];
+}
+
+static void vas_util_fclip_scalar(const float *in, float min, float max, float *dest, int length)
+{
+    for(int i = 0; i < length; i++)
+    {
+        float value = in[i];
+        if(value < min) value = min;
+        if(value > max) value = max;
+        dest[i] = value;
+    }
+}
+
+static void vas_util_ffill_scalar(float *dest, float value, int length)
+{
+    for(int i = 0; i < length; i++)
+        dest[i] = value;
+}
+
+static void vas_util_fcopy_scalar(const float *in, float *dest, int length)
+{
+    if(in != dest)
+        memmove(dest, in, length * sizeof(float));
+}
+
+static void vas_util_fsine_scalar(const float *phase, float *dest, int length)
+{
+    for(int i = 0; i < length; i++)
+    {
+        float x = phase[i] - floorf(phase[i] + 0.5F);
+        float a = fabsf(x);
+        float y = copysignf(0.25F - fabsf(a - 0.25F), x);
+        float y2 = y * y;
+        dest[i] = y * (VAS_UTIL_SIN_C1 + y2 * (VAS_UTIL_SIN_C3 + y2 * (VAS_UTIL_SIN_C5 + y2 * (VAS_UTIL_SIN_C7 + y2 * VAS_UTIL_SIN_C9))));
+    }
+}
+
+static const vas_util_kernels vas_util_kernels_scalar =
+{
+    vas_util_fadd_scalar,
+    vas_util_fmultiply_scalar,
+    vas_util_fscale_scalar,
+    vas_util_fmultiplyAccumulate_scalar,
+    vas_util_fmix_scalar,
+    vas_util_fclip_scalar,
+    vas_util_ffill_scalar,
+    vas_util_fcopy_scalar,
+    vas_util_fsine_scalar
+};
+
+/* ---------------------------------------------------------------- SSE2 / AVX2 */
+
+#ifdef VAS_UTIL_X86
+
+#define VAS_UTIL_SSE2_TARGET __attribute__((target("sse2")))
+#define VAS_UTIL_AVX2_TARGET __attribute__((target("avx2")))
+
+VAS_UTIL_SSE2_TARGET static void vas_util_fadd_sse2(const float *in1, const float *in2, float *dest, int length)
+{
+    int i = 0;
+    for(; i + 4 <= length; i += 4)
+        _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(in1 + i), _mm_loadu_ps(in2 + i)));
+    vas_util_fadd_scalar(in1 + i, in2 + i, dest + i, length - i);
+}
+
+VAS_UTIL_SSE2_TARGET static void vas_util_fmultiply_sse2(const float *in1, const float *in2, float *dest, int length)
+{
+    int i = 0;
+    for(; i + 4 <= length; i += 4)
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_loadu_ps(in1 + i), _mm_loadu_ps(in2 + i)));
+    vas_util_fmultiply_scalar(in1 + i, in2 + i, dest + i, length - i);
+}
+
+VAS_UTIL_SSE2_TARGET static void vas_util_fscale_sse2(const float *in, float scale, float *dest, int length)
+{
+    int i = 0;
+    __m128 s = _mm_set1_ps(scale);
+    for(; i + 4 <= length; i += 4)
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_loadu_ps(in + i), s));
+    vas_util_fscale_scalar(in + i, scale, dest + i, length - i);
+}
+
+VAS_UTIL_SSE2_TARGET static void vas_util_fmultiplyAccumulate_sse2(const float *in1, const float *in2, float *dest, int length)
+{
+    int i = 0;
+    for(; i + 4 <= length; i += 4)
+    {
+        __m128 product = _mm_mul_ps(_mm_loadu_ps(in1 + i), _mm_loadu_ps(in2 + i));
+        _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), product));
+    }
+    vas_util_fmultiplyAccumulate_scalar(in1 + i, in2 + i, dest + i, length - i);
+}
+
+VAS_UTIL_SSE2_TARGET static void vas_util_fmix_sse2(const float *in1, const float *in2, float mix, float *dest, int length)
+{
+    int i = 0;
+    __m128 wet = _mm_set1_ps(mix);
+    __m128 dry = _mm_set1_ps(1 - mix);
+    for(; i + 4 <= length; i += 4)
+    {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(in1 + i), dry);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(in2 + i), wet);
+        _mm_storeu_ps(dest + i, _mm_add_ps(a, b));
+    }
+    vas_util_fmix_scalar(in1 + i, in2 + i, mix, dest + i, length - i);
+}
+
+VAS_UTIL_SSE2_TARGET static void vas_util_fclip_sse2(const float *in, float min, float max, float *dest, int length)
+{
+    int i = 0;
+    __m128 lo = _mm_set1_ps(min);
+    __m128 hi = _mm_set1_ps(max);
+    for(; i + 4 <= length; i += 4)
+        _mm_storeu_ps(dest + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lo), hi));
+    vas_util_fclip_scalar(in + i, min, max, dest + i, length - i);
+}
+
+VAS_UTIL_SSE2_TARGET static void vas_util_ffill_sse2(float *dest, float value, int length)
+{
+    int i = 0;
+    __m128 v = _mm_set1_ps(value);
+    for(; i + 4 <= length; i += 4)
+        _mm_storeu_ps(dest + i, v);
+    vas_util_ffill_scalar(dest + i, value, length - i);
+}
+
+VAS_UTIL_SSE2_TARGET static void vas_util_fcopy_sse2(const float *in, float *dest, int length)
+{
+    int i = 0;
+    if(in == dest)
+        return;
+    if(dest > in && dest < in + length)
+    {
+        vas_util_fcopy_scalar(in, dest, length);
+        return;
+    }
+    for(; i + 4 <= length; i += 4)
+        _mm_storeu_ps(dest + i, _mm_loadu_ps(in + i));
+    for(; i < length; i++)
+        dest[i] = in[i];
+}
+
+VAS_UTIL_SSE2_TARGET static void vas_util_fsine_sse2(const float *phase, float *dest, int length)
+{
+    int i = 0;
+    __m128 signMask = _mm_set1_ps(-0.0F);
+    __m128 quarter = _mm_set1_ps(0.25F);
+    for(; i + 4 <= length; i += 4)
+    {
+        __m128 p = _mm_loadu_ps(phase + i);
+        /* cvtps2dq rounds to nearest, so x lies in [-0.5, 0.5] */
+        __m128 x = _mm_sub_ps(p, _mm_cvtepi32_ps(_mm_cvtps_epi32(p)));
+        __m128 sign = _mm_and_ps(x, signMask);
+        __m128 a = _mm_andnot_ps(signMask, _mm_sub_ps(_mm_andnot_ps(signMask, x), quarter));
+        __m128 y = _mm_or_ps(_mm_sub_ps(quarter, a), sign);
+        __m128 y2 = _mm_mul_ps(y, y);
+        __m128 r = _mm_add_ps(_mm_set1_ps(VAS_UTIL_SIN_C7), _mm_mul_ps(y2, _mm_set1_ps(VAS_UTIL_SIN_C9)));
+        r = _mm_add_ps(_mm_set1_ps(VAS_UTIL_SIN_C5), _mm_mul_ps(y2, r));
+        r = _mm_add_ps(_mm_set1_ps(VAS_UTIL_SIN_C3), _mm_mul_ps(y2, r));
+        r = _mm_add_ps(_mm_set1_ps(VAS_UTIL_SIN_C1), _mm_mul_ps(y2, r));
+        _mm_storeu_ps(dest + i, _mm_mul_ps(y, r));
+    }
+    vas_util_fsine_scalar(phase + i, dest + i, length - i);
+}
+
+static const vas_util_kernels vas_util_kernels_sse2 =
+{
+    vas_util_fadd_sse2,
+    vas_util_fmultiply_sse2,
+    vas_util_fscale_sse2,
+    vas_util_fmultiplyAccumulate_sse2,
+    vas_util_fmix_sse2,
+    vas_util_fclip_sse2,
+    vas_util_ffill_sse2,
+    vas_util_fcopy_sse2,
+    vas_util_fsine_sse2
+};
+
+VAS_UTIL_AVX2_TARGET static void vas_util_fadd_avx2(const float *in1, const float *in2, float *dest, int length)
+{
+    int i = 0;
+    for(; i + 8 <= length; i += 8)
+        _mm256_storeu_ps(dest + i, _mm256_add_ps(_mm256_loadu_ps(in1 + i), _mm256_loadu_ps(in2 + i)));
+    vas_util_fadd_scalar(in1 + i, in2 + i, dest + i, length - i);
+}
+
+VAS_UTIL_AVX2_TARGET static void vas_util_fmultiply_avx2(const float *in1, const float *in2, float *dest, int length)
+{
+    int i = 0;
+    for(; i + 8 <= length; i += 8)
+        _mm256_storeu_ps(dest + i, _mm256_mul_ps(_mm256_loadu_ps(in1 + i), _mm256_loadu_ps(in2 + i)));
+    vas_util_fmultiply_scalar(in1 + i, in2 + i, dest + i, length - i);
+}
+
+VAS_UTIL_AVX2_TARGET static void vas_util_fscale_avx2(const float *in, float scale, float *dest, int length)
+{
+    int i = 0;
+    __m256 s = _mm256_set1_ps(scale);
+    for(; i + 8 <= length; i += 8)
+        _mm256_storeu_ps(dest + i, _mm256_mul_ps(_mm256_loadu_ps(in + i), s));
+    vas_util_fscale_scalar(in + i, scale, dest + i, length - i);
+}
+
+VAS_UTIL_AVX2_TARGET static void vas_util_fmultiplyAccumulate_avx2(const float *in1, const float *in2, float *dest, int length)
+{
+    int i = 0;
+    for(; i + 8 <= length; i += 8)
+    {
+        __m256 product = _mm256_mul_ps(_mm256_loadu_ps(in1 + i), _mm256_loadu_ps(in2 + i));
+        _mm256_storeu_ps(dest + i, _mm256_add_ps(_mm256_loadu_ps(dest + i), product));
+    }
+    vas_util_fmultiplyAccumulate_scalar(in1 + i, in2 + i, dest + i, length - i);
+}
+
+VAS_UTIL_AVX2_TARGET static void vas_util_fmix_avx2(const float *in1, const float *in2, float mix, float *dest, int length)
+{
+    int i = 0;
+    __m256 wet = _mm256_set1_ps(mix);
+    __m256 dry = _mm256_set1_ps(1 - mix);
+    for(; i + 8 <= length; i += 8)
+    {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(in1 + i), dry);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(in2 + i), wet);
+        _mm256_storeu_ps(dest + i, _mm256_add_ps(a, b));
+    }
+    vas_util_fmix_scalar(in1 + i, in2 + i, mix, dest + i, length - i);
+}
+
+VAS_UTIL_AVX2_TARGET static void vas_util_fclip_avx2(const float *in, float min, float max, float *dest, int length)
+{
+    int i = 0;
+    __m256 lo = _mm256_set1_ps(min);
+    __m256 hi = _mm256_set1_ps(max);
+    for(; i + 8 <= length; i += 8)
+        _mm256_storeu_ps(dest + i, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i), lo), hi));
+    vas_util_fclip_scalar(in + i, min, max, dest + i, length - i);
+}
+
+VAS_UTIL_AVX2_TARGET static void vas_util_ffill_avx2(float *dest, float value, int length)
+{
+    int i = 0;
+    __m256 v = _mm256_set1_ps(value);
+    for(; i + 8 <= length; i += 8)
+        _mm256_storeu_ps(dest + i, v);
+    vas_util_ffill_scalar(dest + i, value, length - i);
+}
+
+VAS_UTIL_AVX2_TARGET static void vas_util_fcopy_avx2(const float *in, float *dest, int length)
+{
+    int i = 0;
+    if(in == dest)
+        return;
+    if(dest > in && dest < in + length)
+    {
+        vas_util_fcopy_scalar(in, dest, length);
+        return;
+    }
+    for(; i + 8 <= length; i += 8)
+        _mm256_storeu_ps(dest + i, _mm256_loadu_ps(in + i));
+    for(; i < length; i++)
+        dest[i] = in[i];
+}
+
+VAS_UTIL_AVX2_TARGET static void vas_util_fsine_avx2(const float *phase, float *dest, int length)
+{
+    int i = 0;
+    __m256 signMask = _mm256_set1_ps(-0.0F);
+    __m256 quarter = _mm256_set1_ps(0.25F);
+    for(; i + 8 <= length; i += 8)
+    {
+        __m256 p = _mm256_loadu_ps(phase + i);
+        __m256 x = _mm256_sub_ps(p, _mm256_round_ps(p, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        __m256 sign = _mm256_and_ps(x, signMask);
+        __m256 a = _mm256_andnot_ps(signMask, _mm256_sub_ps(_mm256_andnot_ps(signMask, x), quarter));
+        __m256 y = _mm256_or_ps(_mm256_sub_ps(quarter, a), sign);
+        __m256 y2 = _mm256_mul_ps(y, y);
+        __m256 r = _mm256_add_ps(_mm256_set1_ps(VAS_UTIL_SIN_C7), _mm256_mul_ps(y2, _mm256_set1_ps(VAS_UTIL_SIN_C9)));
+        r = _mm256_add_ps(_mm256_set1_ps(VAS_UTIL_SIN_C5), _mm256_mul_ps(y2, r));
+        r = _mm256_add_ps(_mm256_set1_ps(VAS_UTIL_SIN_C3), _mm256_mul_ps(y2, r));
+        r = _mm256_add_ps(_mm256_set1_ps(VAS_UTIL_SIN_C1), _mm256_mul_ps(y2, r));
+        _mm256_storeu_ps(dest + i, _mm256_mul_ps(y, r));
+    }
+    vas_util_fsine_scalar(phase + i, dest + i, length - i);
+}
+
+static const vas_util_kernels vas_util_kernels_avx2 =
+{
+    vas_util_fadd_avx2,
+    vas_util_fmultiply_avx2,
+    vas_util_fscale_avx2,
+    vas_util_fmultiplyAccumulate_avx2,
+    vas_util_fmix_avx2,
+    vas_util_fclip_avx2,
+    vas_util_ffill_avx2,
+    vas_util_fcopy_avx2,
+    vas_util_fsine_avx2
+};
+
+#endif /* VAS_UTIL_X86 */
+
+/* ---------------------------------------------------------------- NEON */
+
+#ifdef VAS_UTIL_ARM
+
+static void vas_util_fadd_neon(const float *in1, const float *in2, float *dest, int length)
+{
+    int i = 0;
+    for(; i + 4 <= length; i += 4)
+        vst1q_f32(dest + i, vaddq_f32(vld1q_f32(in1 + i), vld1q_f32(in2 + i)));
+    vas_util_fadd_scalar(in1 + i, in2 + i, dest + i, length - i);
+}
+
+static void vas_util_fmultiply_neon(const float *in1, const float *in2, float *dest, int length)
+{
+    int i = 0;
+    for(; i + 4 <= length; i += 4)
+        vst1q_f32(dest + i, vmulq_f32(vld1q_f32(in1 + i), vld1q_f32(in2 + i)));
+    vas_util_fmultiply_scalar(in1 + i, in2 + i, dest + i, length - i);
+}
+
+static void vas_util_fscale_neon(const float *in, float scale, float *dest, int length)
+{
+    int i = 0;
+    for(; i + 4 <= length; i += 4)
+        vst1q_f32(dest + i, vmulq_n_f32(vld1q_f32(in + i), scale));
+    vas_util_fscale_scalar(in + i, scale, dest + i, length - i);
+}
+
+static void vas_util_fmultiplyAccumulate_neon(const float *in1, const float *in2, float *dest, int length)
+{
+    int i = 0;
+    for(; i + 4 <= length; i += 4)
+        vst1q_f32(dest + i, vmlaq_f32(vld1q_f32(dest + i), vld1q_f32(in1 + i), vld1q_f32(in2 + i)));
+    vas_util_fmultiplyAccumulate_scalar(in1 + i, in2 + i, dest + i, length - i);
+}
+
+static void vas_util_fmix_neon(const float *in1, const float *in2, float mix, float *dest, int length)
+{
+    int i = 0;
+    float dry = 1 - mix;
+    for(; i + 4 <= length; i += 4)
+        vst1q_f32(dest + i, vmlaq_n_f32(vmulq_n_f32(vld1q_f32(in1 + i), dry), vld1q_f32(in2 + i), mix));
+    vas_util_fmix_scalar(in1 + i, in2 + i, mix, dest + i, length - i);
+}
+
+static void vas_util_fclip_neon(const float *in, float min, float max, float *dest, int length)
+{
+    int i = 0;
+    float32x4_t lo = vdupq_n_f32(min);
+    float32x4_t hi = vdupq_n_f32(max);
+    for(; i + 4 <= length; i += 4)
+        vst1q_f32(dest + i, vminq_f32(vmaxq_f32(vld1q_f32(in + i), lo), hi));
+    vas_util_fclip_scalar(in + i, min, max, dest + i, length - i);
+}
+
+static void vas_util_ffill_neon(float *dest, float value, int length)
+{
+    int i = 0;
+    float32x4_t v = vdupq_n_f32(value);
+    for(; i + 4 <= length; i += 4)
+        vst1q_f32(dest + i, v);
+    vas_util_ffill_scalar(dest + i, value, length - i);
+}
+
+static void vas_util_fcopy_neon(const float *in, float *dest, int length)
+{
+    int i = 0;
+    if(in == dest)
+        return;
+    if(dest > in && dest < in + length)
+    {
+        vas_util_fcopy_scalar(in, dest, length);
+        return;
+    }
+    for(; i + 4 <= length; i += 4)
+        vst1q_f32(dest + i, vld1q_f32(in + i));
+    for(; i < length; i++)
+        dest[i] = in[i];
+}
+
+static void vas_util_fsine_neon(const float *phase, float *dest, int length)
+{
+    int i = 0;
+    uint32x4_t signMask = vdupq_n_u32(0x80000000);
+    float32x4_t quarter = vdupq_n_f32(0.25F);
+    for(; i + 4 <= length; i += 4)
+    {
+        float32x4_t p = vld1q_f32(phase + i);
+        /* round half away from zero: truncate p + copysign(0.5, p) */
+        float32x4_t half = vbslq_f32(signMask, p, vdupq_n_f32(0.5F));
+        float32x4_t x = vsubq_f32(p, vcvtq_f32_s32(vcvtq_s32_f32(vaddq_f32(p, half))));
+        float32x4_t a = vabsq_f32(vsubq_f32(vabsq_f32(x), quarter));
+        float32x4_t y = vbslq_f32(signMask, x, vsubq_f32(quarter, a));
+        float32x4_t y2 = vmulq_f32(y, y);
+        float32x4_t r = vmlaq_n_f32(vdupq_n_f32(VAS_UTIL_SIN_C7), y2, VAS_UTIL_SIN_C9);
+        r = vmlaq_f32(vdupq_n_f32(VAS_UTIL_SIN_C5), y2, r);
+        r = vmlaq_f32(vdupq_n_f32(VAS_UTIL_SIN_C3), y2, r);
+        r = vmlaq_f32(vdupq_n_f32(VAS_UTIL_SIN_C1), y2, r);
+        vst1q_f32(dest + i, vmulq_f32(y, r));
+    }
+    vas_util_fsine_scalar(phase + i, dest + i, length - i);
+}
+
+static const vas_util_kernels vas_util_kernels_neon =
+{
+    vas_util_fadd_neon,
+    vas_util_fmultiply_neon,
+    vas_util_fscale_neon,
+    vas_util_fmultiplyAccumulate_neon,
+    vas_util_fmix_neon,
+    vas_util_fclip_neon,
+    vas_util_ffill_neon,
+    vas_util_fcopy_neon,
+    vas_util_fsine_neon
+};
+
+#endif /* VAS_UTIL_ARM */
+
+/* ---------------------------------------------------------------- dispatch */
+
+static const vas_util_kernels *vas_util_current = &vas_util_kernels_scalar;
+static int vas_util_currentSet = VAS_UTIL_SCALAR;
+
+int vas_util_selectKernels(int kernels)
+{
+    switch(kernels)
+    {
+        case VAS_UTIL_SCALAR:
+            vas_util_current = &vas_util_kernels_scalar;
+            break;
+#ifdef VAS_UTIL_X86
+        case VAS_UTIL_SSE2:
+            if(!__builtin_cpu_supports("sse2"))
+                return 0;
+            vas_util_current = &vas_util_kernels_sse2;
+            break;
+        case VAS_UTIL_AVX2:
+            if(!__builtin_cpu_supports("avx2"))
+                return 0;
+            vas_util_current = &vas_util_kernels_avx2;
+            break;
+#endif
+#ifdef VAS_UTIL_ARM
+        case VAS_UTIL_NEON:
+            vas_util_current = &vas_util_kernels_neon;
+            break;
+#endif
+        default:
+            return 0;
+    }
+    vas_util_currentSet = kernels;
+    return 1;
+}
+
+int vas_util_getKernels(void)
+{
+    return vas_util_currentSet;
+}
+
+int vas_util_init(void)
+{
+#ifdef VAS_UTIL_X86
+    __builtin_cpu_init();
+#endif
+    if(vas_util_selectKernels(VAS_UTIL_AVX2))
+        return VAS_UTIL_AVX2;
+    if(vas_util_selectKernels(VAS_UTIL_SSE2))
+        return VAS_UTIL_SSE2;
+    if(vas_util_selectKernels(VAS_UTIL_NEON))
+        return VAS_UTIL_NEON;
+    vas_util_selectKernels(VAS_UTIL_SCALAR);
+    return VAS_UTIL_SCALAR;
+}
+
+const char *vas_util_kernelName(int kernels)
+{
+    switch(kernels)
+    {
+        case VAS_UTIL_SCALAR: return "scalar";
+        case VAS_UTIL_SSE2: return "sse2";
+        case VAS_UTIL_AVX2: return "avx2";
+        case VAS_UTIL_NEON: return "neon";
+        default: return "unknown";
+    }
+}
+
+void vas_util_fadd(const float *in1, const float *in2, float *dest, int length)
+{
+    vas_util_current->fadd(in1, in2, dest, length);
+}
+
+void vas_util_fmultiply(const float *in1, const float *in2, float *dest, int length)
+{
+    vas_util_current->fmultiply(in1, in2, dest, length);
+}
+
+void vas_util_fscale(const float *in, float scale, float *dest, int length)
+{
+    vas_util_current->fscale(in, scale, dest, length);
+}
+
+void vas_util_fmultiplyAccumulate(const float *in1, const float *in2, float *dest, int length)
+{
+    vas_util_current->fmultiplyAccumulate(in1, in2, dest, length);
+}
+
+void vas_util_fmix(const float *in1, const float *in2, float mix, float *dest, int length)
+{
+    vas_util_current->fmix(in1, in2, mix, dest, length);
+}
+
+void vas_util_fclip(const float *in, float min, float max, float *dest, int length)
+{
+    vas_util_current->fclip(in, min, max, dest, length);
+}
+
+void vas_util_ffill(float *dest, float value, int length)
+{
+    vas_util_current->ffill(dest, value, length);
+}
+
+void vas_util_fcopy(const float *in, float *dest, int length)
+{
+    vas_util_current->fcopy(in, dest, length);
+}
+
+void vas_util_fsine(const float *phase, float *dest, int length)
+{
+    vas_util_current->fsine(phase, dest, length);
+}
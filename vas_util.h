@@ -5,7 +5,12 @@
  * University of Applied Sciences Nordwestschweiz (FHNW), Music-Academy, Research and Development <br>
  * @brief Utilty functions and all #defines for the VAS library <br>
  * <br>
- * All kinds of utility functions, mostly vector math
+ * All kinds of utility functions, mostly vector math <br>
+ * <br>
+ * Every vector function exists as scalar, SSE2, AVX2 and NEON kernel.
+ * vas_util_init() picks the best kernel set the running CPU supports,
+ * until then the scalar kernels are used. All kernels accept unaligned
+ * buffers of any length, and dest may be identical to any of the inputs.
  */
 
 #ifndef vas_util_h
@@ -15,4 +20,72 @@ typedef float VAS_INPUTBUFFER;
 
 typedef float VAS_OUTPUTBUFFER;
 
+/** Size of the stack scratch buffers used by the block processing routines */
+#define VAS_UTIL_CHUNK 64
+
+#define VAS_UTIL_SCALAR 0
+#define VAS_UTIL_SSE2 1
+#define VAS_UTIL_AVX2 2
+#define VAS_UTIL_NEON 3
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Selects the fastest kernel set supported by the CPU <br>
+ * @return the selected kernel set (VAS_UTIL_SCALAR, ...) <br>
+ */
+int vas_util_init(void);
+
+/**
+ * @brief Forces a kernel set, used by the benchmark <br>
+ * @param kernels VAS_UTIL_SCALAR, VAS_UTIL_SSE2, VAS_UTIL_AVX2 or VAS_UTIL_NEON <br>
+ * @return 1 if the kernel set is available on this CPU and was selected, 0 otherwise <br>
+ */
+int vas_util_selectKernels(int kernels);
+
+/**
+ * @brief Returns the kernel set in use <br>
+ * Modules with vector code of their own follow this choice. <br>
+ * @return VAS_UTIL_SCALAR, VAS_UTIL_SSE2, VAS_UTIL_AVX2 or VAS_UTIL_NEON <br>
+ */
+int vas_util_getKernels(void);
+
+/**
+ * @brief Name of a kernel set for reports <br>
+ */
+const char *vas_util_kernelName(int kernels);
+
+/** dest[i] = in1[i] + in2[i] */
+void vas_util_fadd(const float *in1, const float *in2, float *dest, int length);
+
+/** dest[i] = in1[i] * in2[i] */
+void vas_util_fmultiply(const float *in1, const float *in2, float *dest, int length);
+
+/** dest[i] = in[i] * scale */
+void vas_util_fscale(const float *in, float scale, float *dest, int length);
+
+/** dest[i] += in1[i] * in2[i] */
+void vas_util_fmultiplyAccumulate(const float *in1, const float *in2, float *dest, int length);
+
+/** dest[i] = (1 - mix) * in1[i] + mix * in2[i] */
+void vas_util_fmix(const float *in1, const float *in2, float mix, float *dest, int length);
+
+/** dest[i] = in[i] limited to [min, max] */
+void vas_util_fclip(const float *in, float min, float max, float *dest, int length);
+
+/** dest[i] = value */
+void vas_util_ffill(float *dest, float value, int length);
+
+/** dest[i] = in[i] */
+void vas_util_fcopy(const float *in, float *dest, int length);
+
+/** dest[i] = sin(2 pi phase[i]), phase in periods, polynomial approximation with max error about 1e-7 */
+void vas_util_fsine(const float *phase, float *dest, int length);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,169 @@
+/**
+ * @file vas_wav.c
+ * @brief Minimal WAV file reading and writing <br>
+ */
+#include "vas_wav.h"
+
+#define VAS_WAV_HEADERSIZE 44
+#define VAS_WAV_FORMAT_PCM 1
+#define VAS_WAV_FORMAT_FLOAT 3
+
+static void vas_wav_put16(unsigned char *p, int value)
+{
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+}
+
+static void vas_wav_put32(unsigned char *p, long value)
+{
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+    p[2] = (value >> 16) & 0xff;
+    p[3] = (value >> 24) & 0xff;
+}
+
+static int vas_wav_get16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static long vas_wav_get32(const unsigned char *p)
+{
+    return (long)p[0] | ((long)p[1] << 8) | ((long)p[2] << 16) | ((long)p[3] << 24);
+}
+
+static void vas_wav_writeHeader(vas_wav *x)
+{
+    unsigned char header[VAS_WAV_HEADERSIZE];
+    long dataBytes = x->frames * x->channels * (long)sizeof(float);
+
+    memcpy(header, "RIFF", 4);
+    vas_wav_put32(header + 4, 36 + dataBytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    vas_wav_put32(header + 16, 16);
+    vas_wav_put16(header + 20, VAS_WAV_FORMAT_FLOAT);
+    vas_wav_put16(header + 22, x->channels);
+    vas_wav_put32(header + 24, x->sampleRate);
+    vas_wav_put32(header + 28, (long)x->sampleRate * x->channels * sizeof(float));
+    vas_wav_put16(header + 32, x->channels * sizeof(float));
+    vas_wav_put16(header + 34, 32);
+    memcpy(header + 36, "data", 4);
+    vas_wav_put32(header + 40, dataBytes);
+
+    fseek(x->file, 0, SEEK_SET);
+    fwrite(header, 1, VAS_WAV_HEADERSIZE, x->file);
+}
+
+vas_wav *vas_wav_open(const char *path, int sampleRate, int channels)
+{
+    FILE *file = fopen(path, "wb");
+    vas_wav *x;
+
+    if(!file)
+        return NULL;
+
+    x = (vas_wav *) vas_mem_alloc(sizeof(vas_wav));
+    x->file = file;
+    x->channels = channels;
+    x->sampleRate = sampleRate;
+    x->frames = 0;
+    vas_wav_writeHeader(x);
+    return x;
+}
+
+long vas_wav_write(vas_wav *x, const float *samples, long frames)
+{
+    long written = (long)fwrite(samples, sizeof(float) * x->channels, frames, x->file);
+    x->frames += written;
+    return written;
+}
+
+void vas_wav_close(vas_wav *x)
+{
+    if(!x)
+        return;
+    vas_wav_writeHeader(x);
+    fclose(x->file);
+    vas_mem_free(x);
+}
+
+float *vas_wav_read(const char *path, int *length, int *sampleRate)
+{
+    FILE *file = fopen(path, "rb");
+    unsigned char chunk[8], fmt[16];
+    int format = 0, channels = 0, bits = 0, haveFormat = 0;
+    float *result = NULL;
+
+    *length = 0;
+    if(!file)
+        return NULL;
+
+    if(fread(chunk, 1, 8, file) != 8 || memcmp(chunk, "RIFF", 4)
+       || fread(chunk, 1, 4, file) != 4 || memcmp(chunk, "WAVE", 4))
+    {
+        fclose(file);
+        return NULL;
+    }
+
+    while(fread(chunk, 1, 8, file) == 8)
+    {
+        long size = vas_wav_get32(chunk + 4);
+
+        if(!memcmp(chunk, "fmt ", 4) && size >= 16)
+        {
+            if(fread(fmt, 1, 16, file) != 16)
+                break;
+            format = vas_wav_get16(fmt);
+            channels = vas_wav_get16(fmt + 2);
+            if(sampleRate)
+                *sampleRate = (int)vas_wav_get32(fmt + 4);
+            bits = vas_wav_get16(fmt + 14);
+            haveFormat = 1;
+            fseek(file, size - 16 + (size & 1), SEEK_CUR);
+        }
+        else if(!memcmp(chunk, "data", 4) && haveFormat && channels > 0)
+        {
+            int bytesPerSample = bits / 8;
+            long frames = size / (bytesPerSample * channels);
+            unsigned char *raw = (unsigned char *) vas_mem_allocAs(size, VAS_MEM_SCRATCH);
+
+            if((format != VAS_WAV_FORMAT_PCM || bits != 16) && (format != VAS_WAV_FORMAT_FLOAT || bits != 32))
+            {
+                vas_mem_free(raw);
+                break;
+            }
+            if((long)fread(raw, 1, size, file) != size)
+            {
+                vas_mem_free(raw);
+                break;
+            }
+
+            result = (float *) vas_mem_allocAs(frames * sizeof(float), VAS_MEM_SCRATCH);
+            for(long i = 0; i < frames; i++)
+            {
+                float sum = 0;
+                for(int c = 0; c < channels; c++)
+                {
+                    const unsigned char *p = raw + (i * channels + c) * bytesPerSample;
+                    if(format == VAS_WAV_FORMAT_FLOAT)
+                    {
+                        float value;
+                        memcpy(&value, p, sizeof(float));
+                        sum += value;
+                    }
+                    else
+                        sum += (short)vas_wav_get16(p) / 32768.0F;
+                }
+                result[i] = sum / channels;
+            }
+            *length = (int)frames;
+            vas_mem_free(raw);
+            break;
+        }
+        else
+            fseek(file, size + (size & 1), SEEK_CUR);
+    }
+
+    fclose(file);
+    return result;
+}
@@ -0,0 +1,73 @@
+/**
+ * @file vas_wav.h
+ * @brief Minimal WAV file reading and writing <br>
+ * <br>
+ * Writes 32 bit float WAV files and reads 16 bit PCM or 32 bit float
+ * WAV files, which is all the offline tools and the recorder need.
+ * Assumes a little endian host.
+ * <br>
+ */
+
+#ifndef vas_wav_h
+#define vas_wav_h
+
+#include <stdio.h>
+#include "vas_mem.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct vas_wav
+ * @brief A WAV file opened for writing. <br>
+ */
+typedef struct vas_wav
+{
+    FILE *file;             /**< the open file*/
+    int channels;           /**< number of interleaved channels*/
+    int sampleRate;         /**< sample rate written to the header*/
+    long frames;            /**< frames written so far*/
+} vas_wav;
+
+/**
+ * @related vas_wav
+ * @brief Creates a 32 bit float WAV file <br>
+ * @param path file name <br>
+ * @param sampleRate sample rate <br>
+ * @param channels number of channels <br>
+ * @return the writer or NULL if the file could not be created <br>
+ */
+vas_wav *vas_wav_open(const char *path, int sampleRate, int channels);
+
+/**
+ * @related vas_wav
+ * @brief Appends interleaved frames <br>
+ * @param x the writer <br>
+ * @param samples frames * channels floats <br>
+ * @param frames number of frames <br>
+ * @return number of frames written <br>
+ */
+long vas_wav_write(vas_wav *x, const float *samples, long frames);
+
+/**
+ * @related vas_wav
+ * @brief Patches the header sizes and closes the file <br>
+ * @param x the writer <br>
+ */
+void vas_wav_close(vas_wav *x);
+
+/**
+ * @brief Reads a WAV file and mixes it down to mono <br>
+ * @param path file name <br>
+ * @param length receives the number of samples <br>
+ * @param sampleRate receives the sample rate, may be NULL <br>
+ * @return the samples (free with vas_mem_free) or NULL on error <br>
+ */
+float *vas_wav_read(const char *path, int *length, int *sampleRate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* vas_wav_h */
@@ -0,0 +1,329 @@
+/**
+ * @file vas_wavetable.c
+ * @brief Read-only wavetable libraries mapped from disk <br>
+ */
+#include "vas_wavetable.h"
+#include "vas_mem.h"
+#include <stdio.h>
+#include <limits.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* all open libraries, shared by every instance in the process */
+static vas_wavetable *vas_wavetable_list;
+static pthread_mutex_t vas_wavetable_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void vas_wavetable_put32(unsigned char *p, long value)
+{
+    p[0] = value & 0xff;
+    p[1] = (value >> 8) & 0xff;
+    p[2] = (value >> 16) & 0xff;
+    p[3] = (value >> 24) & 0xff;
+}
+
+static long vas_wavetable_get32(const unsigned char *p)
+{
+    return (long)p[0] | ((long)p[1] << 8) | ((long)p[2] << 16) | ((long)p[3] << 24);
+}
+
+static long vas_wavetable_stride(int tableSize)
+{
+    return ((long)tableSize + 1 + 15) & ~15L;
+}
+
+/* maps the whole file read-only, returns NULL on error */
+static void *vas_wavetable_map(const char *path, size_t *size)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    HANDLE mapping;
+    LARGE_INTEGER fileSize;
+    void *map;
+
+    if(file == INVALID_HANDLE_VALUE)
+        return NULL;
+    if(!GetFileSizeEx(file, &fileSize) || !fileSize.QuadPart)
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if(!mapping)
+        return NULL;
+    /* the view keeps the mapping alive */
+    map = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    *size = (size_t)fileSize.QuadPart;
+    return map;
+#else
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    void *map;
+
+    if(fd < 0)
+        return NULL;
+    if(fstat(fd, &st) || !st.st_size)
+    {
+        close(fd);
+        return NULL;
+    }
+    /* the mapping stays valid after the descriptor is closed */
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+        return NULL;
+    *size = st.st_size;
+    return map;
+#endif
+}
+
+static void vas_wavetable_unmap(void *map, size_t size)
+{
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(map);
+#else
+    munmap(map, size);
+#endif
+}
+
+/* checks the header and fills in the layout, returns 0 if this is no library */
+static int vas_wavetable_parse(vas_wavetable *x)
+{
+    const unsigned char *header = (const unsigned char *)x->map;
+    size_t floats;
+
+    if(x->mapSize < VAS_WAVETABLE_HEADERSIZE || memcmp(header, VAS_WAVETABLE_MAGIC, 8))
+        return 0;
+
+    x->tableCount = (int)vas_wavetable_get32(header + 8);
+    x->tableSize = (int)vas_wavetable_get32(header + 12);
+    x->levelCount = (int)vas_wavetable_get32(header + 16);
+    x->stride = vas_wavetable_get32(header + 20);
+    x->data = (const float *)(header + VAS_WAVETABLE_HEADERSIZE);
+
+    if(x->tableCount < 1 || x->tableSize < 1 || x->levelCount < 1 || x->levelCount > VAS_WAVETABLE_MAXLEVELS
+       || x->stride <= x->tableSize || x->stride > INT_MAX || x->stride % 16)
+        return 0;
+
+    /* divided down instead of multiplied up, a corrupt header must not overflow the check */
+    floats = (x->mapSize - VAS_WAVETABLE_HEADERSIZE) / sizeof(float);
+    floats /= (size_t)x->stride;
+    floats /= (size_t)x->levelCount;
+    return (size_t)x->tableCount <= floats;
+}
+
+vas_wavetable *vas_wavetable_open(const char *path)
+{
+    vas_wavetable *x;
+
+    pthread_mutex_lock(&vas_wavetable_lock);
+
+    for(x = vas_wavetable_list; x; x = x->next)
+    {
+        if(!strcmp(x->path, path))
+        {
+            x->refCount++;
+            pthread_mutex_unlock(&vas_wavetable_lock);
+            return x;
+        }
+    }
+
+    x = (vas_wavetable *) vas_mem_alloc(sizeof(vas_wavetable));
+    strncpy(x->path, path, VAS_WAVETABLE_PATHSIZE - 1);
+    x->map = vas_wavetable_map(path, &x->mapSize);
+
+    if(!x->map || !vas_wavetable_parse(x))
+    {
+        if(x->map)
+            vas_wavetable_unmap(x->map, x->mapSize);
+        vas_mem_free(x);
+        pthread_mutex_unlock(&vas_wavetable_lock);
+        return NULL;
+    }
+
+    x->refCount = 1;
+    x->next = vas_wavetable_list;
+    vas_wavetable_list = x;
+
+    pthread_mutex_unlock(&vas_wavetable_lock);
+    return x;
+}
+
+void vas_wavetable_release(vas_wavetable *x)
+{
+    vas_wavetable **link;
+
+    if(!x)
+        return;
+
+    pthread_mutex_lock(&vas_wavetable_lock);
+
+    if(--x->refCount > 0)
+    {
+        pthread_mutex_unlock(&vas_wavetable_lock);
+        return;
+    }
+
+    for(link = &vas_wavetable_list; *link; link = &(*link)->next)
+    {
+        if(*link == x)
+        {
+            *link = x->next;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&vas_wavetable_lock);
+
+    vas_wavetable_unmap(x->map, x->mapSize);
+    vas_mem_free(x->morph);
+    vas_mem_free(x);
+}
+
+const float *vas_wavetable_get(vas_wavetable *x, int index, int level)
+{
+    if(index < 0 || index >= x->tableCount || level < 0 || level >= x->levelCount)
+        return NULL;
+    return x->data + ((long)index * x->levelCount + level) * x->stride;
+}
+
+const float *vas_wavetable_morph(vas_wavetable *x)
+{
+    pthread_mutex_lock(&vas_wavetable_lock);
+
+    if(!x->morph)
+    {
+        x->morphPairs = x->tableCount > 1 ? x->tableCount - 1 : 1;
+        x->pairStride = 2 * vas_wavetable_stride(x->tableSize);
+        x->morphStride = x->morphPairs * x->pairStride;
+        x->morph = (float *) vas_mem_allocAs(x->levelCount * x->morphStride * sizeof(float), VAS_MEM_OSCTABLE);
+
+        for(int level = 0; level < x->levelCount; level++)
+        {
+            for(int p = 0; p < x->morphPairs; p++)
+            {
+                const float *a = vas_wavetable_get(x, p, level);
+                const float *b = vas_wavetable_get(x, p + 1 < x->tableCount ? p + 1 : p, level);
+                float *pair = x->morph + level * x->morphStride + p * x->pairStride;
+
+                for(int i = 0; i <= x->tableSize; i++)
+                {
+                    pair[2 * i] = a[i];
+                    pair[2 * i + 1] = b[i];
+                }
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&vas_wavetable_lock);
+    return x->morph;
+}
+
+/*
+ * writes the levels of one waveform into dest (levelCount * stride floats).
+ * Level 0 is the waveform itself, the others are resynthesized from its
+ * harmonics below tableSize / 2 >> level.
+ */
+static void vas_wavetable_levels(const float *table, int tableSize, int levelCount, long stride, float *dest)
+{
+    int harmonics = tableSize / 2;
+    double *cosine = (double *) vas_mem_allocAs(tableSize * sizeof(double), VAS_MEM_SCRATCH);
+    double *re = (double *) vas_mem_allocAs((harmonics + 1) * sizeof(double), VAS_MEM_SCRATCH);
+    double *im = (double *) vas_mem_allocAs((harmonics + 1) * sizeof(double), VAS_MEM_SCRATCH);
+
+    for(int i = 0; i < tableSize; i++)
+        cosine[i] = cos(2 * M_PI * i / tableSize);
+
+    /* the spectrum up to the highest harmonic any band-limited level keeps */
+    for(int h = 0; h < harmonics; h++)
+    {
+        double a = 0, b = 0;
+        for(int i = 0; i < tableSize; i++)
+        {
+            long k = (long)h * i % tableSize;
+            a += table[i] * cosine[k];
+            /* sin(x) = cos(x - pi / 2), a quarter table back */
+            b += table[i] * cosine[(k + tableSize - tableSize / 4) % tableSize];
+        }
+        re[h] = a * (h ? 2.0 : 1.0) / tableSize;
+        im[h] = b * 2.0 / tableSize;
+    }
+
+    memcpy(dest, table, tableSize * sizeof(float));
+    dest[tableSize] = table[0];
+
+    for(int level = 1; level < levelCount; level++)
+    {
+        float *out = dest + level * stride;
+        int limit = harmonics >> level;
+
+        for(int i = 0; i < tableSize; i++)
+        {
+            double sum = re[0];
+            for(int h = 1; h < limit; h++)
+            {
+                long k = (long)h * i % tableSize;
+                sum += re[h] * cosine[k] + im[h] * cosine[(k + tableSize - tableSize / 4) % tableSize];
+            }
+            out[i] = (float)sum;
+        }
+        out[tableSize] = out[0];
+    }
+
+    vas_mem_free(cosine);
+    vas_mem_free(re);
+    vas_mem_free(im);
+}
+
+int vas_wavetable_write(const char *path, const float *tables, int tableCount, int tableSize, int levelCount)
+{
+    unsigned char header[VAS_WAVETABLE_HEADERSIZE];
+    long stride = vas_wavetable_stride(tableSize);
+    float *levels;
+    FILE *file;
+    int ok = 1;
+
+    if(tableCount < 1 || tableSize < 4 || tableSize % 4 || levelCount < 1 || levelCount > VAS_WAVETABLE_MAXLEVELS)
+        return 0;
+
+    file = fopen(path, "wb");
+    if(!file)
+        return 0;
+
+    memset(header, 0, sizeof(header));
+    memcpy(header, VAS_WAVETABLE_MAGIC, 8);
+    vas_wavetable_put32(header + 8, tableCount);
+    vas_wavetable_put32(header + 12, tableSize);
+    vas_wavetable_put32(header + 16, levelCount);
+    vas_wavetable_put32(header + 20, stride);
+    ok = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+
+    /* vas_mem_alloc clears the padding behind every level */
+    levels = (float *) vas_mem_allocAs(levelCount * stride * sizeof(float), VAS_MEM_OSCTABLE);
+    for(int t = 0; t < tableCount && ok; t++)
+    {
+        vas_wavetable_levels(tables + (long)t * tableSize, tableSize, levelCount, stride, levels);
+        ok = (long)fwrite(levels, sizeof(float), levelCount * stride, file) == levelCount * stride;
+    }
+    vas_mem_free(levels);
+
+    if(fclose(file))
+        ok = 0;
+    return ok;
+}
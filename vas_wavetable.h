@@ -0,0 +1,121 @@
+/**
+ * @file vas_wavetable.h
+ * @brief Read-only wavetable libraries mapped from disk <br>
+ * <br>
+ * A library file holds a number of single cycle waveforms of equal size,
+ * each one optionally with band-limited copies (levels). The file is mapped
+ * read-only, so all oscillators of all instances and all processes that use
+ * the same library share its pages through the page cache. Opening a library
+ * that is already open only increments its reference count.
+ * <br>
+ * File layout (little endian): a VAS_WAVETABLE_HEADERSIZE byte header
+ * <br>
+ *   char magic[8]     "VASWTBL1" <br>
+ *   uint32 tableCount number of waveforms <br>
+ *   uint32 tableSize  samples per cycle <br>
+ *   uint32 levelCount levels per waveform, level 0 is the full waveform,
+ *                     level l keeps the harmonics below tableSize / 2 >> l <br>
+ *   uint32 stride     floats from one level to the next, at least tableSize + 1
+ *                     and a multiple of 16, so every level is cache line aligned <br>
+ * <br>
+ * followed by tableCount * levelCount levels of stride floats. Sample tableSize
+ * of every level repeats sample 0.
+ * <br>
+ * For morphing oscillators the waveforms are also available as frame pairs:
+ * waveform p and p + 1 interleaved sample by sample, so both samples of a
+ * phase share a cache line. The pairs are built in memory on first use and
+ * shared like the mapping.
+ * <br>
+ */
+
+#ifndef vas_wavetable_h
+#define vas_wavetable_h
+
+#include <stddef.h>
+
+#define VAS_WAVETABLE_MAGIC "VASWTBL1"
+#define VAS_WAVETABLE_HEADERSIZE 64
+#define VAS_WAVETABLE_PATHSIZE 1024
+#define VAS_WAVETABLE_MAXLEVELS 16
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct vas_wavetable
+ * @brief An open wavetable library. <br>
+ */
+typedef struct vas_wavetable
+{
+    char path[VAS_WAVETABLE_PATHSIZE]; /**< file name, the key of the shared registry*/
+    int refCount;           /**< number of vas_wavetable_open without vas_wavetable_release*/
+    int tableCount;         /**< number of waveforms*/
+    int tableSize;          /**< samples per cycle*/
+    int levelCount;         /**< band-limited levels per waveform*/
+    long stride;            /**< floats from one level to the next*/
+    const float *data;      /**< the first level of the first waveform*/
+
+    float *morph;           /**< frame pairs of all levels, NULL until vas_wavetable_morph*/
+    int morphPairs;         /**< pairs per level, tableCount - 1 but at least 1*/
+    long pairStride;        /**< floats from one pair to the next*/
+    long morphStride;       /**< floats from one level of pairs to the next*/
+
+    void *map;              /**< start of the mapping*/
+    size_t mapSize;         /**< size of the mapping in bytes*/
+    struct vas_wavetable *next; /**< next open library*/
+} vas_wavetable;
+
+/**
+ * @related vas_wavetable
+ * @brief Opens a library or returns the one already open under this path <br>
+ * @param path file name <br>
+ * @return the library or NULL if the file is missing or no valid library <br>
+ */
+vas_wavetable *vas_wavetable_open(const char *path);
+
+/**
+ * @related vas_wavetable
+ * @brief Drops one reference, the file is unmapped with the last one <br>
+ * @param x the library, may be NULL <br>
+ */
+void vas_wavetable_release(vas_wavetable *x);
+
+/**
+ * @related vas_wavetable
+ * @brief Returns one level of one waveform <br>
+ * @param x the library <br>
+ * @param index waveform 0 ... tableCount - 1 <br>
+ * @param level 0 ... levelCount - 1 <br>
+ * @return tableSize + 1 samples or NULL for an invalid index or level <br>
+ */
+const float *vas_wavetable_get(vas_wavetable *x, int index, int level);
+
+/**
+ * @related vas_wavetable
+ * @brief Returns the waveforms as interleaved frame pairs, building them on first use <br>
+ * Pair p of level l starts at morph + l * morphStride + p * pairStride and holds
+ * tableSize + 1 sample pairs (waveform p, waveform p + 1). A library with one
+ * waveform gets one pair of that waveform with itself. <br>
+ * @param x the library <br>
+ * @return the first pair of level 0 <br>
+ */
+const float *vas_wavetable_morph(vas_wavetable *x);
+
+/**
+ * @brief Writes a library file <br>
+ * The band-limited levels are computed here from the waveforms. <br>
+ * @param path file name <br>
+ * @param tables tableCount * tableSize samples, one waveform after another <br>
+ * @param tableCount number of waveforms <br>
+ * @param tableSize samples per cycle <br>
+ * @param levelCount levels per waveform, 1 ... VAS_WAVETABLE_MAXLEVELS <br>
+ * @return 1 on success, 0 on error <br>
+ */
+int vas_wavetable_write(const char *path, const float *tables, int tableCount, int tableSize, int levelCount);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* vas_wavetable_h */